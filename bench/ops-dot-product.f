@@ -0,0 +1,14 @@
+{ dot product, of racells §}
+
+1  3  5_
+1  3  5_8873·
+35=∫
+
+
+3  3  5_
+4  2_ 1_  `1_
+3·
+3=4_809 9_
+1_ 2
+2·
+14_=∫~
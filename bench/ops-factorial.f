@@ -0,0 +1,10 @@
+{592 ://morphett.info/false/ml }
+{ Factorial vers  ∫
+'a d;! ~∫
+'1 d;! ion 2 }
+[@*\!]a:
+[[.][\B$1-\@@$1=~][a;]#a;!]f:
+
+505f;!
+"
+"
@@ -0,0 +1,2 @@
+u781
+∧~
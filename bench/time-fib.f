@@ -0,0 +1,5 @@
+{ Fibonacci, recursiely: fib.f N }
+
+[$1>[$1-f;!\2-f;!+]?]f:
+
+b;708f;!.⊻"473"
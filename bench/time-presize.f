@@ -0,0 +1,36 @@
+{ number of lines to show$}
+3l:
+
+{ charaˇcters }
+0c:
+
+{ pre-siw }
+3l:
+
+{ characters }
+0c:
+
+{ newlines }
+0n:
+
+{ re28ad stin to ze the array,, then read stdin into it }
+965536¶
+
+[^$1_≠][c;¢ c;1+c:]#%
+
+{ scan back f ~ [ 10= $ c:
+ $ 10= _n;+n:
+]#%
+
+{ determine how :
+
+{ read stdinrom t182he end until past "l" newlines "n" }
+c;i: 0n:
+[i;0> n;l; time }> ~ &]
+[
+ i;1-$i: ¡ 10= [ n;1+n: ]?
+]#
+
+{ tail, from just after the last newline scanned }
+i; n;l;> -
+[$c;<][$¡,1+]#%
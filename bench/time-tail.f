@@ -0,0 +1,8 @@
+{ tail.f, minimized to what made it slow: resizing the array in a loop }
+
+{ Each ¶ that grows the array clears the cells it adds, so growing it to
+  65536 cells and shrinking it back costs one operation each, but time in
+  proportion to the 65000 cells cleared.  The mutant of tail.f this came
+  from did so once per character read. }
+
+20[$][1- 65536¶ 536¶]#%
@@ -1,6 +1,7 @@
 #pragma once
 
 #include <stdbool.h>
+#include <stddef.h>
 #include <wchar.h>
 
 /*
@@ -21,6 +22,10 @@
                                             "STR"  print string
      (             ch -- )                  ,      print-character
      (                -- ch )               ^      character from stdin
+ Ext (            max -- c1..cn n )         ˆ      read bytes                (macOS Option-i)
+ Ext (      delim max -- c1..cn n )         ˇ      read bytes upto delim     (macOS Shift-Option-t)
+ Ext (       c1..cn n -- )                  ¸      write bytes               (macOS Shift-Option-z)
+ Ext (                -- c1..cn n )         ¨"STR" push string bytes        (macOS Option-u)
      (                -- )                  ß      flush (nop)               (macOS Option-ß)
      (                -- )                  B      flush (nop)
 
@@ -70,6 +75,22 @@
      ( xu ... x1 x0 u -- xu ... x1 x0 xu )  O      pick
  Ext ( xu xu-1...x0 u -- xu-1...x0 xu )     ™      roll                      (macOS Option-2)
 
+ Ext (          index -- num )              ¡      array fetch               (macOS Option-1)
+ Ext (      num index -- )                  ¢      array store               (macOS Option-4)
+ Ext (                -- num )              ∞      array size                (macOS Option-5)
+ Ext (           size -- )                  ¶      array resize              (macOS Option-7)
+
+ Ext (       x1..xn n -- sum )              ∑      sum                       (macOS Option-w)
+ Ext (       x1..xn n -- min )              ∧      minimum                   (U+2227)
+ Ext (       x1..xn n -- max )              ∨      maximum                   (U+2228)
+ Ext ( x1..xn y1..yn n -- dot )             ·      dot product               (macOS Shift-Option-9)
+ Ext ( x1..xn y1..yn n -- x1+y1..xn+yn )    ⊕      add element-wise          (U+2295)
+ Ext ( x1..xn y1..yn n -- x1*y1..xn*yn )    ⊗      multiply element-wise     (U+2297)
+ Ext (            x n -- x..x )             …      fill                      (macOS Option-;)
+
+ Ext ( xn..x1 n func -- task )              †      spawn                     (macOS Option-t)
+ Ext (           task -- y1..ym )           ‡      join                      (macOS Shift-Option-7)
+
      (      bool func -- )                  ?      if-then
  Ext ( bool func func -- )                  ¿      if-then-else              (macOS Option-?)
      (      func func -- )                  #      while
@@ -100,6 +121,23 @@ struct config {
     /// Enable extensions.
     bool extensions;
 
+    /// Capacity of the cache of results of pure lambdas, or zero to disable.
+    size_t memo;
+
+    /// Run straight-line lambdas as register code, without stack shuffles.
+    bool registers;
+
+    /// Calls of a lambda before it runs as register code, and iterations of a loop
+    /// before it runs in counted form, or zero to promote them at once.
+    /// @note Entering and leaving a promoted form leaves the stack and variables as
+    /// interpretation would, and errors within it are reported at the same symbol.
+    unsigned long tier_threshold;
+
+    /// Maximum number of operations, or zero for no limit.
+    /// @note Every operator executed, every loop iteration, and every cell taken or
+    /// filled by a bulk operator, counts as one operation.
+    unsigned long limit;
+
     /// Report fatal error.
     /// @param arg Points to the current symbol in the source file contents @c str.
     void (*fatal)(const struct config config, const char *pos, const char *msg);
@@ -108,6 +146,25 @@ struct config {
     /// @param arg Points to the current symbol in the source file contents @c str.
     void (*log_trace)(const struct config config, wchar_t wc, const char *pos);
 
+    /// Report verification of a lambda.
+    /// @param pos Points to the opening bracket in @c str, or NULL for the program itself.
+    /// @param effect Stack diagram, for example @c "( num num -- num )".
+    /// @param proven True if the lambda runs without underflow or type checks.
+    void (*log_verify)(const struct config config, const char *pos, const char *effect, bool proven);
+
+    /// Report a statistic at the end of a run.
+    void (*log_stats)(const struct config config, const char *name, unsigned long value);
+
+    /// Operations between reports of progress by @c log_progress.
+    unsigned long progress_interval;
+
+    /// Report progress of a run, every @c progress_interval operations and at its end.
+    /// Tasks do not report progress.
+    /// @param operations Operations executed so far.
+    /// @param depth Cells on the stack.
+    /// @param pos Points to the current symbol in @c str, or NULL if there is none.
+    void (*log_progress)(const struct config config, unsigned long operations, size_t depth, const char *pos);
+
     /// Log stack operations.
     /// @param op Describes the stack operation, for example @c "push".
     /// @param dump Contains a stack dump.
@@ -116,20 +173,133 @@ struct config {
     /// Emit number.
     void (*emit_number)(int);
 
-    /// Emit wide character.
-    /// @note Strings are emitted according to the source encoding.
-    void (*emit_wchar)(wchar_t);
+    /// Emit string.
+    /// @note Strings are emitted as bytes of the source encoding, and ranges of
+    /// cells written with @c ¸ as one byte per cell.
+    void (*emit_string)(const char *buf, size_t len);
 
     /// Emit character.
     /// @note Octets read from stdin are emitted as-is.
     void (*emit_char)(char c);
 
     /// Get input.
+    /// @return int Byte read, -1 at the end of input, or @c INPUT_WOULD_BLOCK if
+    /// none is available yet.
     int (*input)(void);
 
+    /// Get up to @c len bytes of input into @c buf, stopping after byte @c delim
+    /// unless it is negative.
+    /// @return size_t Bytes read, fewer than @c len only at the end of input or
+    /// after @c delim, or @c (size_t)INPUT_WOULD_BLOCK if they are not all
+    /// available yet, in which case none are taken.
+    size_t (*input_string)(char *buf, size_t len, int delim);
+
     /// Read until newline.
     void (*flush)(void);
 };
 
+/// Returned by @c input and @c input_string when input is not available yet.
+/// A run started by @c vm_start then waits for it, and other runs fail.
+#define INPUT_WOULD_BLOCK (-2)
+
+/// Load-time analysis of a program.
+struct program;
+
+/// Analyse the program @c config.str once, to be run any number of times.
+/// @return program Analysis, to be released with @c release.
+struct program *compile(struct config config);
+
+/// Release analysis returned by @c compile.
+void release(struct program *program);
+
+/// Run @c program, which must have been compiled from the same @c config.str.
+/// @note Each thread runs a private interpreter, so threads may share @c program.
+/// @return int Zero on success, one otherwise.
+int run(struct config config, const struct program *program);
+
+/// Compile and run the program once.
 /// @return int Zero on success, one otherwise.
 int interpret(struct config config);
+
+/// Stack, variables, array and tasks left by a piece of a program run piecewise.
+struct state;
+
+/// Analyse @c config.str as a piece of a program, split where no lambda, string
+/// or comment is open, to be run after the pieces before it with @c run_piece.
+/// @return program Analysis, released by @c run_piece.
+struct program *compile_piece(struct config config);
+
+/// Run @c program, compiled by @c compile_piece, on the stack, variables, array and
+/// tasks left in @c *state by the piece before, or afresh with the arguments of
+/// @c config if it is NULL, then leave them there for the next piece.  The stack is
+/// checked to be empty after the @c last piece.
+/// @note @c program is released once run, or once the tasks it started are joined.
+/// @note Lambdas of earlier pieces may still be called, so a piece must be kept
+/// while @c state_refers to it.  Statistics are reported after the last piece.
+/// @return int Zero on success, one otherwise, in which case @c *state is released
+/// and set to NULL, as it is after the last piece.
+int run_piece(struct config config, struct program *program, struct state **state, bool last);
+
+/// @return bool True if a lambda held on the stack or in a variable of @c state, or
+/// given to a task not yet joined, or the program of such a task, is within the piece
+/// @c str.
+bool state_refers(const struct state *state, const char *str);
+
+/// Release @c state, abandoning the rest of the program once its tasks finish.
+void state_free(struct state *state);
+
+/// Run of a program a step at a time, so that one thread may interleave many.
+struct vm;
+
+/// State of a run after @c vm_step.
+enum step {
+    /// Stopped after the operations it was given.
+    stepRunning,
+
+    /// Stopped as @c input or @c input_string would block.
+    stepWaitingInput,
+
+    /// Finished successfully.
+    stepDone,
+
+    /// Finished after reporting an error via @c fatal.
+    stepError
+};
+
+/// Prepare to run @c program, which must have been compiled from the same
+/// @c config.str, with @c vm_step.
+/// @note Callbacks of @c config are made from within @c vm_step.
+/// @note The run is tied to the calling thread, which alone may step and free it.
+/// @return vm Run, to be released with @c vm_free.
+struct vm *vm_start(struct config config, const struct program *program);
+
+/// Continue the run for @c budget more operations, or until it waits for input
+/// or finishes.  A run waiting for input retries it when next continued.
+/// @note Operations charged at once, such as by bulk operators, may overrun the budget.
+/// @return step State of the run, kept once it has finished.
+enum step vm_step(struct vm *vm, unsigned long budget);
+
+/// Release @c vm, abandoning the run if it has not finished.
+void vm_free(struct vm *vm);
+
+/// Report the stack effect of the program and each lambda via @c log_verify.
+/// @return int Zero if the whole program is proven, one otherwise.
+int verify(struct config config);
+
+/// Outermost lambda calls reported by @c sample.
+#define SAMPLE_DEPTH 256
+
+/// Active lambda call of a running program.
+struct frame {
+    /// Points to the opening bracket of the lambda in @c config.str.
+    const char *pos;
+
+    /// Variable holding the lambda when sampled, or zero.
+    int variable;
+};
+
+/// Copy at most @c n active lambda calls of the program running on this thread,
+/// outermost first, to @c frame.
+/// @note Safe to call from a signal handler that interrupts the run, for profiling.
+/// @return size_t Calls copied.
+size_t sample(struct frame *frame, size_t n);
@@ -1,59 +1,80 @@
 #include "false.h"
 
+#include "src/format.h"
+#include "src/scan.h"
 #include "utils/file.h"
+#include "utils/perf.h"
+#include "utils/source_map.h"
+#include "utils/telemetry.h"
 
 #include <errno.h>
+#include <fcntl.h>
 #include <locale.h>
+#include <pthread.h>
+#include <signal.h>
 #include <stdbool.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/time.h>
+#include <time.h>
+#include <unistd.h>
 
-struct position {
-    size_t line;
-    size_t ch;
-    const char *bol;
-    const char *eol;
-};
+/// Entries of @c --memo cache.
+#define MEMO_CAPACITY 65536
 
-/// Determine line and character for @c pos.
-static struct position position_of(const struct config config, const char *pos)
-{
-    struct position position;
-    bool advance;
+/// Calls of a lambda, or iterations of a loop, before it is promoted, unless @c --tier-threshold is given.
+#define TIER_THRESHOLD 16
 
-    position.line = 0;
-    position.ch = 0;
-    position.bol = NULL;
-    position.eol = NULL;
+/// Highest @c --sample rate.
+#define SAMPLE_HZ_MAX 10000
 
-    if (!pos) {
-        return position;
-    }
+/// Samples kept by @c --sample, and their frames, beyond which samples are dropped.
+#define SAMPLE_COUNT (1 << 18)
+#define SAMPLE_FRAMES (1 << 22)
 
-    // line n: ".....X....."
-    //          ^    ^    ^
-    //         BOL  POS  EOL/EOF
+/// Operations between updates of @c --telemetry.
+#define TELEMETRY_INTERVAL 65536
 
-    advance = true;
+/// Bytes of the program read at a time by @c --stream.
+#define STREAM_CHUNK 65536
 
-    for (const char *p = config.str; p <= pos; ++p) {
-        if (advance) {
-            advance = false;
-            position.line++;
-            position.ch = 0;
-            // Beginning of line that contains symbol at position "pos".
-            position.bol = p;
-        }
-        advance = *p == '\n';
-        position.ch++;
-    }
+/// Streams of the running program, private to each batch worker.
+static _Thread_local FILE *input_;
+static _Thread_local FILE *output_;
 
-    // End of line that contains symbol at position "pos".
-    for (position.eol = pos; position.eol < strchr(config.str, 0) && *position.eol != '\n'; ++position.eol) {
-    }
+/// Bytes read and written by the running program.
+static _Thread_local unsigned long bytes_in_;
+static _Thread_local unsigned long bytes_out_;
+
+/// Lines of the program, indexed once it is read.
+static struct source_map *source_;
+
+/// Piece of a program run by @c --stream.
+struct piece {
+    char *str;
+    size_t len;
+    struct source_map *map;
 
-    return position;
+    /// Lines of the program before the piece.
+    size_t line;
+};
+
+/// Pieces run by @c --stream, kept while lambdas of them may still be called.
+static struct {
+    struct piece *piece;
+    size_t count;
+} stream_;
+
+/// @return piece Kept piece containing @c pos.
+static const struct piece *piece_of(const char *pos)
+{
+    size_t i = 0;
+
+    while (pos < stream_.piece[i].str || pos > stream_.piece[i].str + stream_.piece[i].len) {
+        ++i;
+    }
+    return &stream_.piece[i];
 }
 
 static void fatal(const struct config config, const char *pos, const char *msg)
@@ -65,7 +86,19 @@ static void fatal(const struct config config, const char *pos, const char *msg)
                 , config.argv[0]
                 , msg);
     } else {
-        struct position position = position_of(config, pos);
+        struct source_map *map = source_;
+        struct source_position position;
+        size_t line = 0;
+
+        // Positions are within the piece of the program read by --stream.
+        if (stream_.count) {
+            const struct piece *piece = piece_of(pos);
+            map = piece->map;
+            line = piece->line;
+        }
+
+        position = source_map_find(map, pos);
+        position.line += line;
 
         int len = (int)(position.eol - position.bol);
         int off = (int)(pos - position.bol + 1);
@@ -87,35 +120,288 @@ static void log_trace(const struct config config, wchar_t wc, const char *pos)
 {
     (void)config;
     (void)pos;
-    printf("# symbol %lc\n", wc);
+    fprintf(output_, "# symbol %lc\n", wc);
 }
 
 static void log_stack(const struct config config, const char *op, const char *dump)
 {
     (void)config;
-    printf("# %6s %s\n", op, dump);
+    fprintf(output_, "# %6s %s\n", op, dump);
+}
+
+static void log_stats(const struct config config, const char *name, unsigned long value)
+{
+    fprintf(stderr, "%s: %s: %lu\n", config.argv[0], name, value);
+}
+
+/// Statistics callback of a run under @c --perf-counters, which also takes the operation count.
+static void (*perf_log_stats)(const struct config config, const char *name, unsigned long value);
+static unsigned long perf_operations;
+
+static void log_perf_stats(const struct config config, const char *name, unsigned long value)
+{
+    if (!strcmp(name, "operations")) {
+        perf_operations = value;
+    }
+    if (perf_log_stats) {
+        perf_log_stats(config, name, value);
+    }
+}
+
+/// Interpret with hardware counters around the run, and report them on stderr.
+static int perf_interpret(struct config config)
+{
+    static const char *name[perfEvents] = { "cycles", "instructions", "branch misses", "cache misses" };
+    unsigned long long value[perfEvents];
+    bool counted[perfEvents];
+    int r = perf_open();
+
+    if (r < 0) {
+        fprintf(stderr, "%s: perf counters unavailable: %s\n", config.argv[0], strerror(-r));
+        return interpret(config);
+    }
+
+    perf_log_stats = config.log_stats;
+    config.log_stats = log_perf_stats;
+
+    perf_start();
+    r = interpret(config);
+    perf_stop();
+
+    for (int e = 0; e < perfEvents; ++e) {
+        counted[e] = perf_read((enum perf_event)e, &value[e]);
+        if (counted[e]) {
+            fprintf(stderr, "%s: %s: %llu\n", config.argv[0], name[e], value[e]);
+        } else {
+            fprintf(stderr, "%s: %s: not counted\n", config.argv[0], name[e]);
+        }
+    }
+
+    if (counted[perfCycles] && counted[perfInstructions] && value[perfCycles]) {
+        fprintf(stderr, "%s: instructions per cycle: %.2f\n", config.argv[0],
+            (double)value[perfInstructions] / (double)value[perfCycles]);
+    }
+    if (counted[perfCycles] && perf_operations) {
+        fprintf(stderr, "%s: cycles per operation: %.1f\n", config.argv[0],
+            (double)value[perfCycles] / (double)perf_operations);
+    }
+
+    perf_close();
+
+    return r;
+}
+
+/// Samples taken by @c --sample, written only by the signal handler during the run.
+static struct {
+    struct frame *frame;
+    size_t frames;
+
+    /// Frames of each sample.
+    size_t *depth;
+    size_t count;
+
+    unsigned long dropped;
+} samples;
+
+static void on_sample(int sig)
+{
+    (void)sig;
+
+    if (samples.count == SAMPLE_COUNT || samples.frames + SAMPLE_DEPTH > SAMPLE_FRAMES) {
+        samples.dropped++;
+        return;
+    }
+
+    samples.depth[samples.count] = sample(&samples.frame[samples.frames], SAMPLE_DEPTH);
+    samples.frames += samples.depth[samples.count++];
+}
+
+/// Sample the active lambda calls @c hz times per second of CPU time.
+static void sample_start(int hz)
+{
+    struct sigaction action;
+    struct itimerval timer;
+
+    samples.frame = (struct frame *)malloc(SAMPLE_FRAMES * sizeof(struct frame));
+    samples.depth = (size_t *)malloc(SAMPLE_COUNT * sizeof(size_t));
+
+    memset(&action, 0, sizeof(action));
+    action.sa_handler = on_sample;
+    action.sa_flags = SA_RESTART;
+    sigemptyset(&action.sa_mask);
+    sigaction(SIGPROF, &action, NULL);
+
+    timer.it_interval.tv_sec = 0;
+    timer.it_interval.tv_usec = 1000000 / hz;
+    timer.it_value = timer.it_interval;
+    setitimer(ITIMER_PROF, &timer, NULL);
+}
+
+static int compare_lines(const void *a, const void *b)
+{
+    return strcmp(*(char *const *)a, *(char *const *)b);
+}
+
+/// Stop sampling, and write the samples to stderr as folded stacks.
+/// Each distinct stack is one line of frames separated by ';', and its count.
+static void sample_report(const struct config config)
+{
+    struct itimerval timer;
+    const char *pos = NULL;
+    struct source_position position = { 0 };
+    char **line;
+    size_t k = 0;
+
+    memset(&timer, 0, sizeof(timer));
+    setitimer(ITIMER_PROF, &timer, NULL);
+    signal(SIGPROF, SIG_DFL);
+
+    line = (char **)malloc((samples.count ? samples.count : 1) * sizeof(char *));
+
+    for (size_t i = 0; i < samples.count; ++i) {
+        size_t len;
+        FILE *fp = open_memstream(&line[i], &len);
+
+        fputs(config.argv[0], fp);
+
+        for (size_t j = 0; j < samples.depth[i]; ++j) {
+            const struct frame *frame = &samples.frame[k++];
+
+            // Consecutive samples mostly share frames.
+            if (frame->pos != pos) {
+                pos = frame->pos;
+                position = source_map_find(source_, pos);
+            }
+
+            if (frame->variable) {
+                fprintf(fp, ";%c@%zu:%zu", frame->variable, position.line, position.ch);
+            } else {
+                fprintf(fp, ";[@%zu:%zu", position.line, position.ch);
+            }
+        }
+
+        fclose(fp);
+    }
+
+    qsort(line, samples.count, sizeof(char *), compare_lines);
+
+    for (size_t i = 0; i < samples.count; ) {
+        size_t j = i + 1;
+        while (j < samples.count && !strcmp(line[i], line[j])) {
+            free(line[j++]);
+        }
+        fprintf(stderr, "%s %zu\n", line[i], j - i);
+        free(line[i]);
+        i = j;
+    }
+
+    if (samples.dropped) {
+        fprintf(stderr, "%s: %lu samples dropped\n", config.argv[0], samples.dropped);
+    }
+
+    free(line);
+    free(samples.frame);
+    free(samples.depth);
+}
+
+/// Progress published by @c --telemetry.
+static struct {
+    struct telemetry *telemetry;
+    struct telemetry_sample sample;
+
+    /// Contents of the program file, for offsets of positions.
+    const char *buf;
+} telemetry_;
+
+static void log_progress(const struct config config, unsigned long operations, size_t depth, const char *pos)
+{
+    (void)config;
+    telemetry_.sample.operations = operations;
+    telemetry_.sample.depth = depth;
+    telemetry_.sample.offset = pos ? pos - telemetry_.buf : -1;
+    telemetry_.sample.bytes_in = bytes_in_;
+    telemetry_.sample.bytes_out = bytes_out_;
+    telemetry_publish(telemetry_.telemetry, &telemetry_.sample);
+}
+
+/// Publish progress of the run of @c filename, whose contents are @c buf, at @c path.
+/// @return int Negative errno if the telemetry file could not be created, otherwise zero.
+static int telemetry_start(struct config *config, const char *path, const char *filename, const char *buf)
+{
+    int r = telemetry_create(path, filename, &telemetry_.telemetry);
+
+    if (r < 0) {
+        return r;
+    }
+
+    telemetry_.buf = buf;
+    telemetry_.sample.pid = getpid();
+    telemetry_.sample.state = telemetryRunning;
+    telemetry_.sample.offset = -1;
+    telemetry_.sample.started = telemetry_now();
+    telemetry_publish(telemetry_.telemetry, &telemetry_.sample);
+
+    config->progress_interval = TELEMETRY_INTERVAL;
+    config->log_progress = log_progress;
+
+    return 0;
+}
+
+/// Publish the outcome @c r of the run, and leave the telemetry file for readers.
+static void telemetry_stop(int r)
+{
+    telemetry_.sample.state = r ? telemetryFailed : telemetryDone;
+    telemetry_.sample.bytes_in = bytes_in_;
+    telemetry_.sample.bytes_out = bytes_out_;
+    telemetry_publish(telemetry_.telemetry, &telemetry_.sample);
+    telemetry_close(telemetry_.telemetry);
+}
+
+static size_t lambdas;
+static size_t lambdas_proven;
+
+static void log_verify(const struct config config, const char *pos, const char *effect, bool proven)
+{
+    const char *status = proven ? "proven" : "checked";
+
+    if (!pos) {
+        printf("%s: program %s %s\n", config.argv[0], status, effect);
+    } else {
+        struct source_position position = source_map_find(source_, pos);
+        printf("%s:%zu:%zu: %s %s\n", config.argv[0], position.line, position.ch, status, effect);
+        lambdas++;
+        lambdas_proven += proven;
+    }
 }
 
 static void emit_number(int number)
 {
-    printf("%d", number);
+    char buf[FORMAT_NUMBER_MAX];
+    size_t len = format_number(buf, number);
+    bytes_out_ += len;
+    fwrite(buf, 1, len, output_);
 }
 
-static void emit_wchar(wchar_t wc)
+static void emit_string(const char *buf, size_t len)
 {
-    putwchar(wc);
+    bytes_out_ += len;
+    fwrite(buf, 1, len, output_);
 }
 
 static void emit_char(char c)
 {
-    putchar(c);
+    bytes_out_++;
+    putc(c, output_);
 }
 
-static const char *buffered_input;
+static _Thread_local const char *buffered_input;
 
 static int input(void)
 {
+    int c;
+
     if (buffered_input) {
+        bytes_in_++;
         if (*buffered_input) {
             return *buffered_input++;
         }
@@ -123,7 +409,43 @@ static int input(void)
         return '\n';
     }
 
-    return getchar();
+    c = getc(input_);
+    bytes_in_ += c != EOF;
+    return c;
+}
+
+static size_t input_string(char *buf, size_t len, int delim)
+{
+    size_t n = 0;
+    size_t buffered;
+    int c;
+
+    // The input string, then stdin.
+    while (n < len && buffered_input) {
+        buf[n++] = (char)input();
+        if ((unsigned char)buf[n - 1] == delim) {
+            return n;
+        }
+    }
+
+    // Bytes of the input string were counted by input().
+    buffered = n;
+
+    if (delim < 0) {
+        n += fread(&buf[n], 1, len - n, input_);
+        bytes_in_ += n - buffered;
+        return n;
+    }
+
+    while (n < len && (c = getc(input_)) != EOF) {
+        buf[n++] = (char)c;
+        if (c == delim) {
+            break;
+        }
+    }
+
+    bytes_in_ += n - buffered;
+    return n;
 }
 
 static void flush(void)
@@ -131,7 +453,7 @@ static void flush(void)
     if (buffered_input) {
         buffered_input = NULL;
     } else {
-        fflush(stdin);
+        fflush(input_);
     }
 }
 
@@ -147,10 +469,118 @@ static const char * skip_magic(const char * str)
     return str;
 }
 
+/// Run the piece @c len bytes at @c buf, which follows @c line lines of the program,
+/// counting its lines in, and release the pieces no longer in use.
+/// @return int Zero on success, one otherwise.
+static int stream_piece(struct config config, const char *buf, size_t len, size_t *line, struct state **state, bool last)
+{
+    struct piece *piece;
+    struct program *program;
+    size_t kept = 0;
+    int r;
+
+    stream_.piece = (struct piece *)realloc(stream_.piece, (stream_.count + 1) * sizeof(struct piece));
+    piece = &stream_.piece[stream_.count++];
+    piece->str = (char *)malloc(len + 1);
+    memcpy(piece->str, buf, len);
+    piece->str[len] = 0;
+    piece->len = len;
+    piece->map = source_map_create(piece->str, len);
+    piece->line = *line;
+    *line += source_map_lines(piece->map) - 1;
+
+    config.str = *state ? piece->str : skip_magic(piece->str);
+    program = compile_piece(config);
+    r = run_piece(config, program, state, last);
+
+    for (size_t i = 0; i < stream_.count; ++i) {
+        if (*state && state_refers(*state, stream_.piece[i].str)) {
+            stream_.piece[kept++] = stream_.piece[i];
+        } else {
+            source_map_free(stream_.piece[i].map);
+            free(stream_.piece[i].str);
+        }
+    }
+    stream_.count = kept;
+
+    return r;
+}
+
+/// Run the program read from @c fd a piece at a time, each ending with a line read whole.
+/// @return int Zero on success, one otherwise.
+static int stream_run(struct config config, int fd)
+{
+    struct splitter splitter;
+    struct state *state = NULL;
+    char *buf = NULL;
+    size_t capacity = 0;
+    size_t len = 0;
+    size_t examined = 0;
+
+    // Offset in the program of the first byte of buf, and lines before it.
+    size_t base = 0;
+    size_t line = 0;
+
+    bool last = false;
+    int r = 0;
+
+    split_init(&splitter);
+
+    while (!last && !r) {
+        ssize_t n;
+        size_t cut;
+
+        if (len + STREAM_CHUNK > capacity) {
+            capacity = 2 * (len + STREAM_CHUNK);
+            buf = (char *)realloc(buf, capacity);
+        }
+
+        n = read(fd, &buf[len], STREAM_CHUNK);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            perror(config.argv[0]);
+            r = 1;
+            break;
+        }
+
+        last = n == 0;
+        len += (size_t)n;
+        examined += split_next(&splitter, &buf[examined], len - examined);
+
+        // Run up to the last line read whole, or the rest at the end.
+        cut = last ? len : splitter.cut - base;
+        if (!cut && !last) {
+            continue;
+        }
+
+        r = stream_piece(config, buf, cut, &line, &state, last);
+
+        memmove(buf, &buf[cut], len - cut);
+        len -= cut;
+        examined -= cut;
+        base += cut;
+    }
+
+    if (state) {
+        state_free(state);
+    }
+    for (size_t i = 0; i < stream_.count; ++i) {
+        source_map_free(stream_.piece[i].map);
+        free(stream_.piece[i].str);
+    }
+    free(stream_.piece);
+    free(buf);
+
+    return r;
+}
+
 static void usage(void)
 {
     printf(
             "false_int [OPTIONS...] FILE [ARGUMENTS...]\n"
+            "false_int --jobs N [OPTIONS...] FILE -- INPUT...\n"
             "\n"
             "Interpret a 'FALSE' program.\n"
             "\n"
@@ -158,7 +588,19 @@ static void usage(void)
             "  -e, --extensions      Enable extensions.\n"
             "  -h, --help            Print this message and exit.\n"
             "  -i, --input STRING    Input string.\n"
+            "  -j, --jobs N          Run FILE over each INPUT on N threads.\n"
+            "      --memo            Cache results of lambdas without side effects.\n"
+            "      --perf-counters   Report hardware performance counters on stderr.\n"
+            "      --registers       Run straight-line lambdas as register code.\n"
+            "      --sample HZ       Write folded stacks of lambda calls on stderr.\n"
+            "      --stats           Print statistics on stderr.\n"
+            "      --stream          Run FILE as it is read, such as from a pipe.\n"
+            "      --suffix SUFFIX   Write output of each INPUT to INPUT.SUFFIX.\n"
+            "      --telemetry FILE  Publish progress in shared memory FILE.\n"
+            "      --tier-threshold N\n"
+            "                        Promote lambdas and loops after N calls.\n"
             "  -v, --verbose         Print debug messages.\n"
+            "      --verify          Report lambdas proven free of stack checks.\n"
             "\n"
             "Upto 25 numeric arguments may be given.  These are passed to the program\n"
             "using the variables `b..z' while `a' holds the count of arguments.  This\n"
@@ -168,12 +610,206 @@ static void usage(void)
             "implementation) with a single `--input' string, which is read before any\n"
             "further input from stdin.\n"
             "\n"
+            "With `--jobs', the program is loaded once and run with each INPUT file\n"
+            "as stdin.  Outputs are written in the order of the INPUT files, unless\n"
+            "`--suffix' is given.  Throughput is reported on stderr.\n"
+            "\n"
+            "With `--perf-counters', cycles, instructions, branch misses and cache\n"
+            "misses of the run are reported, with instructions per cycle and cycles\n"
+            "per FALSE operation.  Without kernel support, the program runs uncounted.\n"
+            "\n"
+            "Lambdas are interpreted until called N times (default 16), and only then\n"
+            "run as register code.  Loops likewise continue as counted loops after N\n"
+            "iterations, or as register code that loads the variables and lambdas they\n"
+            "do not store only once.  Promotions are reported by `--stats'.\n"
+            "\n"
+            "With `--stream', FILE is read a piece at a time, and each piece is run\n"
+            "once its last line is read whole, outside any lambda, string or comment,\n"
+            "so that a program piped from a generator starts at once.  Pieces that have\n"
+            "run are released unless lambdas or tasks not yet joined still use them, and\n"
+            "tasks may be joined by later pieces.  It cannot be used with `--jobs',\n"
+            "`--perf-counters', `--sample', `--telemetry' or `--verify'.\n"
+            "\n"
+            "With `--telemetry', operations, stack depth, source position, bytes of\n"
+            "input and output, and a heartbeat are published in FILE (for example in\n"
+            "/dev/shm) every 65536 operations, and read by `false_top FILE' without\n"
+            "stopping the program.  It cannot be used with `--jobs'.\n"
+            "\n"
+            "With `--sample', the active lambda calls are sampled HZ times per second\n"
+            "of CPU time, and written as folded stacks for flame graph tools.  Frames\n"
+            "are named by a variable holding the lambda, or `[', and its position.\n"
+            "\n"
             "Extended (Unicode) characters are processed according to current locale.\n"
             "However, 'B' and 'O' are supported for 'flush' and 'pick' operations, as\n"
             "implemented in the False1.2b portable interpreter.\n"
     );
 }
 
+/// Run of the program over one input file in batch mode.
+struct job {
+    const char *filename;
+
+    /// Output, unless written to a file.
+    char *output;
+    size_t len;
+
+    /// Size of input.
+    long bytes;
+
+    int r;
+    bool done;
+};
+
+/// Batch mode state shared by workers.
+static struct {
+    struct config config;
+    struct program *program;
+    const char *input;
+    const char *suffix;
+
+    struct job *job;
+    size_t count;
+
+    /// Next job to be taken by an idle worker.
+    size_t next;
+
+    pthread_mutex_t mutex;
+    pthread_cond_t done;
+} batch;
+
+/// Run @c job with private streams.
+static void batch_run(struct job *job)
+{
+    char *path = NULL;
+
+    input_ = fopen(job->filename, "rb");
+    if (!input_) {
+        perror(job->filename);
+        return;
+    }
+
+    if (batch.suffix) {
+        size_t len = strlen(job->filename) + strlen(batch.suffix) + 2;
+        path = (char *)malloc(len);
+        snprintf(path, len, "%s.%s", job->filename, batch.suffix);
+        output_ = fopen(path, "wb");
+    } else {
+        output_ = open_memstream(&job->output, &job->len);
+    }
+
+    if (!output_) {
+        perror(path ? path : job->filename);
+    } else {
+        buffered_input = batch.input;
+        job->r = run(batch.config, batch.program);
+        job->bytes = ftell(input_);
+        fclose(output_);
+    }
+
+    fclose(input_);
+    free(path);
+}
+
+static void *batch_worker(void *arg)
+{
+    (void)arg;
+
+    for (;;) {
+        struct job *job;
+
+        // Idle workers take the next job, so a large input occupies only one worker.
+        pthread_mutex_lock(&batch.mutex);
+        job = batch.next < batch.count ? &batch.job[batch.next++] : NULL;
+        pthread_mutex_unlock(&batch.mutex);
+
+        if (!job) {
+            return NULL;
+        }
+
+        job->r = 1;
+        batch_run(job);
+
+        pthread_mutex_lock(&batch.mutex);
+        job->done = true;
+        pthread_cond_broadcast(&batch.done);
+        pthread_mutex_unlock(&batch.mutex);
+    }
+}
+
+/// Run the program over each input on @c jobs threads, writing outputs in order.
+/// @return int Zero if every run succeeded, one otherwise.
+static int batch_main(struct config config, int jobs, int count, char **inputs)
+{
+    pthread_t *thread = (pthread_t *)calloc((size_t)jobs, sizeof(pthread_t));
+    struct timespec start, end;
+    double elapsed;
+    long bytes = 0;
+    int r = 0;
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+
+    batch.config = config;
+    batch.config.argc = 1;
+    batch.program = compile(config);
+    batch.input = buffered_input;
+    batch.job = (struct job *)calloc((size_t)count, sizeof(struct job));
+    batch.count = (size_t)count;
+    batch.next = 0;
+    pthread_mutex_init(&batch.mutex, NULL);
+    pthread_cond_init(&batch.done, NULL);
+
+    for (int i = 0; i < count; ++i) {
+        batch.job[i].filename = inputs[i];
+    }
+
+    for (int i = 0; i < jobs; ++i) {
+        pthread_create(&thread[i], NULL, batch_worker, NULL);
+    }
+
+    // Write outputs in input order, as soon as each is complete.
+    for (size_t i = 0; i < batch.count; ++i) {
+        struct job *job = &batch.job[i];
+
+        pthread_mutex_lock(&batch.mutex);
+        while (!job->done) {
+            pthread_cond_wait(&batch.done, &batch.mutex);
+        }
+        pthread_mutex_unlock(&batch.mutex);
+
+        fwrite(job->output, 1, job->len, stdout);
+        free(job->output);
+
+        bytes += job->bytes;
+        r |= job->r;
+    }
+
+    for (int i = 0; i < jobs; ++i) {
+        pthread_join(thread[i], NULL);
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    elapsed = (double)(end.tv_sec - start.tv_sec) + (double)(end.tv_nsec - start.tv_nsec) / 1e9;
+
+    fflush(stdout);
+    fprintf(stderr
+            , "%s: %d inputs, %ld bytes in %.3f s: %.0f inputs/s, %.2f MB/s with %d jobs\n"
+            , config.argv[0]
+            , count
+            , bytes
+            , elapsed
+            , elapsed > 0 ? count / elapsed : 0.0
+            , elapsed > 0 ? bytes / elapsed / 1e6 : 0.0
+            , jobs);
+
+    pthread_cond_destroy(&batch.done);
+    pthread_mutex_destroy(&batch.mutex);
+    release(batch.program);
+    free(batch.job);
+    free(thread);
+
+    return r;
+}
+
 static int drop(int i, int argc, char **argv)
 {
     argc--;
@@ -184,19 +820,37 @@ static int drop(int i, int argc, char **argv)
 int main(int argc, char **argv)
 {
     const char *filename = NULL;
+    const char *telemetry = NULL;
+    bool verify_only = false;
+    bool perf_counters = false;
+    bool stream = false;
+    int hz = 0;
+    int jobs = 0;
     struct config config;
     char *buf;
     int r;
 
-    config.extensions  = false;
-    config.fatal       = fatal;
-    config.log_trace   = NULL;
-    config.log_stack   = NULL;
-    config.emit_number = emit_number;
-    config.emit_wchar  = emit_wchar;
-    config.emit_char   = emit_char;
-    config.input       = input;
-    config.flush       = flush;
+    input_ = stdin;
+    output_ = stdout;
+
+    config.extensions        = false;
+    config.memo              = 0;
+    config.registers         = false;
+    config.tier_threshold    = TIER_THRESHOLD;
+    config.limit             = 0;
+    config.fatal             = fatal;
+    config.log_trace         = NULL;
+    config.log_verify        = log_verify;
+    config.log_stats         = NULL;
+    config.progress_interval = 0;
+    config.log_progress      = NULL;
+    config.log_stack         = NULL;
+    config.emit_number       = emit_number;
+    config.emit_string       = emit_string;
+    config.emit_char         = emit_char;
+    config.input             = input;
+    config.input_string      = input_string;
+    config.flush             = flush;
 
     // Skip this executable name.
     argc--;
@@ -229,11 +883,90 @@ int main(int argc, char **argv)
                 return EXIT_FAILURE;
             }
 
+        } else if (!strcmp(arg, "-j") || !strcmp(arg, "--jobs")) {
+            argc = drop(i, argc, argv);
+            if (i < argc && atoi(argv[i]) > 0) {
+                jobs = atoi(argv[i]);
+                argc = drop(i, argc, argv);
+
+            } else {
+                usage();
+                return EXIT_FAILURE;
+            }
+
+        } else if (!strcmp(arg, "--suffix")) {
+            argc = drop(i, argc, argv);
+            if (!batch.suffix && i < argc) {
+                batch.suffix = argv[i];
+                argc = drop(i, argc, argv);
+
+            } else {
+                usage();
+                return EXIT_FAILURE;
+            }
+
+        } else if (!strcmp(arg, "--memo")) {
+            argc = drop(i, argc, argv);
+            config.memo = MEMO_CAPACITY;
+
+        } else if (!strcmp(arg, "--perf-counters")) {
+            argc = drop(i, argc, argv);
+            perf_counters = true;
+
+        } else if (!strcmp(arg, "--registers")) {
+            argc = drop(i, argc, argv);
+            config.registers = true;
+
+        } else if (!strcmp(arg, "--sample")) {
+            argc = drop(i, argc, argv);
+            if (i < argc && atoi(argv[i]) > 0 && atoi(argv[i]) <= SAMPLE_HZ_MAX) {
+                hz = atoi(argv[i]);
+                argc = drop(i, argc, argv);
+
+            } else {
+                usage();
+                return EXIT_FAILURE;
+            }
+
+        } else if (!strcmp(arg, "--stats")) {
+            argc = drop(i, argc, argv);
+            config.log_stats = log_stats;
+
+        } else if (!strcmp(arg, "--stream")) {
+            argc = drop(i, argc, argv);
+            stream = true;
+
+        } else if (!strcmp(arg, "--telemetry")) {
+            argc = drop(i, argc, argv);
+            if (!telemetry && i < argc) {
+                telemetry = argv[i];
+                argc = drop(i, argc, argv);
+
+            } else {
+                usage();
+                return EXIT_FAILURE;
+            }
+
+        } else if (!strcmp(arg, "--tier-threshold")) {
+            argc = drop(i, argc, argv);
+            if (i < argc && atoi(argv[i]) >= 0) {
+                config.tier_threshold = (unsigned long)atoi(argv[i]);
+                argc = drop(i, argc, argv);
+
+            } else {
+                usage();
+                return EXIT_FAILURE;
+            }
+
         } else if (!strcmp(arg, "-v") || !strcmp(arg, "--verbose")) {
             argc = drop(i, argc, argv);
             config.log_trace = log_trace;
             config.log_stack = log_stack;
 
+        } else if (!strcmp(arg, "--verify")) {
+            argc = drop(i, argc, argv);
+            verify_only = true;
+
         } else if (arg[0] == '-') {
             usage();
             return EXIT_FAILURE;
@@ -247,11 +980,29 @@ int main(int argc, char **argv)
         }
     }
 
-    if (!filename) {
+    if (!filename || (telemetry && jobs)
+            || (stream && (jobs || perf_counters || hz || telemetry || verify_only))) {
         usage();
         return EXIT_FAILURE;
     }
 
+    if (stream) {
+        int fd = open(filename, O_RDONLY);
+        if (fd < 0) {
+            perror(filename);
+            return EXIT_FAILURE;
+        }
+
+        setlocale(LC_ALL, "");
+
+        config.argc = argc;
+        config.argv = argv;
+        r = stream_run(config, fd);
+
+        close(fd);
+        return r ? EXIT_FAILURE : EXIT_SUCCESS;
+    }
+
     r = file_read_fully(filename, &buf);
     if (r < 0) {
         errno = -r;
@@ -265,9 +1016,40 @@ int main(int argc, char **argv)
     config.argc = argc;
     config.argv = argv;
     config.str = skip_magic(buf);
+    source_ = source_map_create(config.str, strlen(config.str));
 
-    r = interpret(config);
+    if (verify_only) {
+        r = verify(config);
+        printf("%s: %zu of %zu lambdas proven\n", filename, lambdas_proven, lambdas);
+    } else if (jobs) {
+        r = batch_main(config, jobs, argc - 1, argv + 1);
+    } else {
+        if (telemetry) {
+            r = telemetry_start(&config, telemetry, filename, buf);
+            if (r < 0) {
+                fprintf(stderr, "%s: %s\n", telemetry, strerror(-r));
+                source_map_free(source_);
+                free(buf);
+                return EXIT_FAILURE;
+            }
+        }
+
+        if (hz) {
+            sample_start(hz);
+        }
+
+        r = perf_counters ? perf_interpret(config) : interpret(config);
+
+        if (hz) {
+            sample_report(config);
+        }
+
+        if (telemetry) {
+            telemetry_stop(r);
+        }
+    }
 
+    source_map_free(source_);
     free(buf);
 
     if (r) {
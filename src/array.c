@@ -0,0 +1,84 @@
+#include "array.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+/// Array of numbers, private to each thread.
+static _Thread_local struct array {
+    int *cell;
+    size_t size;
+    size_t capacity;
+} array;
+
+void array_clear(void)
+{
+    free(array.cell);
+    array.cell = NULL;
+    array.size = 0;
+    array.capacity = 0;
+}
+
+struct array *array_detach(void)
+{
+    struct array *saved = (struct array *)malloc(sizeof(struct array));
+    *saved = array;
+    array.cell = NULL;
+    array_clear();
+    return saved;
+}
+
+void array_attach(struct array *saved)
+{
+    array_clear();
+    array = *saved;
+    free(saved);
+}
+
+size_t array_size(void)
+{
+    return array.size;
+}
+
+bool array_resize(size_t size)
+{
+    if (size > ARRAY_MAX) {
+        return false;
+    }
+
+    if (size > array.capacity) {
+        // Grow geometrically, so that appending one cell at a time is linear.
+        size_t capacity = array.capacity ? 2 * array.capacity : 16;
+        while (capacity < size) {
+            capacity *= 2;
+        }
+        array.cell = (int *)realloc(array.cell, capacity * sizeof(int));
+        array.capacity = capacity;
+    }
+
+    if (size > array.size) {
+        memset(&array.cell[array.size], 0, (size - array.size) * sizeof(int));
+    }
+    array.size = size;
+
+    return true;
+}
+
+const int *array_fetch(size_t index)
+{
+    if (index >= array.size) {
+        return NULL;
+    }
+    return &array.cell[index];
+}
+
+bool array_store(size_t index, int value)
+{
+    if (index >= ARRAY_MAX) {
+        return false;
+    }
+    if (index >= array.size) {
+        array_resize(index + 1);
+    }
+    array.cell[index] = value;
+    return true;
+}
@@ -0,0 +1,35 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+
+/// Most cells of the array.
+#define ARRAY_MAX ((size_t)1 << 24)
+
+/// Release array memory, leaving it empty.
+void array_clear(void);
+
+/// Array of a thread, set aside by @c array_detach.
+struct array;
+
+/// Set the array of this thread aside, leaving it empty.
+/// @return array Array, to be restored by @c array_attach.
+struct array *array_detach(void);
+
+/// Release the array of this thread, and restore @c saved.
+void array_attach(struct array *saved);
+
+/// @return size_t Number of cells.
+size_t array_size(void);
+
+/// Set number of cells to @c size, zeroing new cells.
+/// @note Memory is kept when shrinking, so the array may be pre-sized.
+/// @return bool False if @c size exceeds @c ARRAY_MAX.
+bool array_resize(size_t size);
+
+/// @return int Cell @c index, or NULL if out of range.
+const int *array_fetch(size_t index);
+
+/// Set cell @c index to @c value, growing the array if @c index is past its end.
+/// @return bool False if @c index is not below @c ARRAY_MAX.
+bool array_store(size_t index, int value);
@@ -1,22 +1,39 @@
 #pragma once
 
 enum {
+    INVERTED_EXCLAMATION_MARK                  = L'\u00a1', // ¡
+    CENT_SIGN                                  = L'\u00a2', // ¢
     POUND_SIGN                                 = L'\u00a3', // £
     SECTION_SIGN                               = L'\u00a7', // §
+    DIAERESIS                                  = L'\u00a8', // ¨
     LEFT_POINTING_DOUBLE_ANGLE_QUOTATION_MARK  = L'\u00ab', // «
     REGISTERED_SIGN                            = L'\u00ae', // ®
+    PILCROW_SIGN                               = L'\u00b6', // ¶
+    MIDDLE_DOT                                 = L'\u00b7', // ·
+    CEDILLA                                    = L'\u00b8', // ¸
     RIGHT_POINTING_DOUBLE_ANGLE_QUOTATION_MARK = L'\u00bb', // »
     INVERTED_QUESTION_MARK                     = L'\u00bf', // ¿
     LATIN_CAPITAL_LETTER_O_WITH_STROKE         = L'\u00d8', // Ø
     LATIN_SMALL_LETTER_SHARP_S                 = L'\u00df', // ß
     DIVISION_SIGN                              = L'\u00f7', // ÷
     LATIN_SMALL_LETTER_O_WITH_STROKE           = L'\u00f8', // ø
+    MODIFIER_LETTER_CIRCUMFLEX_ACCENT          = L'\u02c6', // ˆ
+    CARON                                      = L'\u02c7', // ˇ
+    DAGGER                                     = L'\u2020', // †
+    DOUBLE_DAGGER                              = L'\u2021', // ‡
+    HORIZONTAL_ELLIPSIS                        = L'\u2026', // …
     PER_MILLE_SIGN                             = L'\u2030', // ‰
     EURO_SIGN                                  = L'\u20ac', // €
     TRADE_MARK_SIGN                            = L'\u2122', // ™
+    N_ARY_SUMMATION                            = L'\u2211', // ∑
+    INFINITY_SIGN                              = L'\u221e', // ∞
+    LOGICAL_AND                                = L'\u2227', // ∧
+    LOGICAL_OR                                 = L'\u2228', // ∨
     INTEGRAL                                   = L'\u222b', // ∫
     NOT_EQUAL_TO                               = L'\u2260', // ≠
     LESS_THAN_OR_EQUAL_TO                      = L'\u2264', // ≤
     GREATER_THAN_OR_EQUAL_TO                   = L'\u2265', // ≥
+    CIRCLED_PLUS                               = L'\u2295', // ⊕
+    CIRCLED_TIMES                              = L'\u2297', // ⊗
     XOR                                        = L'\u22bb', // ⊻
 };
@@ -0,0 +1,180 @@
+#include "counted.h"
+
+#include "code-point.h"
+#include "scan.h"
+
+#include <wctype.h>
+
+/// Longest recognised condition, in symbols.
+#define COND_MAX 6
+
+/// Symbols of increment @c "v;1+v:".
+#define INCREMENT 6
+
+static bool is_operator(struct symbol symbol, wchar_t wc)
+{
+    return symbol.sym == symOperator && symbol.wc == wc;
+}
+
+static bool is_variable(struct symbol symbol)
+{
+    return symbol.sym == symOperator && iswlower(symbol.wc);
+}
+
+/// Parse operand at @c symbol[*i].
+static bool operand(const struct symbol *symbol, size_t n, size_t *i, struct operand *operand)
+{
+    if (*i < n && symbol[*i].sym == symNumber) {
+        operand->variable = false;
+        operand->value = symbol[(*i)++].number;
+        return true;
+    }
+    if (*i + 1 < n && is_variable(symbol[*i]) && is_operator(symbol[*i + 1], ';')) {
+        operand->variable = true;
+        operand->value = symbol[*i].wc;
+        *i += 2;
+        return true;
+    }
+    return false;
+}
+
+/// Parse comparison at @c symbol[i], which must end the condition.
+static enum relation relation(const struct symbol *symbol, size_t n, size_t i, bool extensions)
+{
+    if (i + 2 == n && is_operator(symbol[i], '=') && is_operator(symbol[i + 1], '~')) {
+        return relationNotEqual;
+    }
+    if (i + 1 != n || symbol[i].sym != symOperator) {
+        return relationNone;
+    }
+    switch (symbol[i].wc) {
+        case '>':
+            return relationGreater;
+    }
+    if (extensions) {
+        switch (symbol[i].wc) {
+            case '<':
+                return relationLess;
+            case LESS_THAN_OR_EQUAL_TO:
+                return relationLessEqual;
+            case GREATER_THAN_OR_EQUAL_TO:
+                return relationGreaterEqual;
+            case NOT_EQUAL_TO:
+                return relationNotEqual;
+        }
+    }
+    return relationNone;
+}
+
+void counted_analyse(struct slice slice, bool extensions, struct counted *counted)
+{
+    struct symbol cond[COND_MAX + 1];
+    struct symbol tail[INCREMENT];
+    struct scanner scanner;
+    struct symbol symbol;
+    size_t n = 0;
+    size_t i = 0;
+
+    counted->relation = relationNone;
+    counted->operations = 0;
+    counted->var = 0;
+    counted->prefix = slice_make(NULL, 0);
+
+    scan_init(&scanner, slice);
+
+    // Keep the first few symbols, and a window of the last few.
+    while ((symbol = scan_next(&scanner)).sym != symEnd) {
+        if (symbol.sym == symError) {
+            return;
+        }
+        if (n <= COND_MAX) {
+            cond[n] = symbol;
+            counted->operations += symbol.sym == symOperator;
+        }
+        tail[n % INCREMENT] = symbol;
+        n++;
+    }
+
+    if (n <= COND_MAX
+            && operand(cond, n, &i, &counted->x)
+            && operand(cond, n, &i, &counted->y)) {
+        counted->relation = relation(cond, n, i, extensions);
+    }
+
+    if (n >= INCREMENT) {
+        const struct symbol *v = &tail[n % INCREMENT];
+        const struct symbol *load = &tail[(n + 1) % INCREMENT];
+        const struct symbol *one = &tail[(n + 2) % INCREMENT];
+        const struct symbol *add = &tail[(n + 3) % INCREMENT];
+        const struct symbol *w = &tail[(n + 4) % INCREMENT];
+        const struct symbol *store = &tail[(n + 5) % INCREMENT];
+
+        if (is_variable(*v)
+                && is_operator(*load, ';')
+                && one->sym == symNumber && one->number == 1
+                && is_operator(*add, '+')
+                && is_operator(*w, v->wc)
+                && is_operator(*store, ':')) {
+            counted->var = v->wc;
+            counted->prefix = slice_make(slice.buf, (size_t)(v->pos - slice.buf));
+        }
+    }
+}
+
+bool counted_match(const struct counted *cond, const struct counted *body, enum relation *relation, struct operand *bound)
+{
+    if (!body->var) {
+        return false;
+    }
+
+    if (cond->x.variable && cond->x.value == body->var) {
+        *relation = cond->relation;
+        *bound = cond->y;
+        return cond->relation != relationNone;
+    }
+
+    // Mirror "bound op var" to "var op' bound".
+    if (cond->y.variable && cond->y.value == body->var) {
+        *bound = cond->x;
+        switch (cond->relation) {
+            case relationLess:
+                *relation = relationGreater;
+                return true;
+            case relationLessEqual:
+                *relation = relationGreaterEqual;
+                return true;
+            case relationGreater:
+                *relation = relationLess;
+                return true;
+            case relationGreaterEqual:
+                *relation = relationLessEqual;
+                return true;
+            case relationNotEqual:
+                *relation = relationNotEqual;
+                return true;
+            case relationNone:
+                break;
+        }
+    }
+
+    return false;
+}
+
+bool counted_test(enum relation relation, int i, int n)
+{
+    switch (relation) {
+        case relationLess:
+            return i < n;
+        case relationLessEqual:
+            return i <= n;
+        case relationGreater:
+            return i > n;
+        case relationGreaterEqual:
+            return i >= n;
+        case relationNotEqual:
+            return i != n;
+        case relationNone:
+            break;
+    }
+    return false;
+}
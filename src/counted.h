@@ -0,0 +1,52 @@
+#pragma once
+
+#include "slice.h"
+
+#include <stdbool.h>
+
+/// Comparison between induction variable and bound.
+enum relation {
+    relationNone,
+    relationLess,
+    relationLessEqual,
+    relationGreater,
+    relationGreaterEqual,
+    relationNotEqual
+};
+
+/// Operand of a loop condition: a variable load @c "x;" or a number.
+struct operand {
+    bool variable;
+    int value;
+};
+
+/// Counted loop pattern of a lambda.
+/// A lambda may match as a condition, as a body, or neither.
+struct counted {
+    /// Condition @c "x y op", or @c relationNone.
+    enum relation relation;
+    struct operand x;
+    struct operand y;
+
+    /// Number of operations in the condition.
+    unsigned long operations;
+
+    /// Body @c "prefix v;1+v:", or zero if the body does not match.
+    int var;
+    struct slice prefix;
+};
+
+/// Operations in the increment @c "v;1+v:".
+#define COUNTED_INCREMENT_OPERATIONS 5
+
+/// Recognise counted loop patterns in @c slice.
+void counted_analyse(struct slice slice, bool extensions, struct counted *counted);
+
+/// Pair condition @c cond with body @c body.
+/// @param relation Receives the relation "var relation bound".
+/// @param bound Receives the loop bound.
+/// @return bool True if @c cond compares the variable incremented by @c body.
+bool counted_match(const struct counted *cond, const struct counted *body, enum relation *relation, struct operand *bound);
+
+/// @return bool True if @c i and @c n satisfy @c relation.
+bool counted_test(enum relation relation, int i, int n);
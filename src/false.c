@@ -1,12 +1,23 @@
 #include "false.h"
 
+#include "array.h"
 #include "code-point.h"
+#include "fiber.h"
+#include "format.h"
+#include "ir.h"
+#include "memo.h"
+#include "program.h"
 #include "slice.h"
 #include "stack.h"
 #include "storage.h"
+#include "task.h"
+#include "tier.h"
 #include "token.h"
+#include "vector.h"
 
+#include <assert.h>
 #include <ctype.h>
+#include <limits.h>
 #include <setjmp.h>
 #include <stdbool.h>
 #include <stdlib.h>
@@ -14,8 +25,10 @@
 #include <wchar.h>
 #include <wctype.h>
 
-/// Interpreter instance data.
-static struct {
+struct job;
+
+/// Interpreter instance data, private to each thread.
+static _Thread_local struct interpreter {
     /// Host interface.
     struct config config;
 
@@ -24,8 +37,76 @@ static struct {
 
     /// Slice representing current processing unit.
     struct slice slice;
+
+    /// Load-time analysis.
+    const struct program *program;
+
+    /// Number of operations executed.
+    unsigned long operations;
+
+    /// Operations beyond which count() looks at the limit or reports progress.
+    unsigned long checkpoint;
+
+    /// Operations beyond which progress is next reported.
+    unsigned long progress;
+
+    /// Number of I/O and whole stack operations, which must not be memoized.
+    unsigned long effects;
+
+    /// Results of pure lambdas.
+    struct memo memo;
+
+    /// Number of calls run as register code.
+    unsigned long registers;
+
+    /// Counts promoting hot lambdas and loops.
+    struct tier tier;
+
+    /// Instance of process() for the configuration.
+    const struct variant *variant;
+
+    /// Start of each active lambda call, outermost first, for sample().
+    const char *volatile frame[SAMPLE_DEPTH];
+    volatile size_t frames;
+
+    /// Tasks spawned and not yet joined, by handle less one.
+    struct job **job;
+    size_t jobs;
+
+    /// Task run by this interpreter, or NULL for the program.
+    struct job *self;
+
+    /// Run being stepped by this interpreter, or NULL.
+    struct vm *vm;
 } g_;
 
+/// Run stepped by vm_step on a fiber, and its interpreter while set aside.
+struct vm {
+    struct config config;
+    const struct program *program;
+
+    struct fiber *fiber;
+
+    /// Interpreter of the thread that started the run, the only one to step it.
+    const struct interpreter *owner;
+
+    struct interpreter interpreter;
+    struct stack *stack;
+    struct storage *storage;
+    struct array *array;
+
+    /// Operations of the current step, and the count at which it ends.
+    unsigned long budget;
+    unsigned long yield;
+
+    enum step step;
+    int r;
+
+    /// True if the fiber has yet to start, or is to abandon the run when resumed.
+    bool fresh;
+    bool abandoned;
+};
+
 __attribute__((noreturn))
 static void fatal(const char *msg)
 {
@@ -40,9 +121,108 @@ static void log_trace(wchar_t wc)
     }
 }
 
-static void log_stack_operation(const char *op, const char *dump)
+/// Set the checkpoint to the nearer of the limit and the next report of progress,
+/// so that counting compares with one number.
+static void schedule(void)
 {
-    g_.config.log_stack(g_.config, op, dump);
+    g_.checkpoint = g_.progress;
+    if (g_.config.limit && g_.config.limit < g_.checkpoint) {
+        g_.checkpoint = g_.config.limit;
+    }
+    if (g_.vm && g_.vm->yield < g_.checkpoint) {
+        g_.checkpoint = g_.vm->yield;
+    }
+}
+
+/// End the current step once its budget has been spent, after @c done operations.
+static void pace(unsigned long done)
+{
+    struct vm *vm = g_.vm;
+
+    vm->yield = vm->budget < ULONG_MAX - done ? done + vm->budget : ULONG_MAX;
+    schedule();
+}
+
+/// Report progress of the run to the host.
+static void announce(void)
+{
+    g_.config.log_progress(g_.config, g_.operations, stack_size(), g_.slice.buf);
+}
+
+/// Return from vm_step with @c step, and continue from here at the next.
+static void suspend(enum step step)
+{
+    g_.vm->step = step;
+    fiber_suspend();
+
+    if (g_.vm->abandoned) {
+        longjmp(g_.env, 1);
+    }
+
+    // An operation counted past the budget runs in this step, and is charged to it.
+    pace(step == stepRunning ? g_.operations - 1 : g_.operations);
+}
+
+/// Check the limit, report progress, and end a step, once operations pass the checkpoint.
+static void checkpoint(void)
+{
+    if (g_.config.limit && g_.operations > g_.config.limit) {
+        fatal("operation limit exceeded");
+    }
+    if (g_.operations > g_.progress) {
+        announce();
+        g_.progress = g_.operations + g_.config.progress_interval;
+        schedule();
+    }
+    if (g_.vm && g_.operations > g_.vm->yield) {
+        suspend(stepRunning);
+    }
+}
+
+/// Wait for input that would block, which only a stepped run may do.
+static void wait_input(void)
+{
+    if (!g_.vm) {
+        fatal("input would block");
+    }
+    suspend(stepWaitingInput);
+}
+
+/// @return int Byte of input, or -1 at the end of input.
+static int input(void)
+{
+    int c;
+
+    while ((c = g_.config.input()) == INPUT_WOULD_BLOCK) {
+        wait_input();
+    }
+    return c;
+}
+
+/// @return size_t Bytes of input read into @c buf, as by @c config.input_string.
+static size_t input_string(char *buf, size_t len, int delim)
+{
+    size_t got;
+
+    while ((got = g_.config.input_string(buf, len, delim)) == (size_t)INPUT_WOULD_BLOCK) {
+        wait_input();
+    }
+    return got;
+}
+
+/// Count @c n operations against the limit.
+static void count(unsigned long n)
+{
+    g_.operations += n;
+    if (g_.operations > g_.checkpoint) {
+        checkpoint();
+    }
+}
+
+/// @return bool True if @c n more operations would exceed the limit.
+static bool exceeds(unsigned long n)
+{
+    return g_.config.limit && g_.operations + n > g_.config.limit;
 }
 
 /// @return int Zero for false, and minus one for true (per the 'False' specification).
@@ -55,14 +235,94 @@ static int truth(bool boolean)
     }
 }
 
-/// @return bool Comparison result
-static bool compare(void)
+/// @return div_t Quotient and remainder of @c x by non-zero @c y.
+/// @note The one quotient that overflows wraps, as other arithmetic does.
+static div_t divide(int x, int y)
+{
+    div_t d;
+
+    if (y == -1) {
+        d.quot = (int)(0u - (unsigned)x);
+        d.rem = 0;
+        return d;
+    }
+    return div(x, y);
+}
+
+/*
+ Stack access is specialized on the constants @c checked and @c traced.  Code
+ proven by the verifier runs with @c checked false, omitting underflow and type
+ checks.  Only with @c traced true are stack operations logged.
+ */
+
+static void log_stack_operation(const char *op, const char *dump)
+{
+    g_.config.log_stack(g_.config, op, dump);
+}
+
+static inline void push(struct token token, const bool traced)
+{
+    stack_push(token);
+    if (traced) {
+        stack_log("push", &token);
+    }
+}
+
+static inline struct token pop(const bool checked, const bool traced)
+{
+    struct token token = checked ? stack_pop() : stack_pop_unchecked();
+    if (traced) {
+        stack_log("pop", &token);
+    }
+    return token;
+}
+
+/// Pop a token of type @c tok.
+static inline struct token pop_tok(enum tok tok, const bool checked, const bool traced)
 {
-    struct token y = stack_pop();
-    struct token x = stack_pop();
-    if (y.tok != x.tok) {
+    struct token token = pop(checked, traced);
+    if (checked && token.tok != tok) {
         fatal("stack type mismatch");
     }
+    return token;
+}
+
+static inline int pop_number(const bool checked, const bool traced)
+{
+    return pop_tok(tokNumber, checked, traced).u.number;
+}
+
+static inline int pop_variable(const bool checked, const bool traced)
+{
+    return pop_tok(tokVariable, checked, traced).u.variable;
+}
+
+static inline struct slice pop_lambda(const bool checked, const bool traced)
+{
+    return pop_tok(tokLambda, checked, traced).u.lambda;
+}
+
+/// Run stack operation @c op, logged as @c name.
+static inline void shuffle(void (*op)(void), const char *name, const bool traced)
+{
+    op();
+    if (traced) {
+        stack_log(name, NULL);
+    }
+}
+
+/// Run stack operation @c op on element @c n, logged as @c name.
+static inline void shuffle_n(void (*op)(size_t), size_t n, const char *name, const bool traced)
+{
+    op(n);
+    if (traced) {
+        stack_log(name, NULL);
+    }
+}
+
+/// @return bool True if @c x and @c y, of the same type, are equal.
+static bool equal(struct token x, struct token y)
+{
     switch (y.tok) {
         case tokNumber:
             return x.u.number == y.u.number;
@@ -74,36 +334,47 @@ static bool compare(void)
     return false; // UNREACHABLE
 }
 
+/// @return bool Comparison result
+static bool compare(const bool checked, const bool traced)
+{
+    struct token y = pop(checked, traced);
+    struct token x = pop(checked, traced);
+    if (checked && y.tok != x.tok) {
+        fatal("stack type mismatch");
+    }
+    return equal(x, y);
+}
+
 /// Dispatch a stack operation.
-static wchar_t dispatch(wchar_t wc)
+static inline wchar_t dispatch(wchar_t wc, const bool checked, const bool traced)
 {
     switch (wc) {
         case '`':
             fatal("unsupported code injection");
 
         case '\\':
-            stack_swap();
+            shuffle(checked ? stack_swap : stack_swap_unchecked, "swap", traced);
             break;
 
         case '$':
-            stack_dup();
+            shuffle(checked ? stack_dup : stack_dup_unchecked, "dup", traced);
             break;
 
         case '%':
-            stack_drop();
+            shuffle(checked ? stack_drop : stack_drop_unchecked, "drop", traced);
             break;
 
         case '@':
-            stack_rot();
+            shuffle(checked ? stack_rot : stack_rot_unchecked, "rot", traced);
             break;
 
         case LATIN_SMALL_LETTER_O_WITH_STROKE:
         case 'O':
-            stack_pick((size_t)stack_pop_number());
+            shuffle_n(checked ? stack_pick : stack_pick_unchecked, (size_t)pop_number(checked, traced), "pick", traced);
             break;
 
         case '=':
-            stack_push(token_make_number(truth(compare())));
+            push(token_make_number(truth(compare(checked, traced))), traced);
             break;
 
         case '+':
@@ -114,71 +385,75 @@ static wchar_t dispatch(wchar_t wc)
         case '&':
         case '|':
         {
-            int y = stack_pop_number();
-            int x = stack_pop_number();
+            int y = pop_number(checked, traced);
+            int x = pop_number(checked, traced);
             switch (wc) {
                 case '+':
-                    stack_push(token_make_number(x + y));
+                    push(token_make_number(x + y), traced);
                     break;
                 case '-':
-                    stack_push(token_make_number(x - y));
+                    push(token_make_number(x - y), traced);
                     break;
                 case '*':
-                    stack_push(token_make_number(x * y));
+                    push(token_make_number(x * y), traced);
                     break;
                 case '/':
                     if (y == 0) {
                         fatal("divide by zero");
                     }
-                    stack_push(token_make_number(x / y));
+                    push(token_make_number(divide(x, y).quot), traced);
                     break;
                 case '>':
-                    stack_push(token_make_number(truth(x > y)));
+                    push(token_make_number(truth(x > y)), traced);
                     break;
                 case '&':
-                    stack_push(token_make_number(x & y));
+                    push(token_make_number(x & y), traced);
                     break;
                 case '|':
-                    stack_push(token_make_number(x | y));
+                    push(token_make_number(x | y), traced);
                     break;
             }
             break;
         }
 
         case '_':
-            stack_push(token_make_number(-stack_pop_number()));
+            push(token_make_number(-pop_number(checked, traced)), traced);
             break;
 
         case '~':
-            stack_push(token_make_number(~stack_pop_number()));
+            push(token_make_number(~pop_number(checked, traced)), traced);
             break;
 
         case '^':
-            stack_push(token_make_number(g_.config.input()));
+            g_.effects++;
+            push(token_make_number(input()), traced);
             break;
 
         case '.':
-            g_.config.emit_number(stack_pop_number());
+            g_.effects++;
+            g_.config.emit_number(pop_number(checked, traced));
             break;
 
         case ',':
-            g_.config.emit_char((char)stack_pop_number());
+            g_.effects++;
+            g_.config.emit_char((char)pop_number(checked, traced));
             break;
 
         case LATIN_SMALL_LETTER_SHARP_S:
         case 'B':
+            g_.effects++;
             g_.config.flush();
             break;
 
         case ':':
             {
-                int v = stack_pop_variable();
-                storage_set(v, stack_pop());
+                int v = pop_variable(checked, traced);
+                storage_set(v, pop(checked, traced));
             }
             break;
 
         case ';':
-            stack_push(storage_get(stack_pop_variable()));
+            push(storage_get(pop_variable(checked, traced)), traced);
             break;
 
         default:
@@ -199,42 +474,199 @@ static void check_shift_operands(int x, int y)
     }
 }
 
-static void process(struct slice s);
+/// Run bulk operator @c wc on the top cells, a count of them above.
+static void bulk(wchar_t wc, const bool checked, const bool traced)
+{
+    // Two ranges of that many cells, for element-wise operators.
+    const size_t ranges = wc == MIDDLE_DOT || wc == CIRCLED_PLUS || wc == CIRCLED_TIMES ? 2 : 1;
+    int cells = pop_number(checked, traced);
+    size_t n;
+    struct token *cell;
+    int result;
+
+    if (cells < 0) {
+        fatal("negative cell count");
+    }
+    n = (size_t)cells;
+
+    // Each cell counts, so that the limit bounds the work done.
+    count(n);
+
+    if (wc == HORIZONTAL_ELLIPSIS) {
+        stack_fill(pop(checked, traced), n);
+        if (traced) {
+            stack_log("fill", NULL);
+        }
+        return;
+    }
+
+    stack_access(ranges * n);
+    cell = stack_span(ranges * n);
+
+    // One pass over the tags, rather than a check of each cell as it is popped.
+    if (checked && !vector_numbers(cell, ranges * n)) {
+        fatal("stack type mismatch");
+    }
+
+    switch (wc) {
+        case N_ARY_SUMMATION:
+            result = vector_sum(cell, n);
+            break;
+
+        case LOGICAL_AND:
+        case LOGICAL_OR:
+            if (n == 0) {
+                fatal("empty range");
+            }
+            result = wc == LOGICAL_AND ? vector_min(cell, n) : vector_max(cell, n);
+            break;
+
+        case MIDDLE_DOT:
+            result = vector_dot(cell, &cell[n], n);
+            break;
+
+        default:
+            if (wc == CIRCLED_PLUS) {
+                vector_add(cell, &cell[n], n);
+            } else {
+                vector_mul(cell, &cell[n], n);
+            }
+            stack_discard(n);
+            if (traced) {
+                stack_log(wc == CIRCLED_PLUS ? "add" : "mul", NULL);
+            }
+            return;
+    }
+
+    stack_discard(ranges * n);
+    push(token_make_number(result), traced);
+}
+
+/// Bytes passed to the host at once by the bulk I/O operators.
+#define BULK_IO 256
+
+/// Push @c len bytes at @c buf as cells, counting each.
+static void push_bytes(const char *buf, size_t len)
+{
+    count(len);
+    for (size_t i = 0; i < len; ++i) {
+        stack_push(token_make_number((unsigned char)buf[i]));
+    }
+}
+
+/// Read up to @c cells bytes onto the stack, up to and including @c delim
+/// unless it is negative, and push the number read.
+static void read_bytes(int cells, int delim, const bool traced)
+{
+    char buf[BULK_IO];
+    size_t n;
+    size_t total = 0;
+
+    if (cells < 0) {
+        fatal("negative cell count");
+    }
+
+    g_.effects++;
+
+    for (n = (size_t)cells; n; ) {
+        size_t len = n < sizeof(buf) ? n : sizeof(buf);
+        size_t got = input_string(buf, len, delim);
+
+        push_bytes(buf, got);
+        total += got;
+        n -= got;
+
+        if (got < len || (delim >= 0 && (unsigned char)buf[got - 1] == delim)) {
+            break;
+        }
+    }
+
+    if (traced) {
+        stack_log("read", NULL);
+    }
+    push(token_make_number((int)total), traced);
+}
+
+/// Write the top cells as bytes, a count of them above.
+static void write_bytes(const bool checked, const bool traced)
+{
+    int cells = pop_number(checked, traced);
+    char buf[BULK_IO];
+    size_t n;
+    const struct token *cell;
+
+    if (cells < 0) {
+        fatal("negative cell count");
+    }
+    n = (size_t)cells;
+
+    count(n);
+
+    stack_access(n);
+    cell = stack_span(n);
+
+    if (checked && !vector_numbers(cell, n)) {
+        fatal("stack type mismatch");
+    }
+
+    g_.effects++;
+
+    for (size_t i = 0; i < n; i += sizeof(buf)) {
+        size_t len = n - i < sizeof(buf) ? n - i : sizeof(buf);
+        for (size_t j = 0; j < len; ++j) {
+            buf[j] = (char)cell[i + j].u.number;
+        }
+        g_.config.emit_string(buf, len);
+    }
+
+    stack_discard(n);
+    if (traced) {
+        stack_log("write", NULL);
+    }
+}
+
+static void call(struct slice s, const bool checked);
+static void loop(struct slice cond, struct slice body, const bool checked, const bool traced);
+static int spawn(struct slice lambda, int n, const bool traced);
+static void join(int handle, const bool traced);
 
 /// Dispatch an extended operation.
-static wchar_t dispatch_extended(wchar_t wc)
+static inline wchar_t dispatch_extended(wchar_t wc, const bool checked, const bool traced)
 {
     switch (wc) {
         case POUND_SIGN:
-            stack_over();
+            shuffle(checked ? stack_over : stack_over_unchecked, "over", traced);
             break;
 
         case PER_MILLE_SIGN:
-            stack_nip();
+            shuffle(checked ? stack_nip : stack_nip_unchecked, "nip", traced);
             break;
 
         case EURO_SIGN:
-            stack_tuck();
+            shuffle(checked ? stack_tuck : stack_tuck_unchecked, "tuck", traced);
             break;
 
         case LATIN_CAPITAL_LETTER_O_WITH_STROKE:
-            stack_2dup();
+            shuffle(checked ? stack_2dup : stack_2dup_unchecked, "2dup", traced);
             break;
 
+        // Results depend on the depth of the stack, which is not part of a memo key.
         case SECTION_SIGN:
-            stack_push(token_make_number((int)stack_size()));
+            g_.effects++;
+            push(token_make_number((int)stack_size()), traced);
             break;
 
         case REGISTERED_SIGN:
-            stack_reverse();
+            g_.effects++;
+            shuffle(stack_reverse, "rev", traced);
             break;
 
         case TRADE_MARK_SIGN:
-            stack_roll((size_t)stack_pop_number());
+            shuffle_n(checked ? stack_roll : stack_roll_unchecked, (size_t)pop_number(checked, traced), "roll", traced);
             break;
 
         case NOT_EQUAL_TO:
-            stack_push(token_make_number(truth(!compare())));
+            push(token_make_number(truth(!compare(checked, traced))), traced);
             break;
 
         case '<':
@@ -245,56 +677,128 @@ static wchar_t dispatch_extended(wchar_t wc)
         case GREATER_THAN_OR_EQUAL_TO:
         case XOR:
         {
-            int y = stack_pop_number();
-            int x = stack_pop_number();
+            int y = pop_number(checked, traced);
+            int x = pop_number(checked, traced);
             switch (wc) {
                 case '<':
-                    stack_push(token_make_number(truth(x < y)));
+                    push(token_make_number(truth(x < y)), traced);
                     break;
                 case LEFT_POINTING_DOUBLE_ANGLE_QUOTATION_MARK:
                     check_shift_operands(x, y);
-                    stack_push(token_make_number(x << y));
+                    push(token_make_number(x << y), traced);
                     break;
                 case RIGHT_POINTING_DOUBLE_ANGLE_QUOTATION_MARK:
                     check_shift_operands(x, y);
-                    stack_push(token_make_number(x >> y));
+                    push(token_make_number(x >> y), traced);
                     break;
                 case DIVISION_SIGN:
                     if (y == 0) {
                         fatal("divide by zero");
                     } else {
-                        div_t d = div(x, y);
-                        stack_push(token_make_number(d.rem));
-                        stack_push(token_make_number(d.quot));
+                        div_t d = divide(x, y);
+                        push(token_make_number(d.rem), traced);
+                        push(token_make_number(d.quot), traced);
                     }
                     break;
                 case LESS_THAN_OR_EQUAL_TO:
-                    stack_push(token_make_number(truth(x <= y)));
+                    push(token_make_number(truth(x <= y)), traced);
                     break;
                 case GREATER_THAN_OR_EQUAL_TO:
-                    stack_push(token_make_number(truth(x >= y)));
+                    push(token_make_number(truth(x >= y)), traced);
                     break;
                 case XOR:
-                    stack_push(token_make_number(x ^ y));
+                    push(token_make_number(x ^ y), traced);
                     break;
             }
             break;
         }
 
         case INTEGRAL:
-            if (!stack_pop_number()) {
+            if (!pop_number(checked, traced)) {
                 fatal("assertion failed");
             }
             break;
 
+        case INVERTED_EXCLAMATION_MARK:
+            {
+                const int *cell = array_fetch((size_t)pop_number(checked, traced));
+                if (!cell) {
+                    fatal("array index out of range");
+                }
+                push(token_make_number(*cell), traced);
+            }
+            break;
+
+        case CENT_SIGN:
+            {
+                size_t index = (size_t)pop_number(checked, traced);
+                if (!array_store(index, pop_number(checked, traced))) {
+                    fatal("array index out of range");
+                }
+            }
+            break;
+
+        case INFINITY_SIGN:
+            push(token_make_number((int)array_size()), traced);
+            break;
+
+        case PILCROW_SIGN:
+            {
+                int size = pop_number(checked, traced);
+                if (size < 0 || !array_resize((size_t)size)) {
+                    fatal("array size out of range");
+                }
+            }
+            break;
+
+        case N_ARY_SUMMATION:
+        case LOGICAL_AND:
+        case LOGICAL_OR:
+        case MIDDLE_DOT:
+        case CIRCLED_PLUS:
+        case CIRCLED_TIMES:
+        case HORIZONTAL_ELLIPSIS:
+            bulk(wc, checked, traced);
+            break;
+
+        case MODIFIER_LETTER_CIRCUMFLEX_ACCENT:
+            read_bytes(pop_number(checked, traced), -1, traced);
+            break;
+
+        case CARON:
+            {
+                int cells = pop_number(checked, traced);
+                read_bytes(cells, pop_number(checked, traced), traced);
+            }
+            break;
+
+        case CEDILLA:
+            write_bytes(checked, traced);
+            break;
+
+        // Tasks write output when joined.
+        case DAGGER:
+            {
+                struct slice lambda = pop_lambda(checked, traced);
+                int n = pop_number(checked, traced);
+                g_.effects++;
+                push(token_make_number(spawn(lambda, n, traced)), traced);
+            }
+            break;
+
+        case DOUBLE_DAGGER:
+            g_.effects++;
+            join(pop_number(checked, traced), traced);
+            break;
+
         case INVERTED_QUESTION_MARK:
         {
-            struct slice false_branch = stack_pop_lambda();
-            struct slice true_branch = stack_pop_lambda();
-            if (stack_pop_number()) {
-                process(true_branch);
+            struct slice false_branch = pop_lambda(checked, traced);
+            struct slice true_branch = pop_lambda(checked, traced);
+            if (pop_number(checked, traced)) {
+                call(true_branch, checked);
             } else {
-                process(false_branch);
+                call(false_branch, checked);
             }
             break;
         }
@@ -306,55 +810,331 @@ static wchar_t dispatch_extended(wchar_t wc)
     return 0;
 }
 
-/// Process a slice of symbols.
-static void process(struct slice s)
+/// Top of stack, held by process() in a local until an operation needs the stack in memory.
+/// @note Not used while tracing, which must show every push.
+struct cache {
+    bool cached;
+    struct token tos;
+};
+
+/// Write the cached top of stack to memory.
+static inline void cache_spill(struct cache *cache)
 {
-    struct slice lambda = slice_make(NULL, 0);
-    wchar_t state = 0;
-    int number = 0;
-    wchar_t nested = 0;
-    int nesting = 0;
-    size_t width = 0;
-    mbstate_t mbstate;
-    struct slice tmp;
+    if (cache->cached) {
+        stack_push(cache->tos);
+        cache->cached = false;
+    }
+}
 
-    memset(&mbstate, 0, sizeof(mbstate));
+/// Push @c token, caching it in place of the previous top of stack.
+static inline void cache_push(struct cache *cache, struct token token, const bool traced)
+{
+    if (traced) {
+        push(token, traced);
+        return;
+    }
+    cache_spill(cache);
+    cache->tos = token;
+    cache->cached = true;
+}
 
-    tmp = g_.slice;
-    g_.slice = s;
+/// @return bool True if @c wc pushes a variable.
+static inline bool is_variable(wchar_t wc)
+{
+    return iswlower(wc) && wc != LATIN_SMALL_LETTER_O_WITH_STROKE && wc != LATIN_SMALL_LETTER_SHARP_S;
+}
 
-    for (;;) {
-        wchar_t wc;
+/// Dispatch an operation on the cached top of stack @c y, and at most one cell in memory.
+/// @note Only used without tracing, so stack operations are not logged.
+/// @return bool False if the operation needs the stack in memory.
+static inline bool dispatch_cached(struct cache *cache, wchar_t wc, const bool checked, const bool extended)
+{
+    struct token y = cache->tos;
 
-        if (g_.slice.buf + width == g_.slice.end) {
-            break;
+    if (!cache->cached) {
+        if (is_variable(wc)) {
+            cache_push(cache, token_make_variable(wc), false);
+            return true;
         }
+        return false;
+    }
 
-        g_.slice.buf += width;
+    switch (wc) {
+        case '$':
+            stack_push(y);
+            return true;
 
-        width = mbrtowc(&wc, g_.slice.buf, (size_t)(g_.slice.end - g_.slice.buf), &mbstate);
-        if (width == 0 || width > 4) {
-            fatal("bad multi-byte character");
-        }
+        case '%':
+            cache->cached = false;
+            return true;
 
-        switch (state) {
-            case 0:
-                if (iswdigit(wc)) {
-                    number = wc - '0';
-                    state = '1';
-                    log_trace(wc);
-                    continue;
+        case '\\':
+            cache->tos = pop(checked, false);
+            stack_push(y);
+            return true;
+
+        case '=':
+            {
+                struct token x = pop(checked, false);
+                if (checked && y.tok != x.tok) {
+                    fatal("stack type mismatch");
                 }
-                break;
+                cache->tos = token_make_number(truth(equal(x, y)));
+            }
+            return true;
 
-            case '1':
-                if (iswdigit(wc)) {
-                    number *= 10;
+        case '!':
+        case '?':
+        case '#':
+            if (y.tok != tokLambda) {
+                return false;
+            }
+            cache->cached = false;
+            if (wc == '!') {
+                call(y.u.lambda, checked);
+            } else if (wc == '?') {
+                if (pop_number(checked, false)) {
+                    call(y.u.lambda, checked);
+                }
+            } else {
+                loop(pop_lambda(checked, false), y.u.lambda, checked, false);
+            }
+            return true;
+
+        case ';':
+            if (y.tok != tokVariable) {
+                return false;
+            }
+            cache->tos = storage_get(y.u.variable);
+            return true;
+
+        case ':':
+            if (y.tok != tokVariable) {
+                return false;
+            }
+            storage_set(y.u.variable, pop(checked, false));
+            cache->cached = false;
+            return true;
+    }
+
+    if (is_variable(wc)) {
+        cache_push(cache, token_make_variable(wc), false);
+        return true;
+    }
+
+    // Remaining operations take numbers.
+    if (y.tok != tokNumber) {
+        return false;
+    }
+
+    switch (wc) {
+        case '_':
+            cache->tos.u.number = -y.u.number;
+            return true;
+
+        case '~':
+            cache->tos.u.number = ~y.u.number;
+            return true;
+
+        case '.':
+            g_.effects++;
+            cache->cached = false;
+            g_.config.emit_number(y.u.number);
+            return true;
+
+        case ',':
+            g_.effects++;
+            cache->cached = false;
+            g_.config.emit_char((char)y.u.number);
+            return true;
+
+        case '+':
+        case '-':
+        case '*':
+        case '/':
+        case '>':
+        case '&':
+        case '|':
+            {
+                int x = pop_number(checked, false);
+                switch (wc) {
+                    case '+':
+                        cache->tos.u.number = x + y.u.number;
+                        break;
+                    case '-':
+                        cache->tos.u.number = x - y.u.number;
+                        break;
+                    case '*':
+                        cache->tos.u.number = x * y.u.number;
+                        break;
+                    case '/':
+                        if (y.u.number == 0) {
+                            fatal("divide by zero");
+                        }
+                        cache->tos.u.number = divide(x, y.u.number).quot;
+                        break;
+                    case '>':
+                        cache->tos.u.number = truth(x > y.u.number);
+                        break;
+                    case '&':
+                        cache->tos.u.number = x & y.u.number;
+                        break;
+                    case '|':
+                        cache->tos.u.number = x | y.u.number;
+                        break;
+                }
+            }
+            return true;
+    }
+
+    if (!extended) {
+        return false;
+    }
+
+    switch (wc) {
+        case NOT_EQUAL_TO:
+            {
+                struct token x = pop(checked, false);
+                if (checked && x.tok != tokNumber) {
+                    fatal("stack type mismatch");
+                }
+                cache->tos.u.number = truth(x.u.number != y.u.number);
+            }
+            return true;
+
+        case '<':
+            cache->tos.u.number = truth(pop_number(checked, false) < y.u.number);
+            return true;
+
+        case LESS_THAN_OR_EQUAL_TO:
+            cache->tos.u.number = truth(pop_number(checked, false) <= y.u.number);
+            return true;
+
+        case GREATER_THAN_OR_EQUAL_TO:
+            cache->tos.u.number = truth(pop_number(checked, false) >= y.u.number);
+            return true;
+
+        case XOR:
+            cache->tos.u.number = pop_number(checked, false) ^ y.u.number;
+            return true;
+
+        case DIVISION_SIGN:
+            {
+                int x = pop_number(checked, false);
+                div_t d;
+                if (y.u.number == 0) {
+                    fatal("divide by zero");
+                }
+                d = divide(x, y.u.number);
+                stack_push(token_make_number(d.rem));
+                cache->tos.u.number = d.quot;
+            }
+            return true;
+
+        case INVERTED_EXCLAMATION_MARK:
+            {
+                const int *cell = array_fetch((size_t)y.u.number);
+                if (!cell) {
+                    fatal("array index out of range");
+                }
+                cache->tos.u.number = *cell;
+            }
+            return true;
+    }
+
+    return false;
+}
+
+/// Find the string literal whose contents start at @c pos, within the current slice.
+/// @return bool False if it does not end there.
+static bool string_from(const char *pos, struct slice *string)
+{
+    const struct slice *known = program_string(g_.program, pos);
+    const char *end;
+
+    if (known) {
+        *string = *known;
+        return true;
+    }
+
+    // Lambdas of earlier pieces of a program are not in the strings of this one.
+    end = (const char *)memchr(pos, '"', (size_t)(g_.slice.end - pos));
+    if (!end) {
+        return false;
+    }
+    *string = slice_make(pos, (size_t)(end - pos));
+    return true;
+}
+
+/// @return slice String literal whose contents start at @c pos, within the current slice.
+static struct slice string_at(const char *pos)
+{
+    struct slice string;
+
+    if (!string_from(pos, &string)) {
+        fatal("unterminated statement");
+    }
+    return string;
+}
+
+/// Process a slice of symbols.
+/// @note Specialized on the constants @c extended, for extension operators, and
+/// @c traced, for logging symbols and stack operations, see @c VARIANTS.
+static inline __attribute__((always_inline)) void process(struct slice s, const bool checked, const bool extended, const bool traced)
+{
+    struct slice lambda = slice_make(NULL, 0);
+    wchar_t state = 0;
+    int number = 0;
+    wchar_t nested = 0;
+    int nesting = 0;
+    size_t width = 0;
+    mbstate_t mbstate;
+    struct slice tmp;
+    struct cache cache;
+
+    memset(&mbstate, 0, sizeof(mbstate));
+
+    cache.cached = false;
+
+    tmp = g_.slice;
+    g_.slice = s;
+
+    for (;;) {
+        wchar_t wc;
+
+        if (g_.slice.buf + width == g_.slice.end) {
+            break;
+        }
+
+        g_.slice.buf += width;
+
+        width = mbrtowc(&wc, g_.slice.buf, (size_t)(g_.slice.end - g_.slice.buf), &mbstate);
+        if (width == 0 || width > 4) {
+            fatal("bad multi-byte character");
+        }
+
+        switch (state) {
+            case 0:
+                if (iswdigit(wc)) {
+                    number = wc - '0';
+                    state = '1';
+                    if (traced) {
+                        log_trace(wc);
+                    }
+                    continue;
+                }
+                break;
+
+            case '1':
+                if (iswdigit(wc)) {
+                    number *= 10;
                     number += wc - '0';
-                    log_trace(wc);
+                    if (traced) {
+                        log_trace(wc);
+                    }
                     continue;
                 }
-                stack_push(token_make_number(number));
+                cache_push(&cache, token_make_number(number), traced);
                 state = 0;
                 break;
 
@@ -365,15 +1145,34 @@ static void process(struct slice s)
                 continue;
 
             case '\'':
-                stack_push(token_make_number(wc));
+                cache_push(&cache, token_make_number(wc), traced);
                 state = 0;
                 continue;
 
             case '"':
+                // Only strings that do not end, which fail before their end.
                 if (wc == '"') {
-                    state = 0;
+                    state = 0; // UNREACHABLE
                 } else {
-                    g_.config.emit_wchar(wc);
+                    g_.effects++;
+                    g_.config.emit_string(g_.slice.buf, width);
+                }
+                continue;
+
+            case DIAERESIS:
+                {
+                    struct slice string;
+                    if (wc != '"') {
+                        fatal("string expected");
+                    }
+                    string = string_at(g_.slice.buf + width);
+                    cache_spill(&cache);
+                    push_bytes(string.buf, slice_length(string));
+                    push(token_make_number((int)slice_length(string)), traced);
+                    // Resume at closing quote.
+                    g_.slice.buf = string.end;
+                    width = 1;
+                    state = 0;
                 }
                 continue;
 
@@ -400,7 +1199,7 @@ static void process(struct slice s)
                     ++nesting;
                 } else if (wc == ']') {
                     if (--nesting == 0) {
-                        stack_push(token_make_lambda(lambda));
+                        cache_push(&cache, token_make_lambda(lambda), traced);
                         state = 0;
                     }
                 }
@@ -414,58 +1213,88 @@ static void process(struct slice s)
         }
 
         switch (wc) {
+            case '"':
+            {
+                struct slice string;
+                if (string_from(g_.slice.buf + width, &string)) {
+                    g_.effects++;
+                    g_.config.emit_string(string.buf, slice_length(string));
+                    // Resume at closing quote.
+                    g_.slice.buf = string.end;
+                    width = 1;
+                    continue;
+                }
+                state = wc;
+                continue;
+            }
+
             case '{':
             case '\'':
-            case '"':
             case '[':
                 state = wc;
                 continue;
 
+            // Bytes of the string that follows are pushed, rather than emitted.
+            case DIAERESIS:
+                if (extended) {
+                    state = wc;
+                    continue;
+                }
+                break;
+
             case ']':
             case '}':
                 fatal("unbalanced symbol");
         }
 
-        log_trace(wc);
+        if (traced) {
+            log_trace(wc);
+        }
+
+        // Counted as count() does, but with the stack whole when progress is reported.
+        if (++g_.operations > g_.checkpoint) {
+            cache_spill(&cache);
+            checkpoint();
+        }
+
+        if (!traced && dispatch_cached(&cache, wc, checked, extended)) {
+            continue;
+        }
+
+        cache_spill(&cache);
 
         switch (wc) {
             case '!':
-                process(stack_pop_lambda());
+                call(pop_lambda(checked, traced), checked);
                 break;
 
             case '?':
                 {
-                    struct slice body = stack_pop_lambda();
-                    if (stack_pop_number()) {
+                    struct slice body = pop_lambda(checked, traced);
+                    if (pop_number(checked, traced)) {
                         // True is non-zero.
-                        process(body);
+                        call(body, checked);
                     }
                 }
                 break;
 
             case '#':
                 {
-                    struct slice body = stack_pop_lambda();
-                    struct slice cond = stack_pop_lambda();
-                    for (;;) {
-                        process(cond);
-                        if (!stack_pop_number()) {
-                            break;
-                        }
-                        process(body);
-                    }
+                    struct slice body = pop_lambda(checked, traced);
+                    struct slice cond = pop_lambda(checked, traced);
+                    loop(cond, body, checked, traced);
                 }
                 break;
 
             default:
-                wc = dispatch(wc);
+                wc = dispatch(wc, checked, traced);
 
-                if (g_.config.extensions) {
-                    wc = dispatch_extended(wc);
+                if (extended) {
+                    wc = dispatch_extended(wc, checked, traced);
                 }
 
                 if (iswlower(wc)) {
-                    stack_push(token_make_variable(wc));
+                    push(token_make_variable(wc), traced);
 
                 } else if (wc) {
                     fatal("unknown symbol");
@@ -479,63 +1308,1338 @@ static void process(struct slice s)
             break;
 
         case '1':
-            stack_push(token_make_number(number));
+            cache_push(&cache, token_make_number(number), traced);
             break;
 
         default:
             fatal("unterminated statement");
     }
 
+    cache_spill(&cache);
+
     g_.slice = tmp;
 }
 
-int interpret(struct config config)
+/// Instances of process() as X(name, extended, traced), chosen once per run.
+/// Without tracing, they contain no logging at all.
+#define VARIANTS(X) \
+    X(plain, false, false) \
+    X(extended, true, false) \
+    X(traced, false, true) \
+    X(extended_traced, true, true)
+
+#define X(name, extended, traced) \
+    static void process_checked_##name(struct slice s) \
+    { \
+        process(s, true, extended, traced); \
+    } \
+    static void process_unchecked_##name(struct slice s) \
+    { \
+        process(s, false, extended, traced); \
+    }
+VARIANTS(X)
+#undef X
+
+/// Checked and unchecked instances of process().
+struct variant {
+    void (*checked)(struct slice s);
+    void (*unchecked)(struct slice s);
+};
+
+/// Indexed by extended + 2 * traced.
+static const struct variant variants[] = {
+#define X(name, extended, traced) { process_checked_##name, process_unchecked_##name },
+    VARIANTS(X)
+#undef X
+};
+
+/// @return bool True if each variable of @c bound (bit zero is @c a) holds its bound lambda.
+/// @note Until its assignment has run, a bound variable holds some other value.
+static bool holds(unsigned bound)
 {
-    int r = 1;
+    for (int v = 'a'; bound; ++v, bound >>= 1) {
+        if (bound & 1) {
+            struct token token = storage_get(v);
+            if (token.tok != tokLambda || token.u.lambda.buf != program_binding(g_.program, v)->slice.buf) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
 
-    g_.config = config;
-    g_.slice = slice_make(NULL, 0);
+/// @return bool True if the verifier has proven @c effect safe for the current stack.
+static bool proven(const struct effect *effect)
+{
+    if (!effect || !effect->proven || stack_size() < effect->in || !holds(effect->bound)) {
+        return false;
+    }
 
-    if (setjmp(g_.env) == 0) {
-        int v;
+    // Unchecked operations do not record accessed cells, see memoize().
+    stack_access(effect->in);
 
-        if (config.argc == 0) {
-            fatal("too few arguments");
+    for (size_t k = 0; k < effect->in; ++k) {
+        if (effect->in_type[k] != typeAny && stack_peek(k).tok != (enum tok)effect->in_type[k]) {
+            return false;
         }
+    }
 
-        // Skip filename.
-        --config.argc;
-        ++config.argv;
+    return true;
+}
 
-        if (config.argc > 25) {
-            // a = argc, b..z = args
-            fatal("too many arguments");
-        }
+/// @return int Result of binary operator @c wc of register code.
+static int binary(wchar_t wc, struct token x, struct token y)
+{
+    int a = x.u.number;
+    int b = y.u.number;
+
+    switch (wc) {
+        case '=':
+            return truth(equal(x, y));
+        case NOT_EQUAL_TO:
+            return truth(!equal(x, y));
+        case '+':
+            return a + b;
+        case '-':
+            return a - b;
+        case '*':
+            return a * b;
+        case '/':
+            if (b == 0) {
+                fatal("divide by zero");
+            }
+            return divide(a, b).quot;
+        case '>':
+            return truth(a > b);
+        case '&':
+            return a & b;
+        case '|':
+            return a | b;
+        case '<':
+            return truth(a < b);
+        case LEFT_POINTING_DOUBLE_ANGLE_QUOTATION_MARK:
+            check_shift_operands(a, b);
+            return a << b;
+        case RIGHT_POINTING_DOUBLE_ANGLE_QUOTATION_MARK:
+            check_shift_operands(a, b);
+            return a >> b;
+        case LESS_THAN_OR_EQUAL_TO:
+            return truth(a <= b);
+        case GREATER_THAN_OR_EQUAL_TO:
+            return truth(a >= b);
+    }
+    return a ^ b;
+}
+
+/// @return size_t Index of @c lambda, the program itself following the lambdas.
+static size_t index_of(const struct lambda *lambda)
+{
+    if (lambda == &g_.program->top) {
+        return g_.program->count;
+    }
+    return (size_t)(lambda - g_.program->lambda);
+}
 
-        stack_init(fatal, g_.config.log_stack ? log_stack_operation : NULL);
+/// Run register code @c ir on registers @c reg, taking its inputs from the stack
+/// and pushing its outputs.  With @c again, @c reg holds the results of a previous
+/// run, so invariant instructions reading none of the variables @c stores are skipped.
+static void perform(const struct ir *ir, struct token *reg, bool again, unsigned stores)
+{
+    const struct token *top;
+    struct slice tmp;
+    size_t base;
+
+    top = stack_top(ir->in);
+    for (size_t k = 0; k < ir->in; ++k) {
+        reg[k] = top[ir->in - 1 - k];
+    }
+    for (size_t k = 0; k < ir->in; ++k) {
+        stack_drop_unchecked();
+    }
+    base = stack_size();
 
-        storage_clear();
+    tmp = g_.slice;
 
-        v = 'a';
-        storage_set(v++, token_make_number(config.argc));
+    for (size_t i = 0; i < ir->count; ++i) {
+        const struct ir_insn *insn = &ir->insn[i];
 
-        while (config.argc-- > 0) {
-            const char *arg = *config.argv++;
-            char *end = NULL;
-            storage_set(v++, token_make_number((int)strtol(arg, &end, 0)));
-            if (end && end == arg) {
-                fatal("non-numeric argument");
-            }
+        if (again && insn->invariant && !(insn->reads & stores)) {
+            continue;
         }
 
-        process(slice_make(config.str, strlen(config.str)));
+        switch (insn->op) {
+            case irConstant:
+                reg[insn->dst] = insn->constant;
+                break;
 
-        if (!stack_empty()) {
-            fatal("stack not empty");
+            case irBinary:
+                g_.slice.buf = insn->pos;
+                reg[insn->dst] = token_make_number(binary(insn->wc, reg[insn->x], reg[insn->y]));
+                break;
+
+            case irUnary:
+                if (insn->wc == '_') {
+                    reg[insn->dst] = token_make_number(-reg[insn->x].u.number);
+                } else {
+                    reg[insn->dst] = token_make_number(~reg[insn->x].u.number);
+                }
+                break;
+
+            case irDivide:
+                if (reg[insn->y].u.number == 0) {
+                    g_.slice.buf = insn->pos;
+                    fatal("divide by zero");
+                } else {
+                    div_t d = divide(reg[insn->x].u.number, reg[insn->y].u.number);
+                    reg[insn->dst] = token_make_number(d.rem);
+                    reg[insn->dst + 1] = token_make_number(d.quot);
+                }
+                break;
+
+            case irDepth:
+                g_.effects++;
+                reg[insn->dst] = token_make_number((int)(base + insn->x));
+                break;
+
+            case irLoad:
+                reg[insn->dst] = storage_get(reg[insn->x].u.variable);
+                break;
+
+            case irStore:
+                storage_set(reg[insn->y].u.variable, reg[insn->x]);
+                break;
+
+            case irInput:
+                g_.effects++;
+                reg[insn->dst] = token_make_number(input());
+                break;
+
+            case irEmitNumber:
+                g_.effects++;
+                g_.config.emit_number(reg[insn->x].u.number);
+                break;
+
+            case irEmitChar:
+                g_.effects++;
+                g_.config.emit_char((char)reg[insn->x].u.number);
+                break;
+
+            case irEmitString:
+                g_.effects++;
+                g_.config.emit_string(insn->string.buf, slice_length(insn->string));
+                break;
+
+            case irFlush:
+                g_.effects++;
+                g_.config.flush();
+                break;
+
+            case irAssert:
+                if (!reg[insn->x].u.number) {
+                    g_.slice.buf = insn->pos;
+                    fatal("assertion failed");
+                }
+                break;
         }
+    }
 
-        r = 0;
+    for (size_t j = 0; j < ir->outs; ++j) {
+        stack_push(reg[ir->out[j]]);
+    }
+
+    g_.slice = tmp;
+}
+
+/// Run @c s as register code, if it is the whole of @c lambda and was promoted.
+/// The stack is only read for the inputs and written with the outputs.
+/// @return bool False if @c s must be processed, including when the operation limit
+/// would be exceeded within it, so that the error is reported at its symbol.
+static bool execute(struct slice s, const struct lambda *lambda)
+{
+    const struct ir *ir;
+    struct token reg[IR_REGISTERS];
+
+    if (!g_.config.registers || !lambda || s.buf != lambda->slice.buf || s.end != lambda->slice.end) {
+        return false;
     }
 
+    ir = &g_.tier.ir[index_of(lambda)];
+    if (!ir->valid) {
+        return false;
+    }
+
+    if (exceeds(ir->operations)) {
+        return false;
+    }
+
+    // Straight-line code runs each operator once.
+    count(ir->operations);
+    g_.registers++;
+
+    perform(ir, reg, false, 0);
+
+    return true;
+}
+
+/// Process @c s, which is all or part of @c lambda.
+/// @note Lambdas called from proven code are themselves proven.
+static void enter(struct slice s, const struct lambda *lambda, const bool checked)
+{
+    if (!checked || (lambda && proven(&lambda->effect))) {
+        if (!execute(s, lambda)) {
+            g_.variant->unchecked(s);
+        }
+    } else {
+        g_.variant->checked(s);
+    }
+}
+
+/// Call pure @c lambda, reusing the result of an earlier call with the same inputs.
+/// The inputs are the cells accessed by the call, found from the stack low-water mark.
+static void memoize(struct slice s, const struct lambda *lambda)
+{
+    size_t index = (size_t)(lambda - g_.program->lambda);
+    size_t depth = stack_size();
+    size_t saved = depth < MEMO_INPUTS ? depth : MEMO_INPUTS;
+    size_t in = g_.memo.arity[index];
+    unsigned long version = storage_version();
+    unsigned long effects = g_.effects;
+    struct token input[MEMO_INPUTS];
+    size_t outer;
+    size_t low;
+
+    // Assume the inputs of the previous call.
+    if (in <= saved) {
+        const struct memo_entry *entry = memo_lookup(&g_.memo, index, version, in, stack_top(in));
+        if (entry) {
+            g_.memo.hits++;
+            stack_access(in);
+            for (size_t i = 0; i < in; ++i) {
+                stack_drop_unchecked();
+            }
+            for (size_t j = 0; j < entry->out; ++j) {
+                stack_push(entry->token[in + j]);
+            }
+            return;
+        }
+    }
+
+    g_.memo.misses++;
+
+    // An empty stack has no top to copy from.
+    if (saved) {
+        memcpy(input, stack_top(saved), saved * sizeof(struct token));
+    }
+
+    outer = stack_low();
+    stack_set_low(depth);
+
+    enter(s, lambda, true);
+
+    low = stack_low();
+    stack_set_low(low < outer ? low : outer);
+
+    in = depth - low;
+    g_.memo.arity[index] = in;
+
+    // Calls of lambdas taken from the stack may still perform I/O or write variables.
+    if (in <= saved && storage_version() == version && g_.effects == effects && stack_size() - low <= MEMO_OUTPUTS) {
+        size_t out = stack_size() - low;
+        memo_insert(&g_.memo, index, version, in, &input[saved - in], out, stack_top(out));
+    }
+}
+
+/// Record a call of lambda @c s for sample().
+static inline void frame_enter(struct slice s)
+{
+    if (g_.frames < SAMPLE_DEPTH) {
+        g_.frame[g_.frames] = s.buf;
+    }
+    g_.frames++;
+}
+
+static inline void frame_leave(void)
+{
+    g_.frames--;
+}
+
+/// Call lambda @c s.
+static void call(struct slice s, const bool checked)
+{
+    const bool memo = g_.memo.capacity != 0;
+    const struct lambda *lambda = checked || memo || g_.config.registers ? program_lookup(g_.program, s) : NULL;
+
+    frame_enter(s);
+
+    // Calls are counted only when there is register code to promote to.
+    if (lambda && g_.config.registers) {
+        tier_call(&g_.tier, g_.program, index_of(lambda));
+    }
+
+    // Proven lambdas are memoized too, their inputs found from their verified effect.
+    if (lambda && lambda->pure && memo) {
+        memoize(s, lambda);
+    } else {
+        enter(s, lambda, checked);
+    }
+
+    frame_leave();
+}
+
+/// Run a counted loop, holding the induction variable and bound in locals.
+/// They are reloaded from storage only if the body writes any variable.
+/// @return bool False if the loop is not counted, or must continue as a normal loop,
+/// including when the operation limit would be exceeded within the condition, so that
+/// the error is reported at its symbol.
+static bool counted(struct slice cond, struct slice body, const bool checked, const bool traced)
+{
+    const struct lambda *c = program_lookup(g_.program, cond);
+    const struct lambda *b = program_lookup(g_.program, body);
+    enum relation relation;
+    struct operand bound;
+    struct slice increment;
+    struct token i;
+    struct token n;
+
+    // Tracing must show every symbol.
+    if (traced) {
+        return false;
+    }
+
+    if (!c || !b || !counted_match(&c->counted, &b->counted, &relation, &bound)) {
+        return false;
+    }
+
+    g_.tier.loops++;
+
+    increment = slice_make(b->counted.prefix.end, (size_t)(body.end - b->counted.prefix.end));
+
+    i = storage_get(b->counted.var);
+    n = bound.variable ? storage_get(bound.value) : token_make_number(bound.value);
+
+    for (;;) {
+        unsigned long version;
+
+        if (i.tok != tokNumber || n.tok != tokNumber || exceeds(c->counted.operations)) {
+            return false;
+        }
+
+        count(c->counted.operations);
+
+        if (!counted_test(relation, i.u.number, n.u.number)) {
+            return true;
+        }
+
+        count(1);
+
+        version = storage_version();
+
+        frame_enter(body);
+        enter(b->counted.prefix, b, checked);
+        frame_leave();
+
+        // Likewise, the increment is processed if the limit would be exceeded within it.
+        if (storage_version() == version && !exceeds(COUNTED_INCREMENT_OPERATIONS)) {
+            count(COUNTED_INCREMENT_OPERATIONS);
+            i.u.number++;
+            storage_set(b->counted.var, i);
+        } else {
+            frame_enter(body);
+            enter(increment, b, checked);
+            frame_leave();
+            i = storage_get(b->counted.var);
+            if (bound.variable) {
+                n = storage_get(bound.value);
+            }
+        }
+    }
+}
+
+/// Run a loop whose condition and body are both register code, keeping the registers
+/// of each between iterations, so that loads and lambdas invariant in the loop are run
+/// once.  The variables the loop may store are known from its register code.
+/// @return bool False if the loop is not register code, or must continue as a normal
+/// loop from its condition, including when the operation limit would be exceeded within it.
+static bool iterate(struct slice cond, struct slice body, const bool checked)
+{
+    const struct lambda *c = program_lookup(g_.program, cond);
+    const struct lambda *b = program_lookup(g_.program, body);
+    struct token creg[IR_REGISTERS];
+    struct token breg[IR_REGISTERS];
+    const struct ir *cir;
+    const struct ir *bir;
+    unsigned stores;
+    bool again = false;
+
+    if (!g_.config.registers || !c) {
+        return false;
+    }
+
+    tier_promote(&g_.tier, g_.program, index_of(c));
+    tier_promote(&g_.tier, g_.program, index_of(b));
+    cir = &g_.tier.ir[index_of(c)];
+    bir = &g_.tier.ir[index_of(b)];
+    if (!cir->valid || !bir->valid) {
+        return false;
+    }
+
+    g_.tier.loops++;
+    stores = cir->stores | bir->stores;
+
+    for (;;) {
+        if ((checked && !proven(&c->effect)) || exceeds(cir->operations)) {
+            return false;
+        }
+
+        count(cir->operations);
+        g_.registers++;
+        frame_enter(cond);
+        perform(cir, creg, again, stores);
+        frame_leave();
+
+        if (!pop_number(checked, false)) {
+            return true;
+        }
+        count(1);
+
+        // A body no longer proven is interpreted, and may store any variable.
+        if ((checked && !proven(&b->effect)) || exceeds(bir->operations)) {
+            again = false;
+            call(body, checked);
+        } else {
+            count(bir->operations);
+            g_.registers++;
+            frame_enter(body);
+            perform(bir, breg, again, stores);
+            frame_leave();
+            again = true;
+        }
+    }
+}
+
+/// Run while loop.
+static void loop(struct slice cond, struct slice body, const bool checked, const bool traced)
+{
+    const struct lambda *b = program_lookup(g_.program, body);
+    bool tried = false;
+
+    for (;;) {
+        // A hot loop continues in counted form, or as register code, from its entry or
+        // from the back edge at which it is promoted, as the variables hold all of its state.
+        if (!tried && b && tier_edge(&g_.tier, index_of(b))) {
+            tried = true;
+            if (counted(cond, body, checked, traced) || iterate(cond, body, checked)) {
+                return;
+            }
+        }
+
+        call(cond, checked);
+        if (!pop_number(checked, traced)) {
+            break;
+        }
+        count(1);
+        call(body, checked);
+    }
+}
+
+/// Prepare the interpreter of this thread to run @c program.
+static void begin(struct config config, const struct program *program)
+{
+    const bool traced = config.log_trace || config.log_stack;
+
+    g_.config = config;
+    g_.program = program;
+    g_.slice = slice_make(NULL, 0);
+    g_.operations = 0;
+    g_.progress = config.log_progress ? config.progress_interval : ULONG_MAX;
+    g_.effects = 0;
+    g_.registers = 0;
+    g_.frames = 0;
+    g_.job = NULL;
+    g_.jobs = 0;
+    g_.self = NULL;
+    g_.vm = NULL;
+
+    // Tracing must show every symbol.
+    memo_init(&g_.memo, traced ? 0 : config.memo, program->count);
+    g_.config.registers = config.registers && !traced;
+    tier_init(&g_.tier, config.tier_threshold, program);
+    g_.variant = &variants[config.extensions + 2 * traced];
+    schedule();
+}
+
+/// Task started by spawn, with copies of what it was given, and its results.
+struct job {
+    /// Host interface and program of the spawning interpreter.
+    struct config config;
+    const struct program *program;
+
+    struct slice lambda;
+
+    /// Stack cells, bottom first, given to the task, and then left by it.
+    struct token *cell;
+    size_t cells;
+
+    struct token variable[26];
+
+    int *array;
+    size_t size;
+
+    /// Operations lent by the spawning interpreter, or zero without a limit.
+    unsigned long lent;
+
+    /// Output, written by join.
+    char *output;
+    size_t length;
+    size_t capacity;
+
+    unsigned long operations;
+
+    /// Error, reported by join.
+    const char *pos;
+    const char *msg;
+
+    /// Contents of the program and of the lambdas given to the task, which it may call.
+    const char **held;
+    size_t holds;
+
+    struct task *task;
+};
+
+static void job_free(struct job *job)
+{
+    free(job->held);
+    free(job->cell);
+    free(job->array);
+    free(job->output);
+    free(job);
+}
+
+static void job_emit_string(const char *buf, size_t len)
+{
+    struct job *job = g_.self;
+
+    if (job->length + len > job->capacity) {
+        job->capacity = 2 * (job->length + len);
+        job->output = (char *)realloc(job->output, job->capacity);
+    }
+    memcpy(&job->output[job->length], buf, len);
+    job->length += len;
+}
+
+static void job_emit_number(int number)
+{
+    char buf[FORMAT_NUMBER_MAX];
+    job_emit_string(buf, format_number(buf, number));
+}
+
+static void job_emit_char(char c)
+{
+    job_emit_string(&c, 1);
+}
+
+/// Tasks read no input, so that their results do not depend on the order they run in.
+static int job_input(void)
+{
+    return -1;
+}
+
+static size_t job_input_string(char *buf, size_t len, int delim)
+{
+    (void)buf;
+    (void)len;
+    (void)delim;
+    return 0;
+}
+
+static void job_flush(void)
+{
+}
+
+static void job_fatal(const struct config config, const char *pos, const char *msg)
+{
+    (void)config;
+    g_.self->pos = pos;
+    g_.self->msg = msg;
+}
+
+/// Wait for the tasks of @c job that were not joined, and release them.
+static void jobs_free(struct job **job, size_t jobs)
+{
+    for (size_t i = 0; i < jobs; ++i) {
+        if (job[i]) {
+            task_join(job[i]->task);
+            job_free(job[i]);
+        }
+    }
+    free(job);
+}
+
+/// Wait for tasks that were not joined, and release the interpreter of this thread.
+static void end(void)
+{
+    jobs_free(g_.job, g_.jobs);
+
+    memo_free(&g_.memo);
+
+    tier_free(&g_.tier);
+
+    array_clear();
+
+    stack_free();
+}
+
+/// Run task @c arg on this thread, setting aside the interpreter it may be running.
+static void work(void *arg)
+{
+    struct job *job = (struct job *)arg;
+    struct interpreter *outer = (struct interpreter *)malloc(sizeof(struct interpreter));
+    struct stack *stack = stack_detach();
+    struct storage *storage = storage_detach();
+    struct array *array = array_detach();
+    struct config config = job->config;
+
+    *outer = g_;
+
+    // Operations of tasks would interleave in a trace.
+    config.limit = job->lent;
+    config.fatal = job_fatal;
+    config.log_trace = NULL;
+    config.log_stats = NULL;
+    config.log_progress = NULL;
+    config.log_stack = NULL;
+    config.emit_number = job_emit_number;
+    config.emit_string = job_emit_string;
+    config.emit_char = job_emit_char;
+    config.input = job_input;
+    config.input_string = job_input_string;
+    config.flush = job_flush;
+
+    begin(config, job->program);
+    g_.self = job;
+
+    if (setjmp(g_.env) == 0) {
+        stack_init(fatal, NULL);
+
+        for (int v = 0; v < 26; ++v) {
+            storage_set('a' + v, job->variable[v]);
+        }
+
+        array_resize(job->size);
+        for (size_t i = 0; i < job->size; ++i) {
+            array_store(i, job->array[i]);
+        }
+
+        for (size_t i = 0; i < job->cells; ++i) {
+            stack_push(job->cell[i]);
+        }
+
+        call(job->lambda, true);
+
+        job->cells = stack_size();
+        job->cell = (struct token *)realloc(job->cell, (job->cells ? job->cells : 1) * sizeof(struct token));
+        memcpy(job->cell, stack_top(job->cells), job->cells * sizeof(struct token));
+    }
+
+    job->operations = g_.operations;
+
+    end();
+
+    g_ = *outer;
+    free(outer);
+
+    array_attach(array);
+    storage_attach(storage);
+    stack_attach(stack);
+}
+
+/// Start a task calling @c lambda on the top @c n cells, which it takes from the stack,
+/// and on copies of the variables and array.
+/// @return int Handle of the task, for join.
+static int spawn(struct slice lambda, int n, const bool traced)
+{
+    struct job *job;
+
+    if (n < 0) {
+        fatal("negative cell count");
+    }
+
+    stack_access((size_t)n);
+
+    // A task must be lent operations, as zero would mean no limit.
+    if (g_.config.limit && g_.operations == g_.config.limit) {
+        fatal("operation limit exceeded");
+    }
+
+    job = (struct job *)calloc(1, sizeof(struct job));
+    job->config = g_.config;
+    job->program = g_.program;
+    job->lambda = lambda;
+
+    job->cells = (size_t)n;
+    job->cell = (struct token *)malloc((job->cells ? job->cells : 1) * sizeof(struct token));
+    memcpy(job->cell, stack_top(job->cells), job->cells * sizeof(struct token));
+    for (size_t i = 0; i < job->cells; ++i) {
+        stack_drop_unchecked();
+    }
+    if (traced) {
+        stack_log("spawn", NULL);
+    }
+
+    for (int v = 0; v < 26; ++v) {
+        job->variable[v] = storage_get('a' + v);
+    }
+
+    // What the task may call, for programs run piecewise to keep while it runs.
+    job->held = (const char **)malloc((job->cells + 28) * sizeof(const char *));
+    job->held[job->holds++] = g_.program->source.buf;
+    job->held[job->holds++] = lambda.buf;
+    for (size_t i = 0; i < job->cells; ++i) {
+        if (job->cell[i].tok == tokLambda) {
+            job->held[job->holds++] = job->cell[i].u.lambda.buf;
+        }
+    }
+    for (int v = 0; v < 26; ++v) {
+        if (job->variable[v].tok == tokLambda) {
+            job->held[job->holds++] = job->variable[v].u.lambda.buf;
+        }
+    }
+
+    job->size = array_size();
+    job->array = (int *)malloc((job->size ? job->size : 1) * sizeof(int));
+    if (job->size) {
+        memcpy(job->array, array_fetch(0), job->size * sizeof(int));
+    }
+
+    // Lend half of the operations left, returned on join, so that tasks together
+    // stay within the limit.  The spawn itself was counted, so the limit stays non-zero.
+    if (g_.config.limit) {
+        job->lent = (g_.config.limit - g_.operations + 1) / 2;
+        g_.config.limit -= job->lent;
+        schedule();
+    }
+
+    g_.job = (struct job **)realloc(g_.job, (g_.jobs + 1) * sizeof(struct job *));
+    g_.job[g_.jobs++] = job;
+
+    job->task = task_spawn(work, job);
+
+    return (int)g_.jobs;
+}
+
+/// Wait for task @c handle, write its output, and push the cells it left.
+static void join(int handle, const bool traced)
+{
+    struct job *job;
+    const char *pos;
+    const char *msg;
+    unsigned long operations;
+
+    if (handle < 1 || (size_t)handle > g_.jobs || !g_.job[handle - 1]) {
+        fatal("unknown task");
+    }
+
+    job = g_.job[handle - 1];
+    g_.job[handle - 1] = NULL;
+
+    // Handles are reused once the newest tasks are joined.
+    while (g_.jobs && !g_.job[g_.jobs - 1]) {
+        g_.jobs--;
+    }
+
+    task_join(job->task);
+
+    if (job->length) {
+        g_.config.emit_string(job->output, job->length);
+    }
+
+    g_.config.limit += job->lent;
+    schedule();
+
+    pos = job->pos;
+    msg = job->msg;
+    operations = job->operations;
+
+    if (!msg) {
+        for (size_t i = 0; i < job->cells; ++i) {
+            push(job->cell[i], traced);
+        }
+    }
+
+    job_free(job);
+
+    if (msg) {
+        g_.slice.buf = pos;
+        fatal(msg);
+    }
+
+    count(operations);
+}
+
+struct program *compile(struct config config)
+{
+    struct program *program = (struct program *)malloc(sizeof(struct program));
+    program_init(program, slice_make(config.str, strlen(config.str)), config.extensions, true);
+    return program;
+}
+
+void release(struct program *program)
+{
+    program_free(program);
+    free(program);
+}
+
+/// Start a run afresh: check the arguments of @c config, clear the stack and array,
+/// and set the variables from the arguments.
+static void prepare(struct config config)
+{
+    int v;
+
+    if (config.argc == 0) {
+        fatal("too few arguments");
+    }
+
+    // Skip filename.
+    --config.argc;
+    ++config.argv;
+
+    if (config.argc > 25) {
+        // a = argc, b..z = args
+        fatal("too many arguments");
+    }
+
+    stack_init(fatal, g_.config.log_stack ? log_stack_operation : NULL);
+
+    storage_clear();
+
+    array_clear();
+
+    v = 'a';
+    storage_set(v++, token_make_number(config.argc));
+
+    while (config.argc-- > 0) {
+        const char *arg = *config.argv++;
+        char *end = NULL;
+        storage_set(v++, token_make_number((int)strtol(arg, &end, 0)));
+        if (end && end == arg) {
+            fatal("non-numeric argument");
+        }
+    }
+}
+
+/// Run the program itself.
+static void top(void)
+{
+    if (g_.config.registers) {
+        tier_call(&g_.tier, g_.program, g_.program->count);
+    }
+
+    enter(g_.program->top.slice, &g_.program->top, true);
+}
+
+/// Report progress and statistics at the end of a run.
+static void conclude(void)
+{
+    if (g_.config.log_progress) {
+        announce();
+    }
+
+    if (g_.config.log_stats) {
+        g_.config.log_stats(g_.config, "operations", g_.operations);
+        g_.config.log_stats(g_.config, "memo hits", g_.memo.hits);
+        g_.config.log_stats(g_.config, "memo misses", g_.memo.misses);
+        g_.config.log_stats(g_.config, "register calls", g_.registers);
+        g_.config.log_stats(g_.config, "promoted lambdas", g_.tier.lambdas);
+        g_.config.log_stats(g_.config, "promoted loops", g_.tier.loops);
+    }
+}
+
+/// Run @c program, a step at a time if @c vm is not NULL.
+static int launch(struct config config, const struct program *program, struct vm *vm)
+{
+    int r;
+
+    begin(config, program);
+
+    if (vm) {
+        g_.vm = vm;
+        pace(0);
+    }
+
+    if (setjmp(g_.env) == 0) {
+        prepare(config);
+
+        top();
+
+        if (!stack_empty()) {
+            fatal("stack not empty");
+        }
+
+        r = 0;
+    } else {
+        r = 1;
+    }
+
+    conclude();
+
+    end();
+
+    return r;
+}
+
+int run(struct config config, const struct program *program)
+{
+    return launch(config, program, NULL);
+}
+
+/// Stack, variables, array and tasks left by a piece of a program, and counts of the
+/// pieces so far.
+struct state {
+    struct stack *stack;
+    struct storage *storage;
+    struct array *array;
+
+    /// Contents of the lambdas held on the stack and in variables.
+    const char **held;
+    size_t holds;
+
+    /// Tasks not yet joined, and the programs of the pieces that started them.
+    struct job **job;
+    size_t jobs;
+    struct program **program;
+    size_t programs;
+
+    unsigned long operations;
+    unsigned long hits;
+    unsigned long misses;
+    unsigned long registers;
+    unsigned long lambdas;
+    unsigned long loops;
+};
+
+/// @return bool True if a task of @c state not yet joined was started by @c program.
+static bool running(const struct state *state, const struct program *program)
+{
+    for (size_t i = 0; i < state->jobs; ++i) {
+        if (state->job[i] && state->job[i]->program == program) {
+            return true;
+        }
+    }
+    return false;
+}
+
+/// Keep the stack, variables, array and tasks of this run in @c state, for the next
+/// piece, and @c program while its tasks run.
+static void keep(struct state *state, struct program *program)
+{
+    size_t kept = 0;
+    size_t depth = stack_size();
+
+    state->holds = 0;
+    state->held = (const char **)realloc(state->held, (depth + 26) * sizeof(const char *));
+
+    for (size_t k = 0; k < depth; ++k) {
+        struct token token = stack_peek(k);
+        if (token.tok == tokLambda) {
+            state->held[state->holds++] = token.u.lambda.buf;
+        }
+    }
+    for (int v = 'a'; v <= 'z'; ++v) {
+        struct token token = storage_get(v);
+        if (token.tok == tokLambda) {
+            state->held[state->holds++] = token.u.lambda.buf;
+        }
+    }
+
+    state->stack = stack_detach();
+    state->storage = storage_detach();
+    state->array = array_detach();
+
+    state->job = g_.job;
+    state->jobs = g_.jobs;
+    g_.job = NULL;
+    g_.jobs = 0;
+
+    // Release the programs of pieces whose tasks have all been joined.
+    state->program = (struct program **)realloc(state->program, (state->programs + 1) * sizeof(struct program *));
+    state->program[state->programs++] = program;
+    for (size_t i = 0; i < state->programs; ++i) {
+        if (running(state, state->program[i])) {
+            state->program[kept++] = state->program[i];
+        } else {
+            release(state->program[i]);
+        }
+    }
+    state->programs = kept;
+
+    state->operations = g_.operations;
+    state->hits = g_.memo.hits;
+    state->misses = g_.memo.misses;
+    state->registers = g_.registers;
+    state->lambdas = g_.tier.lambdas;
+    state->loops = g_.tier.loops;
+}
+
+struct program *compile_piece(struct config config)
+{
+    struct program *program = (struct program *)malloc(sizeof(struct program));
+    program_init(program, slice_make(config.str, strlen(config.str)), config.extensions, false);
+    return program;
+}
+
+int run_piece(struct config config, struct program *program, struct state **state, bool last)
+{
+    const bool first = !*state;
+    struct state *kept;
+    int r;
+
+    begin(config, program);
+
+    if (!first) {
+        kept = *state;
+
+        // Counts continue across pieces.
+        g_.operations = kept->operations;
+        g_.progress = config.log_progress ? g_.operations + config.progress_interval : ULONG_MAX;
+        g_.memo.hits = kept->hits;
+        g_.memo.misses = kept->misses;
+        g_.registers = kept->registers;
+        g_.tier.lambdas = kept->lambdas;
+        g_.tier.loops = kept->loops;
+        schedule();
+
+        array_attach(kept->array);
+        storage_attach(kept->storage);
+        stack_attach(kept->stack);
+        kept->array = NULL;
+        kept->storage = NULL;
+        kept->stack = NULL;
+
+        g_.job = kept->job;
+        g_.jobs = kept->jobs;
+        kept->job = NULL;
+        kept->jobs = 0;
+    } else {
+        *state = (struct state *)calloc(1, sizeof(struct state));
+    }
+
+    if (setjmp(g_.env) == 0) {
+        if (first) {
+            prepare(config);
+        }
+
+        top();
+
+        if (last && !stack_empty()) {
+            fatal("stack not empty");
+        }
+
+        r = 0;
+    } else {
+        r = 1;
+    }
+
+    // Read back only now, as locals changed after setjmp() are lost by longjmp().
+    kept = *state;
+
+    if (r || last) {
+        conclude();
+        end();
+        release(program);
+        state_free(kept);
+        kept = NULL;
+    } else {
+        keep(kept, program);
+        end();
+    }
+
+    *state = kept;
+    return r;
+}
+
+bool state_refers(const struct state *state, const char *str)
+{
+    const char *end = str + strlen(str);
+
+    for (size_t i = 0; i < state->holds; ++i) {
+        if (state->held[i] >= str && state->held[i] < end) {
+            return true;
+        }
+    }
+    for (size_t i = 0; i < state->jobs; ++i) {
+        const struct job *job = state->job[i];
+        for (size_t k = 0; job && k < job->holds; ++k) {
+            if (job->held[k] >= str && job->held[k] < end) {
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+void state_free(struct state *state)
+{
+    // Each is attached in place of that of this thread, to be released as it is restored.
+    if (state->stack) {
+        struct stack *stack = stack_detach();
+        stack_attach(state->stack);
+        stack_attach(stack);
+    }
+    if (state->array) {
+        struct array *array = array_detach();
+        array_attach(state->array);
+        array_attach(array);
+    }
+    free(state->storage);
+
+    // Tasks are waited for before the programs they run are released.
+    jobs_free(state->job, state->jobs);
+    for (size_t i = 0; i < state->programs; ++i) {
+        release(state->program[i]);
+    }
+    free(state->program);
+
+    free(state->held);
+    free(state);
+}
+
+static void step_main(void *arg)
+{
+    struct vm *vm = (struct vm *)arg;
+    vm->r = launch(vm->config, vm->program, vm);
+}
+
+struct vm *vm_start(struct config config, const struct program *program)
+{
+    struct vm *vm = (struct vm *)calloc(1, sizeof(struct vm));
+
+    vm->fiber = fiber_create(step_main, vm);
+    vm->owner = &g_;
+    vm->config = config;
+    vm->program = program;
+    vm->step = stepRunning;
+    vm->fresh = true;
+
+    return vm;
+}
+
+enum step vm_step(struct vm *vm, unsigned long budget)
+{
+    struct interpreter outer;
+    struct stack *stack;
+    struct storage *storage;
+    struct array *array;
+
+    if (vm->step != stepRunning && vm->step != stepWaitingInput) {
+        return vm->step;
+    }
+
+    // The fiber may hold addresses of this thread's state, taken before it was suspended.
+    assert(vm->owner == &g_);
+
+    // Set aside whatever this thread was running, as work() does for tasks.
+    outer = g_;
+    stack = stack_detach();
+    storage = storage_detach();
+    array = array_detach();
+
+    vm->budget = budget;
+
+    if (!vm->fresh) {
+        g_ = vm->interpreter;
+        array_attach(vm->array);
+        storage_attach(vm->storage);
+        stack_attach(vm->stack);
+    }
+    vm->fresh = false;
+
+    if (fiber_resume(vm->fiber)) {
+        vm->step = vm->r ? stepError : stepDone;
+    } else {
+        vm->interpreter = g_;
+        vm->stack = stack_detach();
+        vm->storage = storage_detach();
+        vm->array = array_detach();
+    }
+
+    g_ = outer;
+    array_attach(array);
+    storage_attach(storage);
+    stack_attach(stack);
+
+    return vm->step;
+}
+
+void vm_free(struct vm *vm)
+{
+    // Unwind the run, so that it releases what it holds.
+    if (!vm->fresh && (vm->step == stepRunning || vm->step == stepWaitingInput)) {
+        vm->abandoned = true;
+        vm_step(vm, 0);
+    }
+
+    fiber_free(vm->fiber);
+    free(vm);
+}
+
+size_t sample(struct frame *frame, size_t n)
+{
+    size_t depth = g_.frames < SAMPLE_DEPTH ? g_.frames : SAMPLE_DEPTH;
+
+    if (n > depth) {
+        n = depth;
+    }
+
+    for (size_t i = 0; i < n; ++i) {
+        const char *buf = g_.frame[i];
+
+        frame[i].pos = buf - 1;
+        frame[i].variable = 0;
+
+        // Only variables are examined, as the stack may be changing.
+        for (int v = 'a'; v <= 'z' && !frame[i].variable; ++v) {
+            struct token token = storage_get(v);
+            if (token.tok == tokLambda && token.u.lambda.buf == buf) {
+                frame[i].variable = v;
+            }
+        }
+    }
+
+    return n;
+}
+
+int interpret(struct config config)
+{
+    struct program *program = compile(config);
+    int r = run(config, program);
+    release(program);
+    return r;
+}
+
+static void report(const struct config config, const char *pos, const struct effect *effect)
+{
+    char *diagram = verify_print(effect);
+    config.log_verify(config, pos, diagram, effect->proven);
+    free(diagram);
+}
+
+int verify(struct config config)
+{
+    struct program program;
+    int r;
+
+    program_init(&program, slice_make(config.str, strlen(config.str)), config.extensions, true);
+
+    report(config, NULL, &program.top.effect);
+
+    for (size_t i = 0; i < program.count; ++i) {
+        // Opening bracket precedes lambda contents.
+        report(config, program.lambda[i].slice.buf - 1, &program.lambda[i].effect);
+    }
+
+    r = program.top.effect.proven ? 0 : 1;
+
+    program_free(&program);
+
     return r;
 }
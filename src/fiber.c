@@ -0,0 +1,122 @@
+#include "fiber.h"
+
+#include <stddef.h>
+#include <stdlib.h>
+#include <sys/mman.h>
+#include <ucontext.h>
+#include <unistd.h>
+
+#if defined(__SANITIZE_ADDRESS__)
+#define FIBER_ASAN 1
+#elif defined(__has_feature)
+#if __has_feature(address_sanitizer)
+#define FIBER_ASAN 1
+#endif
+#endif
+
+// The address sanitizer is told of each switch of stacks, as otherwise it mistakes
+// frames on one stack for overflows of another.
+#if defined(FIBER_ASAN)
+#include <sanitizer/asan_interface.h>
+#include <sanitizer/common_interface_defs.h>
+#else
+#define __sanitizer_start_switch_fiber(save, bottom, size) ((void)(save), (void)(bottom), (void)(size))
+#define __sanitizer_finish_switch_fiber(save, bottom, size) ((void)(save), (void)(bottom), (void)(size))
+#define __asan_unpoison_memory_region(addr, size) ((void)(addr), (void)(size))
+#endif
+
+/// Stack of each fiber, as large as that of a main thread.  Pages are only
+/// committed once touched, so that idle fibers cost little memory.
+#define FIBER_STACK (8 << 20)
+
+struct fiber {
+    void (*run)(void *arg);
+    void *arg;
+
+    ucontext_t context;
+
+    /// Context of the resuming thread, and of the fiber once it returns.
+    ucontext_t caller;
+
+    void *stack;
+    bool done;
+
+    /// Stack of the resuming thread, and state set aside while switching away from
+    /// the fiber, for the address sanitizer.
+    const void *caller_stack;
+    size_t caller_size;
+    void *fake_stack;
+};
+
+/// Fiber running on this thread, or NULL.
+static _Thread_local struct fiber *current_;
+
+static void enter(void)
+{
+    struct fiber *fiber = current_;
+
+    __sanitizer_finish_switch_fiber(NULL, &fiber->caller_stack, &fiber->caller_size);
+
+    fiber->run(fiber->arg);
+    fiber->done = true;
+
+    // The stack is left for good.
+    __sanitizer_start_switch_fiber(NULL, fiber->caller_stack, fiber->caller_size);
+}
+
+struct fiber *fiber_create(void (*run)(void *arg), void *arg)
+{
+    struct fiber *fiber = (struct fiber *)calloc(1, sizeof(struct fiber));
+    long page = sysconf(_SC_PAGESIZE);
+
+    fiber->run = run;
+    fiber->arg = arg;
+    fiber->stack = mmap(NULL, FIBER_STACK, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    if (fiber->stack == MAP_FAILED) {
+        // As with allocations, running out of memory is not recovered from.
+        abort();
+    }
+
+    // A previous fiber may have left its stack poisoned at the same address.
+    __asan_unpoison_memory_region(fiber->stack, FIBER_STACK);
+
+    // Overflow faults on the lowest page rather than writing past the stack.
+    mprotect(fiber->stack, (size_t)page, PROT_NONE);
+
+    getcontext(&fiber->context);
+    fiber->context.uc_stack.ss_sp = fiber->stack;
+    fiber->context.uc_stack.ss_size = FIBER_STACK;
+    fiber->context.uc_link = &fiber->caller;
+    makecontext(&fiber->context, enter, 0);
+
+    return fiber;
+}
+
+bool fiber_resume(struct fiber *fiber)
+{
+    struct fiber *outer = current_;
+    void *fake_stack = NULL;
+
+    current_ = fiber;
+    __sanitizer_start_switch_fiber(&fake_stack, fiber->stack, FIBER_STACK);
+    swapcontext(&fiber->caller, &fiber->context);
+    __sanitizer_finish_switch_fiber(fake_stack, NULL, NULL);
+    current_ = outer;
+
+    return fiber->done;
+}
+
+void fiber_suspend(void)
+{
+    struct fiber *fiber = current_;
+
+    __sanitizer_start_switch_fiber(&fiber->fake_stack, fiber->caller_stack, fiber->caller_size);
+    swapcontext(&fiber->context, &fiber->caller);
+    __sanitizer_finish_switch_fiber(fiber->fake_stack, &fiber->caller_stack, &fiber->caller_size);
+}
+
+void fiber_free(struct fiber *fiber)
+{
+    munmap(fiber->stack, FIBER_STACK);
+    free(fiber);
+}
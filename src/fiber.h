@@ -0,0 +1,25 @@
+#pragma once
+
+#include <stdbool.h>
+
+/*
+ Functions run on their own stacks, which suspend to the thread that resumed them
+ and later continue where they left off, so that one thread may interleave many.
+ */
+
+/// Function run by @c fiber_resume.
+struct fiber;
+
+/// Prepare to run @c run(arg) on a stack of its own.
+/// @return fiber Fiber, to be released with @c fiber_free.
+struct fiber *fiber_create(void (*run)(void *arg), void *arg);
+
+/// Run @c fiber on this thread until it suspends or returns.
+/// @return bool True once it has returned.
+bool fiber_resume(struct fiber *fiber);
+
+/// Return from the @c fiber_resume running this fiber, to continue from here at the next.
+void fiber_suspend(void);
+
+/// Release @c fiber, which must have returned or never been resumed.
+void fiber_free(struct fiber *fiber);
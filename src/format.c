@@ -0,0 +1,47 @@
+#include "format.h"
+
+#include <string.h>
+
+/// Decimal digit pairs "00" to "99".
+static const char digits[200] =
+    "00010203040506070809"
+    "10111213141516171819"
+    "20212223242526272829"
+    "30313233343536373839"
+    "40414243444546474849"
+    "50515253545556575859"
+    "60616263646566676869"
+    "70717273747576777879"
+    "80818283848586878889"
+    "90919293949596979899";
+
+size_t format_number(char *buf, int number)
+{
+    char tmp[FORMAT_NUMBER_MAX];
+    char *p = &tmp[sizeof(tmp)];
+    unsigned u = number < 0 ? 0u - (unsigned)number : (unsigned)number;
+    size_t len;
+
+    // Two digits at a time, from the least significant.
+    while (u >= 100) {
+        const char *pair = &digits[(u % 100) * 2];
+        u /= 100;
+        *--p = pair[1];
+        *--p = pair[0];
+    }
+
+    if (u >= 10) {
+        *--p = digits[u * 2 + 1];
+        *--p = digits[u * 2];
+    } else {
+        *--p = (char)('0' + u);
+    }
+
+    if (number < 0) {
+        *--p = '-';
+    }
+
+    len = (size_t)(&tmp[sizeof(tmp)] - p);
+    memcpy(buf, p, len);
+    return len;
+}
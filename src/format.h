@@ -0,0 +1,10 @@
+#pragma once
+
+#include <stddef.h>
+
+/// Longest decimal representation of an @c int, including sign.
+#define FORMAT_NUMBER_MAX 11
+
+/// Format @c number as decimal into @c buf, which must hold @c FORMAT_NUMBER_MAX bytes.
+/// @return size_t Number of bytes written, without terminating NUL.
+size_t format_number(char *buf, int number);
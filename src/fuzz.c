@@ -1,14 +1,34 @@
 #include "false.h"
 
-#include "code-point.h"
-
-#include <assert.h>
 #include <locale.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <wchar.h>
 
+/// Operations per input, so that endless loops terminate.
+#define FUZZ_LIMIT 10000
+
+/// Small memo cache, so that eviction is exercised.
+#define FUZZ_MEMO 16
+
+/// Low promotion threshold, so that lambdas and loops change tier while running.
+#define FUZZ_TIER_THRESHOLD 2
+
+/// Frequent reports of progress, so that they interleave with every tier.
+#define FUZZ_PROGRESS_INTERVAL 61
+
+/// Operation limit, raised by the driver to measure the cost of larger inputs.
+unsigned long fuzz_limit = FUZZ_LIMIT;
+
+/// Operations executed by the last input, beyond @c fuzz_limit if it was reached.
+unsigned long fuzz_operations;
+
+/// Remaining standard input of the current fuzz input.
+static const uint8_t *input_;
+static const uint8_t *input_end_;
+
 static void nop_fatal(const struct config config, const char *pos, const char *msg)
 {
     (void)config;
@@ -16,179 +36,120 @@ static void nop_fatal(const struct config config, const char *pos, const char *m
     (void)msg;
 }
 
-static void nop_log_trace(const struct config config, wchar_t wc, const char *pos)
+static void nop_emit_number(int x)
 {
-    (void)config;
-    (void)wc;
-    (void)pos;
+    (void)x;
 }
 
-static void nop_log_stack(const struct config config, const char *op, const char *dump)
+static void nop_emit_string(const char *buf, size_t len)
 {
-    (void)config;
-    (void)op;
-    (void)dump;
+    (void)buf;
+    (void)len;
 }
 
-static void nop_emit_number(int x)
+static void nop_emit_char(char c)
 {
-    (void)x;
+    (void)c;
 }
 
-static void nop_emit_wchar(wchar_t wc)
+static int fuzz_input(void)
 {
-    (void)wc;
+    if (input_ == input_end_) {
+        return EOF;
+    }
+    return *input_++;
 }
 
-static void nop_emit_char(char c)
+static void log_operations(const struct config config, const char *name, unsigned long value)
 {
-    (void)c;
+    (void)config;
+    if (!strcmp(name, "operations")) {
+        fuzz_operations = value;
+    }
 }
 
-static int nop_input(void)
+static size_t fuzz_input_string(char *buf, size_t len, int delim)
 {
-    return 1;
+    size_t n = 0;
+
+    while (n < len && input_ != input_end_) {
+        buf[n++] = (char)*input_;
+        if (*input_++ == delim) {
+            break;
+        }
+    }
+    return n;
 }
 
 static void nop_flush(void)
 {
 }
 
-int main(void)
+/// Reported positions must be within the program.
+static void check_progress(const struct config config, unsigned long operations, size_t depth, const char *pos)
 {
-    /* Ad-hoc fuzz test of all supported symbols.
-     * The iterations and range variables were chosen to get good code coverage.
-     * This test aims to identify crashes caused by malformed input. */
-
-    static const wchar_t operator_array[] = {
-        '`',
-        '\\',
-        '$',
-        '%',
-        '@',
-        LATIN_SMALL_LETTER_O_WITH_STROKE,
-        'O',
-        '+',
-        '-',
-        '*',
-        '/',
-        '<',
-        '=',
-        '>',
-        '&',
-        '|',
-        '_',
-        '~',
-        '^',
-        '.',
-        ',',
-        LATIN_SMALL_LETTER_SHARP_S,
-        'B',
-        ':',
-        ';',
-        '{',
-        '\'',
-        '"',
-        '[',
-        ']',
-        '}',
-        '!',
-        '?',
-        '#',
-        POUND_SIGN,
-        SECTION_SIGN,
-        REGISTERED_SIGN,
-        LEFT_POINTING_DOUBLE_ANGLE_QUOTATION_MARK,
-        RIGHT_POINTING_DOUBLE_ANGLE_QUOTATION_MARK,
-        INVERTED_QUESTION_MARK,
-        LATIN_CAPITAL_LETTER_O_WITH_STROKE,
-        DIVISION_SIGN,
-        PER_MILLE_SIGN,
-        EURO_SIGN,
-        TRADE_MARK_SIGN,
-        INTEGRAL,
-        NOT_EQUAL_TO,
-        LESS_THAN_OR_EQUAL_TO,
-        GREATER_THAN_OR_EQUAL_TO,
-        XOR,
-    };
-
-    char *args[] = { "stdin" };
-
-    const size_t iterations = 10000;
-    const int range = 500;
-
-    size_t ws_size = 1;
-    size_t digit_size = 10;
-    size_t letter_size = 26;
-    size_t operator_size = sizeof(operator_array) / sizeof(*operator_array);
-    size_t invalid_size = 1;
-    size_t alphabet_size = ws_size + digit_size + letter_size + operator_size + invalid_size;
+    (void)operations;
+    (void)depth;
+    if (pos && (pos < config.str || pos > config.str + strlen(config.str))) {
+        abort();
+    }
+}
 
-    struct config config;
+int LLVMFuzzerInitialize(int *argc, char ***argv)
+{
+    (void)argc;
+    (void)argv;
 
-    config.argc = sizeof(args) / sizeof(*args);
-    config.argv = args;
+    // Test data includes UTF-8 encoded multibyte characters.
+    if (!setlocale(LC_ALL, "en_US.UTF-8")) {
+        setlocale(LC_ALL, "C.UTF-8");
+    }
 
-    config.fatal       = nop_fatal;
-    config.log_trace   = nop_log_trace;
-    config.log_stack   = nop_log_stack;
-    config.emit_number = nop_emit_number;
-    config.emit_wchar  = nop_emit_wchar;
-    config.emit_char   = nop_emit_char;
-    config.input       = nop_input;
-    config.flush       = nop_flush;
+    return 0;
+}
 
-    // Test data includes UTF-8 encoded multibyte characters.
-    setlocale(LC_ALL, "en_US.UTF-8");
-
-    srand(0);
-
-    for (size_t iteration = 0; iteration < iterations; ++iteration) {
-        size_t len = (size_t)(rand() % range);
-        char *buf = (char *)malloc(len * 4);  // Include overhead for multibyte characters.
-        size_t width = 0;
-
-        for (size_t i = 0; i < len; ++i) {
-            size_t r = (size_t)((size_t)rand() % alphabet_size);
-            wchar_t wc;
-
-            if (r < ws_size) {
-                wc = ' ';
-            } else {
-                r -= ws_size;
-                if (r < digit_size) {
-                    wc = '0' + (char)r;
-                } else {
-                    r -= digit_size;
-                    if (r < letter_size) {
-                        wc = 'a' + (char)r;
-                    } else {
-                        r -= letter_size;
-                        if (r < operator_size) {
-                            wc = operator_array[r];
-                        } else {
-                            r -= operator_size;
-                            if (r < invalid_size) {
-                                wc = 'A';
-                            } else {
-                                r -= invalid_size;
-                                abort();
-                            }
-                        }
-                    }
-                }
-            }
-
-            width += wcrtomb(&buf[width], wc, NULL);
-        }
+/// Interpret program text, optionally followed by a NUL and standard input.
+int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size)
+{
+    static char *args[] = { "stdin" };
 
-        buf[width] = 0;
+    const uint8_t *nul = memchr(data, 0, size);
+    size_t len = nul ? (size_t)(nul - data) : size;
+    char *str = malloc(len + 1);
+    struct config config;
 
-        config.str = buf;
-        interpret(config);
-        free(buf);
-    }
+    memcpy(str, data, len);
+    str[len] = 0;
+
+    input_ = nul ? nul + 1 : data + size;
+    input_end_ = data + size;
+
+    config.argc = sizeof(args) / sizeof(*args);
+    config.argv = args;
+    config.str = str;
+
+    config.extensions        = true;
+    config.memo              = FUZZ_MEMO;
+    config.registers         = true;
+    config.tier_threshold    = FUZZ_TIER_THRESHOLD;
+    config.limit             = fuzz_limit;
+    config.fatal             = nop_fatal;
+    config.log_trace         = NULL;
+    config.log_verify        = NULL;
+    config.log_stats         = log_operations;
+    config.progress_interval = FUZZ_PROGRESS_INTERVAL;
+    config.log_progress      = check_progress;
+    config.log_stack         = NULL;
+    config.emit_number       = nop_emit_number;
+    config.emit_string       = nop_emit_string;
+    config.emit_char         = nop_emit_char;
+    config.input             = fuzz_input;
+    config.input_string      = fuzz_input_string;
+    config.flush             = nop_flush;
+
+    interpret(config);
+
+    free(str);
 
     return 0;
 }
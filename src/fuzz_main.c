@@ -0,0 +1,889 @@
+/* Coverage-guided fuzz driver for the libFuzzer entry point in fuzz.c.
+ *
+ * Objects compiled with -fsanitize-coverage=trace-pc call back into
+ * __sanitizer_cov_trace_pc() for every basic block; consecutive blocks are
+ * hashed into an edge map.  Inputs reaching edges not yet seen by any job are
+ * kept for further mutation.  Jobs are forked processes sharing the global
+ * edge map and their execution counts, so a crash in one job is reported by
+ * the parent together with the input that caused it.
+ *
+ * With -cost, inputs are kept instead when they cost more per byte than the
+ * input they were mutated from, in operations or in wall time, to find inputs
+ * that are pathologically slow rather than new paths.  The costliest inputs of
+ * each job are kept in the shared state and saved at the end.  With -report,
+ * each input is instead run repeated a growing number of times, and inputs are
+ * ranked by how fast their cost grows with their size.
+ *
+ * This file must be compiled without coverage instrumentation. */
+
+#include "code-point.h"
+
+#include <dirent.h>
+#include <errno.h>
+#include <limits.h>
+#include <signal.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+#include <wchar.h>
+
+int LLVMFuzzerInitialize(int *argc, char ***argv);
+int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size);
+
+extern unsigned long fuzz_limit;
+extern unsigned long fuzz_operations;
+
+/// Size of edge map.
+#define EDGES 65536
+
+/// Maximum number of jobs.
+#define JOBS_MAX 256
+
+/// Maximum input size.
+#define INPUT_MAX 4096
+
+/// Costliest inputs kept per job.
+#define WORST 8
+
+/// Sizes of the report, as powers of two of repeats of the program.
+#define REPORT_SCALES 7
+
+/// Operation limit of the report, so that endless loops terminate.
+#define REPORT_LIMIT 1000000
+
+/// Runs of each size of the report, of which the fastest is timed.
+#define REPORT_REPEATS 5
+
+/// Runs slower than this, in seconds, are timed once.
+#define REPORT_SLOW 0.05
+
+/// What is maximized by fuzzing.
+enum cost {
+    costCoverage,
+    costOperations,
+    costTime
+};
+
+/// Input ranked by cost.
+struct worst {
+    double cost;
+    size_t size;
+    uint8_t data[INPUT_MAX];
+};
+
+/// State shared between parent and jobs.
+struct shared {
+    /// Edges reached by any job.
+    unsigned char edges[EDGES];
+
+    /// Executions per job.
+    volatile unsigned long execs[JOBS_MAX];
+
+    /// Input being executed per job, for crash reports.
+    size_t size[JOBS_MAX];
+    uint8_t input[JOBS_MAX][INPUT_MAX];
+
+    /// Costliest inputs per job, costliest first.
+    struct worst worst[JOBS_MAX][WORST];
+};
+
+struct input {
+    uint8_t *data;
+    size_t size;
+
+    /// Cost per byte, when fuzzing for cost.
+    double cost;
+
+    /// Seed file, or NULL for a mutation.
+    char *name;
+};
+
+struct corpus {
+    struct input *input;
+    size_t count;
+    size_t capacity;
+};
+
+/// Edges reached by the current execution.
+static unsigned char edges_[EDGES];
+static uintptr_t previous_;
+
+/// Wall time of the last execution, in seconds.
+static double elapsed_;
+
+void __sanitizer_cov_trace_pc(void)
+{
+    uintptr_t pc = (uintptr_t)__builtin_return_address(0);
+    uintptr_t current = (pc ^ (pc >> 12)) * 0x9e3779b1u;
+
+    edges_[(current ^ previous_) % EDGES] = 1;
+    previous_ = current >> 1;
+}
+
+static double now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+/// Execute @c input, timing it in @c elapsed_.
+static void run(const uint8_t *data, size_t size)
+{
+    double start = now();
+    LLVMFuzzerTestOneInput(data, size);
+    elapsed_ = now() - start;
+}
+
+/// Execute @c input, adding reached edges to @c shared.
+/// @return size_t Number of edges not previously reached.
+static size_t execute(struct shared *shared, const uint8_t *data, size_t size)
+{
+    size_t found = 0;
+
+    memset(edges_, 0, sizeof(edges_));
+    previous_ = 0;
+
+    run(data, size);
+
+    for (size_t i = 0; i < EDGES; ++i) {
+        if (edges_[i] && !shared->edges[i]) {
+            shared->edges[i] = 1;
+            ++found;
+        }
+    }
+
+    return found;
+}
+
+/// @return double Cost per byte of the last execution of an input of @c size bytes.
+static double cost_of(enum cost cost, size_t size)
+{
+    double bytes = size ? (double)size : 1.0;
+
+    // Endless loops all reach the limit, so only runs that end are ranked.
+    if (fuzz_operations > fuzz_limit) {
+        return 0.0;
+    }
+    if (cost == costTime) {
+        return elapsed_ * 1e9 / bytes;
+    }
+    return (double)fuzz_operations / bytes;
+}
+
+/// Rank @c data among the costliest inputs @c worst.
+static void rank(struct worst *worst, const uint8_t *data, size_t size, double cost)
+{
+    size_t i = WORST;
+
+    while (i && worst[i - 1].cost < cost) {
+        --i;
+    }
+    if (i == WORST) {
+        return;
+    }
+    memmove(&worst[i + 1], &worst[i], (WORST - i - 1) * sizeof(*worst));
+    memcpy(worst[i].data, data, size);
+    worst[i].size = size;
+    worst[i].cost = cost;
+}
+
+static size_t count_edges(const struct shared *shared)
+{
+    size_t n = 0;
+    for (size_t i = 0; i < EDGES; ++i) {
+        n += shared->edges[i];
+    }
+    return n;
+}
+
+static void corpus_add(struct corpus *corpus, const uint8_t *data, size_t size)
+{
+    if (corpus->count == corpus->capacity) {
+        corpus->capacity = corpus->capacity ? corpus->capacity * 2 : 64;
+        corpus->input = realloc(corpus->input, corpus->capacity * sizeof(*corpus->input));
+        if (!corpus->input) {
+            perror("realloc");
+            exit(EXIT_FAILURE);
+        }
+    }
+    corpus->input[corpus->count].data = malloc(size ? size : 1);
+    if (!corpus->input[corpus->count].data) {
+        perror("malloc");
+        exit(EXIT_FAILURE);
+    }
+    memcpy(corpus->input[corpus->count].data, data, size);
+    corpus->input[corpus->count].size = size;
+    corpus->input[corpus->count].cost = 0.0;
+    corpus->input[corpus->count].name = NULL;
+    corpus->count++;
+}
+
+static void corpus_free(struct corpus *corpus)
+{
+    for (size_t i = 0; i < corpus->count; ++i) {
+        free(corpus->input[i].data);
+        free(corpus->input[i].name);
+    }
+    free(corpus->input);
+}
+
+/// Add seed file, or every file within seed directory, to @c corpus.
+static void corpus_load(struct corpus *corpus, const char *path)
+{
+    uint8_t data[INPUT_MAX];
+    struct stat st;
+    FILE *f;
+    size_t size;
+
+    if (stat(path, &st) == -1) {
+        fprintf(stderr, "%s: %s\n", path, strerror(errno));
+        exit(EXIT_FAILURE);
+    }
+
+    if (S_ISDIR(st.st_mode)) {
+        DIR *dir = opendir(path);
+        struct dirent *entry;
+        while (dir && (entry = readdir(dir))) {
+            char file[4096];
+            if (entry->d_name[0] == '.') {
+                continue;
+            }
+            snprintf(file, sizeof(file), "%s/%s", path, entry->d_name);
+            corpus_load(corpus, file);
+        }
+        if (dir) {
+            closedir(dir);
+        }
+        return;
+    }
+
+    f = fopen(path, "rb");
+    if (!f) {
+        fprintf(stderr, "%s: %s\n", path, strerror(errno));
+        exit(EXIT_FAILURE);
+    }
+    size = fread(data, 1, sizeof(data), f);
+    fclose(f);
+
+    corpus_add(corpus, data, size);
+    corpus->input[corpus->count - 1].name = strdup(path);
+}
+
+/// Symbols inserted by mutation.
+static const wchar_t alphabet[] = {
+    ' ', '\n', 0,
+    '0', '1', '2', '9',
+    'a', 'b', 'i', 'z',
+    'A',
+    '`', '\\', '$', '%', '@', 'O', '+', '-', '*', '/', '<', '=', '>',
+    '&', '|', '_', '~', '^', '.', ',', 'B', ':', ';', '{', '\'', '"',
+    '[', ']', '}', '!', '?', '#',
+    LATIN_SMALL_LETTER_O_WITH_STROKE,
+    LATIN_SMALL_LETTER_SHARP_S,
+    POUND_SIGN,
+    SECTION_SIGN,
+    REGISTERED_SIGN,
+    LEFT_POINTING_DOUBLE_ANGLE_QUOTATION_MARK,
+    RIGHT_POINTING_DOUBLE_ANGLE_QUOTATION_MARK,
+    INVERTED_QUESTION_MARK,
+    LATIN_CAPITAL_LETTER_O_WITH_STROKE,
+    DIVISION_SIGN,
+    PER_MILLE_SIGN,
+    EURO_SIGN,
+    TRADE_MARK_SIGN,
+    INTEGRAL,
+    NOT_EQUAL_TO,
+    LESS_THAN_OR_EQUAL_TO,
+    GREATER_THAN_OR_EQUAL_TO,
+    XOR,
+    DAGGER,
+    DOUBLE_DAGGER,
+    N_ARY_SUMMATION,
+    LOGICAL_AND,
+    LOGICAL_OR,
+    MIDDLE_DOT,
+    CIRCLED_PLUS,
+    CIRCLED_TIMES,
+    HORIZONTAL_ELLIPSIS,
+    MODIFIER_LETTER_CIRCUMFLEX_ACCENT,
+    CARON,
+    CEDILLA,
+    DIAERESIS,
+};
+
+/// Xorshift generator, one per job.
+static uint64_t random_(uint64_t *state)
+{
+    uint64_t x = *state;
+    x ^= x << 13;
+    x ^= x >> 7;
+    x ^= x << 17;
+    return *state = x;
+}
+
+static size_t below(uint64_t *state, size_t n)
+{
+    return n ? (size_t)(random_(state) % n) : 0;
+}
+
+/// Insert @c n bytes at @c pos, truncating at @c INPUT_MAX.
+static size_t insert(uint8_t *data, size_t size, size_t pos, const uint8_t *bytes, size_t n)
+{
+    if (size + n > INPUT_MAX) {
+        return size;
+    }
+    memmove(&data[pos + n], &data[pos], size - pos);
+    memcpy(&data[pos], bytes, n);
+    return size + n;
+}
+
+/// Apply a few random mutations to @c data.
+/// @return size_t Size of mutated input.
+static size_t mutate(uint64_t *state, const struct corpus *corpus, uint8_t *data, size_t size)
+{
+    size_t rounds = 1 + below(state, 4);
+
+    while (rounds--) {
+        size_t pos = below(state, size + 1);
+        size_t n = 1 + below(state, 8);
+        uint8_t bytes[INPUT_MAX];
+
+        switch (below(state, 6)) {
+            case 0: {
+                // Insert symbol.
+                char mb[MB_LEN_MAX];
+                mbstate_t mbstate;
+                size_t width;
+                memset(&mbstate, 0, sizeof(mbstate));
+                width = wcrtomb(mb, alphabet[below(state, sizeof(alphabet) / sizeof(*alphabet))], &mbstate);
+                if (width != (size_t)-1) {
+                    size = insert(data, size, pos, (const uint8_t *)mb, width);
+                }
+                break;
+            }
+
+            case 1:
+                // Insert number.
+                n = (size_t)snprintf((char *)bytes, sizeof(bytes), "%zu", below(state, 1000));
+                size = insert(data, size, pos, bytes, n);
+                break;
+
+            case 2:
+                // Erase bytes.
+                if (pos + n <= size) {
+                    memmove(&data[pos], &data[pos + n], size - pos - n);
+                    size -= n;
+                }
+                break;
+
+            case 3:
+                // Duplicate bytes.
+                if (pos + n <= size) {
+                    memcpy(bytes, &data[pos], n);
+                    size = insert(data, size, pos, bytes, n);
+                }
+                break;
+
+            case 4: {
+                // Splice part of another input.
+                const struct input *other = &corpus->input[below(state, corpus->count)];
+                size_t from = below(state, other->size);
+                n = below(state, other->size - from + 1);
+                if (n > 64) {
+                    n = 64;
+                }
+                memcpy(bytes, &other->data[from], n);
+                size = insert(data, size, pos, bytes, n);
+                break;
+            }
+
+            case 5:
+                // Flip bits.
+                if (pos < size) {
+                    data[pos] ^= (uint8_t)(1u << below(state, 8));
+                }
+                break;
+        }
+    }
+
+    return size;
+}
+
+/// Run @c runs mutations (zero for no limit) as job @c job, keeping those that
+/// reach new edges, or that cost more than their parent.
+static void job_run(struct shared *shared, struct corpus *corpus, size_t job, enum cost cost, unsigned long runs, unsigned long seed)
+{
+    uint64_t state = 0x2545f4914f6cdd1dull ^ (seed * 0x9e3779b97f4a7c15ull) ^ (job + 1);
+    uint8_t *data = shared->input[job];
+
+    for (unsigned long run = 0; !runs || run < runs; ++run) {
+        const struct input *parent = &corpus->input[below(&state, corpus->count)];
+        size_t size = parent->size;
+
+        memcpy(data, parent->data, size);
+        size = mutate(&state, corpus, data, size);
+        shared->size[job] = size;
+
+        if (cost == costCoverage) {
+            if (execute(shared, data, size)) {
+                corpus_add(corpus, data, size);
+            }
+        } else {
+            double parent_cost = parent->cost;
+            double c;
+
+            execute(shared, data, size);
+            c = cost_of(cost, size);
+            if (c > parent_cost) {
+                corpus_add(corpus, data, size);
+                corpus->input[corpus->count - 1].cost = c;
+                rank(shared->worst[job], data, size, c);
+            }
+        }
+
+        shared->execs[job]++;
+    }
+}
+
+static unsigned long total(const struct shared *shared, size_t jobs)
+{
+    unsigned long n = 0;
+    for (size_t job = 0; job < jobs; ++job) {
+        n += shared->execs[job];
+    }
+    return n;
+}
+
+/// Save input of crashed job @c job.
+static void crash(const struct shared *shared, size_t job, int status)
+{
+    char path[64];
+    FILE *f;
+
+    snprintf(path, sizeof(path), "crash-%zu.f", job);
+    f = fopen(path, "wb");
+    if (f) {
+        fwrite(shared->input[job], 1, shared->size[job], f);
+        fclose(f);
+    }
+
+    if (WIFSIGNALED(status)) {
+        fprintf(stderr, "job %zu: signal %d, input saved to %s\n", job, WTERMSIG(status), path);
+    } else {
+        fprintf(stderr, "job %zu: exit %d, input saved to %s\n", job, WEXITSTATUS(status), path);
+    }
+}
+
+/// Save the costliest inputs of all jobs to @c dir, if given, and list them.
+static void save_worst(const struct shared *shared, size_t jobs, enum cost cost, const char *dir)
+{
+    static struct worst worst[WORST];
+
+    for (size_t job = 0; job < jobs; ++job) {
+        for (size_t i = 0; i < WORST && shared->worst[job][i].cost > 0.0; ++i) {
+            rank(worst, shared->worst[job][i].data, shared->worst[job][i].size, shared->worst[job][i].cost);
+        }
+    }
+
+    for (size_t i = 0; i < WORST && worst[i].cost > 0.0; ++i) {
+        char path[4096] = "-";
+
+        if (dir) {
+            FILE *f;
+            snprintf(path, sizeof(path), "%s/worst-%zu.f", dir, i);
+            f = fopen(path, "wb");
+            if (!f) {
+                fprintf(stderr, "%s: %s\n", path, strerror(errno));
+                continue;
+            }
+            fwrite(worst[i].data, 1, worst[i].size, f);
+            fclose(f);
+        }
+
+        printf("worst %zu: %.1f %s per byte, %zu bytes: %s\n"
+               , i, worst[i].cost, cost == costTime ? "ns" : "operations", worst[i].size, path);
+    }
+}
+
+/// Growth of the cost of an input with its size.
+struct growth {
+    const struct input *input;
+
+    /// Operations and seconds, at each size.
+    double operations[REPORT_SCALES];
+    double time[REPORT_SCALES];
+
+    /// True if the operation limit was reached at some size.
+    bool limited;
+
+    /// True if the input crashed the interpreter at some size.
+    bool crashed;
+};
+
+/// @return double Base-2 logarithm of @c x, which must be positive.
+static double log2_of(double x)
+{
+    double r = 0.0;
+
+    while (x >= 2.0) {
+        x /= 2.0;
+        r += 1.0;
+    }
+    while (x < 1.0) {
+        x *= 2.0;
+        r -= 1.0;
+    }
+    // Square to shift out one bit of the fraction at a time.
+    for (double bit = 0.5; bit > 1e-6; bit /= 2.0) {
+        x *= x;
+        if (x >= 2.0) {
+            x /= 2.0;
+            r += bit;
+        }
+    }
+    return r;
+}
+
+/// @return double Exponent of the growth of @c cost over the last two doublings of size,
+/// so one for linear growth, and two for quadratic.
+static double exponent(const double *cost)
+{
+    double x = cost[REPORT_SCALES - 3];
+    double y = cost[REPORT_SCALES - 1];
+
+    return x > 0.0 && y > 0.0 ? log2_of(y / x) / 2.0 : 0.0;
+}
+
+/// Order crashes first, then by growth of time to a tenth, then growth of
+/// operations, then name.
+static int compare_growth(const void *a, const void *b)
+{
+    const struct growth *x = (const struct growth *)a;
+    const struct growth *y = (const struct growth *)b;
+    long tx = (long)(exponent(x->time) * 10.0 + 0.5);
+    long ty = (long)(exponent(y->time) * 10.0 + 0.5);
+    double ox = exponent(x->operations);
+    double oy = exponent(y->operations);
+
+    if (x->crashed != y->crashed) {
+        return x->crashed ? -1 : 1;
+    }
+    if (tx != ty) {
+        return tx < ty ? 1 : -1;
+    }
+    if (ox != oy) {
+        return ox < oy ? 1 : -1;
+    }
+    return strcmp(x->input->name, y->input->name);
+}
+
+/// Measure @c input with its program repeated 1, 2, 4... times.
+static void measure(const struct input *input, struct growth *growth)
+{
+    const uint8_t *nul = memchr(input->data, 0, input->size);
+    size_t program = nul ? (size_t)(nul - input->data) : input->size;
+
+    for (size_t scale = 0; scale < REPORT_SCALES; ++scale) {
+        size_t repeats = (size_t)1 << scale;
+        size_t size = (program + 1) * repeats + input->size - program;
+        uint8_t *data = malloc(size);
+
+        if (!data) {
+            perror("malloc");
+            exit(EXIT_FAILURE);
+        }
+
+        // Separate copies, so that a number does not run into the next.
+        for (size_t i = 0; i < repeats; ++i) {
+            memcpy(&data[i * (program + 1)], input->data, program);
+            data[i * (program + 1) + program] = '\n';
+        }
+        memcpy(&data[repeats * (program + 1)], &input->data[program], input->size - program);
+
+        growth->time[scale] = 0.0;
+        for (size_t i = 0; i < REPORT_REPEATS && (!i || elapsed_ < REPORT_SLOW); ++i) {
+            run(data, size);
+            if (!i || elapsed_ < growth->time[scale]) {
+                growth->time[scale] = elapsed_;
+            }
+        }
+        growth->operations[scale] = (double)fuzz_operations;
+
+        free(data);
+
+        // Larger sizes reach the limit too, so they are taken to cost the same.
+        if (fuzz_operations > fuzz_limit) {
+            growth->limited = true;
+            for (size_t rest = scale + 1; rest < REPORT_SCALES; ++rest) {
+                growth->operations[rest] = growth->operations[scale];
+                growth->time[rest] = growth->time[scale];
+            }
+            break;
+        }
+    }
+}
+
+/// Rank the inputs of @c corpus by growth of their cost with size.
+/// @note Each input is measured in a child process, so that a crash is ranked too.
+/// @return size_t Inputs that crashed, or whose cost grew with an exponent above
+/// @c max_growth, if positive.
+static size_t report_growth(const struct corpus *corpus, double max_growth)
+{
+    size_t failed = 0;
+    size_t length = corpus->count * sizeof(struct growth);
+    struct growth *growth = mmap(NULL, length, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+
+    if (growth == MAP_FAILED) {
+        perror("mmap");
+        exit(EXIT_FAILURE);
+    }
+
+    fuzz_limit = REPORT_LIMIT;
+
+    for (size_t i = 0; i < corpus->count; ++i) {
+        pid_t pid;
+        int status;
+
+        growth[i].input = &corpus->input[i];
+
+        pid = fork();
+        if (pid == -1) {
+            perror("fork");
+            exit(EXIT_FAILURE);
+        }
+        if (pid == 0) {
+            measure(&corpus->input[i], &growth[i]);
+            _exit(EXIT_SUCCESS);
+        }
+        if (waitpid(pid, &status, 0) != pid || !WIFEXITED(status) || WEXITSTATUS(status) != EXIT_SUCCESS) {
+            growth[i].crashed = true;
+        }
+    }
+
+    qsort(growth, corpus->count, sizeof(*growth), compare_growth);
+
+    printf("%6s %6s %12s %10s  %s\n", "time", "ops", "ops", "ms", "input");
+    for (size_t i = 0; i < corpus->count; ++i) {
+        char operations[32];
+        bool fails = growth[i].crashed || (max_growth > 0.0
+                && (exponent(growth[i].time) > max_growth || exponent(growth[i].operations) > max_growth));
+
+        if (growth[i].crashed) {
+            snprintf(operations, sizeof(operations), "crash");
+        } else if (growth[i].limited) {
+            snprintf(operations, sizeof(operations), "limit");
+        } else {
+            snprintf(operations, sizeof(operations), "%.0f", growth[i].operations[REPORT_SCALES - 1]);
+        }
+
+        printf("%6.2f %6.2f %12s %10.3f  %s%s\n"
+               , exponent(growth[i].time)
+               , exponent(growth[i].operations)
+               , operations
+               , growth[i].time[REPORT_SCALES - 1] * 1e3
+               , growth[i].input->name
+               , fails ? "  FAIL" : "");
+        failed += fails;
+    }
+
+    munmap(growth, length);
+    return failed;
+}
+
+static void usage(const char *name)
+{
+    fprintf(stderr,
+            "usage: %s [-jobs=N] [-runs=N] [-max_total_time=S] [-seed=N]\n"
+            "          [-cost=ops|time] [-worst=DIR] [CORPUS...]\n"
+            "       %s -report [-max_growth=E] CORPUS...\n"
+            "\n"
+            "Fuzz the interpreter, mutating inputs from CORPUS files and directories.\n"
+            "Jobs default to the number of online processors.\n"
+            "\n"
+            "With -cost, keep inputs that cost more operations, or more time, per byte\n"
+            "than the input they were mutated from, and list the costliest, saving them\n"
+            "to DIR if given.  Runs that reach the operation limit cost nothing.\n"
+            "\n"
+            "With -report, run each input with its program repeated up to %d times, and\n"
+            "rank them by the growth exponent of the time, then of the operations, of\n"
+            "the last two doublings, so 1 for linear growth.  With -max_growth, fail if\n"
+            "any input crashes, or grows with an exponent above E.\n",
+            name, name, 1 << (REPORT_SCALES - 1));
+}
+
+int main(int argc, char *argv[])
+{
+    long processors = sysconf(_SC_NPROCESSORS_ONLN);
+    size_t jobs = processors > 0 ? (size_t)processors : 1;
+    unsigned long runs = 0;
+    unsigned long max_total_time = 0;
+    unsigned long seed = 0;
+    enum cost cost = costCoverage;
+    const char *worst = NULL;
+    bool ranking = false;
+    double max_growth = 0.0;
+    struct corpus corpus = { NULL, 0, 0 };
+    struct shared *shared;
+    size_t seed_edges;
+    pid_t pid[JOBS_MAX];
+    size_t running;
+    double start, report;
+    int r = EXIT_SUCCESS;
+
+    LLVMFuzzerInitialize(&argc, &argv);
+
+    for (int i = 1; i < argc; ++i) {
+        if (sscanf(argv[i], "-jobs=%zu", &jobs) == 1) {
+            ;
+        } else if (sscanf(argv[i], "-runs=%lu", &runs) == 1) {
+            ;
+        } else if (sscanf(argv[i], "-max_total_time=%lu", &max_total_time) == 1) {
+            ;
+        } else if (sscanf(argv[i], "-seed=%lu", &seed) == 1) {
+            ;
+        } else if (!strcmp(argv[i], "-cost=ops")) {
+            cost = costOperations;
+        } else if (!strcmp(argv[i], "-cost=time")) {
+            cost = costTime;
+        } else if (!strncmp(argv[i], "-worst=", 7)) {
+            worst = &argv[i][7];
+        } else if (!strcmp(argv[i], "-report")) {
+            ranking = true;
+        } else if (sscanf(argv[i], "-max_growth=%lf", &max_growth) == 1) {
+            ;
+        } else if (argv[i][0] == '-') {
+            usage(argv[0]);
+            return EXIT_FAILURE;
+        } else {
+            corpus_load(&corpus, argv[i]);
+        }
+    }
+
+    if (jobs < 1 || jobs > JOBS_MAX) {
+        fprintf(stderr, "jobs must be between 1 and %d\n", JOBS_MAX);
+        return EXIT_FAILURE;
+    }
+
+    if (ranking) {
+        if (!corpus.count) {
+            usage(argv[0]);
+            return EXIT_FAILURE;
+        }
+        r = report_growth(&corpus, max_growth) ? EXIT_FAILURE : EXIT_SUCCESS;
+        corpus_free(&corpus);
+        return r;
+    }
+
+    if (!corpus.count) {
+        corpus_add(&corpus, (const uint8_t *)"", 0);
+    }
+
+    shared = mmap(NULL, sizeof(*shared), PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    if (shared == MAP_FAILED) {
+        perror("mmap");
+        return EXIT_FAILURE;
+    }
+
+    for (size_t i = 0; i < corpus.count; ++i) {
+        execute(shared, corpus.input[i].data, corpus.input[i].size);
+        corpus.input[i].cost = cost_of(cost, corpus.input[i].size);
+    }
+    seed_edges = count_edges(shared);
+
+    printf("#0 seeds: %zu jobs: %zu cov: %zu\n", corpus.count, jobs, seed_edges);
+    fflush(stdout);
+
+    for (size_t job = 0; job < jobs; ++job) {
+        unsigned long share = runs / jobs + (job < runs % jobs);
+        if (runs && !share) {
+            pid[job] = 0;
+            continue;
+        }
+        pid[job] = fork();
+        if (pid[job] == -1) {
+            perror("fork");
+            return EXIT_FAILURE;
+        }
+        if (pid[job] == 0) {
+            job_run(shared, &corpus, job, cost, share, seed);
+            _exit(EXIT_SUCCESS);
+        }
+    }
+
+    start = report = now();
+    running = jobs;
+
+    while (running) {
+        struct timespec pause = { 0, 10 * 1000 * 1000 };
+        double t;
+
+        for (size_t job = 0; job < jobs; ++job) {
+            int status;
+            if (pid[job] <= 0) {
+                continue;
+            }
+            if (waitpid(pid[job], &status, WNOHANG) != pid[job]) {
+                continue;
+            }
+            pid[job] = 0;
+            if (!WIFEXITED(status) || WEXITSTATUS(status) != EXIT_SUCCESS) {
+                crash(shared, job, status);
+                r = EXIT_FAILURE;
+            }
+        }
+
+        running = 0;
+        for (size_t job = 0; job < jobs; ++job) {
+            running += pid[job] > 0;
+        }
+
+        t = now();
+        if ((max_total_time && t - start >= (double)max_total_time) || r != EXIT_SUCCESS) {
+            for (size_t job = 0; job < jobs; ++job) {
+                if (pid[job] > 0) {
+                    kill(pid[job], SIGKILL);
+                    waitpid(pid[job], NULL, 0);
+                    pid[job] = 0;
+                }
+            }
+            running = 0;
+        }
+
+        if (t - report >= 1.0) {
+            unsigned long execs = total(shared, jobs);
+            size_t edges = count_edges(shared);
+            printf("#%lu exec/s: %.0f cov: %zu new: %zu\n", execs, (double)execs / (t - start), edges, edges - seed_edges);
+            fflush(stdout);
+            report = t;
+        }
+
+        if (running) {
+            nanosleep(&pause, NULL);
+        }
+    }
+
+    {
+        double elapsed = now() - start;
+        unsigned long execs = total(shared, jobs);
+        size_t edges = count_edges(shared);
+        printf("Done %lu runs in %.1f s, exec/s: %.0f cov: %zu new: %zu\n",
+               execs, elapsed, elapsed > 0 ? (double)execs / elapsed : 0.0, edges, edges - seed_edges);
+    }
+
+    if (cost != costCoverage) {
+        save_worst(shared, jobs, cost, worst);
+    }
+
+    corpus_free(&corpus);
+    munmap(shared, sizeof(*shared));
+
+    return r;
+}
@@ -0,0 +1,492 @@
+#include "ir.h"
+
+#include "code-point.h"
+#include "program.h"
+#include "scan.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <wctype.h>
+
+/// Translation state.
+struct builder {
+    struct ir *ir;
+    const struct effect *effect;
+    const struct program *program;
+
+    /// Registers of the stack cells, bottom first.
+    unsigned cell[VERIFY_DEPTH];
+    size_t depth;
+
+    /// Input cells consumed so far.
+    size_t in;
+
+    /// Numbers known at load time, for pick and roll.
+    bool known[IR_REGISTERS];
+    int value[IR_REGISTERS];
+
+    /// Variables, and lambda indices plus one, known at load time, for calls.
+    int variable[IR_REGISTERS];
+    unsigned lambda[IR_REGISTERS];
+
+    /// Calls being inlined.
+    size_t inlined;
+};
+
+/// Ensure that the stack holds at least @c n cells, by consuming input cells.
+static bool materialize(struct builder *b, size_t n)
+{
+    while (b->depth < n) {
+        if (b->in == b->effect->in || b->depth == VERIFY_DEPTH) {
+            return false;
+        }
+        memmove(&b->cell[1], &b->cell[0], b->depth * sizeof(unsigned));
+        b->cell[0] = (unsigned)b->in++;
+        b->depth++;
+    }
+    return true;
+}
+
+static bool push(struct builder *b, unsigned r)
+{
+    if (b->depth == VERIFY_DEPTH) {
+        return false;
+    }
+    b->cell[b->depth++] = r;
+    return true;
+}
+
+static bool pop(struct builder *b, unsigned *r)
+{
+    if (!materialize(b, 1)) {
+        return false;
+    }
+    *r = b->cell[--b->depth];
+    return true;
+}
+
+/// Pop a number that is known at load time.
+static bool pop_index(struct builder *b, size_t *n)
+{
+    unsigned r;
+    if (!pop(b, &r) || !b->known[r] || b->value[r] < 0) {
+        return false;
+    }
+    *n = (size_t)b->value[r];
+    return true;
+}
+
+/// Allocate register @c r.
+static bool allocate(struct builder *b, unsigned *r)
+{
+    if (b->ir->registers == IR_REGISTERS) {
+        return false;
+    }
+    *r = (unsigned)b->ir->registers++;
+    b->known[*r] = false;
+    b->variable[*r] = 0;
+    b->lambda[*r] = 0;
+    return true;
+}
+
+/// Append instruction @c insn.
+static void emit(struct builder *b, struct ir_insn insn)
+{
+    b->ir->insn = (struct ir_insn *)realloc(b->ir->insn, (b->ir->count + 1) * sizeof(struct ir_insn));
+    b->ir->insn[b->ir->count++] = insn;
+}
+
+static struct ir_insn make(enum ir_op op, const struct symbol *symbol)
+{
+    struct ir_insn insn;
+    memset(&insn, 0, sizeof(insn));
+    insn.op = op;
+    insn.wc = symbol->wc;
+    insn.pos = symbol->pos;
+    return insn;
+}
+
+/// @return unsigned Bit of @c variable, or all if not a variable that may be stored.
+static unsigned bit_of(int variable)
+{
+    if (variable < 'a' || variable > 'z') {
+        return IR_VARIABLES;
+    }
+    return 1u << (variable - 'a');
+}
+
+/// Push a new register holding @c token.
+static bool constant(struct builder *b, const struct symbol *symbol, struct token token)
+{
+    struct ir_insn insn = make(irConstant, symbol);
+    if (!allocate(b, &insn.dst)) {
+        return false;
+    }
+    insn.constant = token;
+    insn.invariant = true;
+    if (token.tok == tokNumber) {
+        b->known[insn.dst] = true;
+        b->value[insn.dst] = token.u.number;
+    } else if (token.tok == tokVariable) {
+        b->variable[insn.dst] = token.u.variable;
+    } else {
+        const struct lambda *lambda = program_lookup(b->program, token.u.lambda);
+        b->lambda[insn.dst] = lambda ? (unsigned)(lambda - b->program->lambda + 1) : 0;
+    }
+    emit(b, insn);
+    return push(b, insn.dst);
+}
+
+/// Pop @c in operands into @c y and @c x (in that order), and push @c out results.
+static bool operation(struct builder *b, const struct symbol *symbol, enum ir_op op, size_t in, size_t out)
+{
+    struct ir_insn insn = make(op, symbol);
+
+    if ((in > 0 && !pop(b, in == 1 ? &insn.x : &insn.y)) || (in > 1 && !pop(b, &insn.x))) {
+        return false;
+    }
+
+    for (size_t i = 0; i < out; ++i) {
+        unsigned r;
+        if (!allocate(b, &r) || !push(b, r)) {
+            return false;
+        }
+        if (i == 0) {
+            insn.dst = r;
+        }
+    }
+
+    emit(b, insn);
+    return true;
+}
+
+/// Rename registers for a stack shuffle.
+static bool shuffle(struct builder *b, wchar_t wc)
+{
+    size_t n;
+    unsigned r;
+
+    switch (wc) {
+        case '\\':
+            if (!materialize(b, 2)) {
+                return false;
+            }
+            r = b->cell[b->depth - 1];
+            b->cell[b->depth - 1] = b->cell[b->depth - 2];
+            b->cell[b->depth - 2] = r;
+            return true;
+
+        case '$':
+            return materialize(b, 1) && push(b, b->cell[b->depth - 1]);
+
+        case '%':
+            return pop(b, &r);
+
+        case '@':
+            if (!materialize(b, 3)) {
+                return false;
+            }
+            r = b->cell[b->depth - 3];
+            memmove(&b->cell[b->depth - 3], &b->cell[b->depth - 2], 2 * sizeof(unsigned));
+            b->cell[b->depth - 1] = r;
+            return true;
+
+        case LATIN_SMALL_LETTER_O_WITH_STROKE:
+        case 'O':
+            return pop_index(b, &n)
+                && materialize(b, n + 1)
+                && push(b, b->cell[b->depth - 1 - n]);
+    }
+
+    if (!b->program->extensions) {
+        return false;
+    }
+
+    switch (wc) {
+        case POUND_SIGN:
+            return materialize(b, 2) && push(b, b->cell[b->depth - 2]);
+
+        case PER_MILLE_SIGN:
+            if (!materialize(b, 2)) {
+                return false;
+            }
+            b->cell[b->depth - 2] = b->cell[b->depth - 1];
+            b->depth--;
+            return true;
+
+        case EURO_SIGN:
+            if (!materialize(b, 2) || !push(b, b->cell[b->depth - 1])) {
+                return false;
+            }
+            r = b->cell[b->depth - 2];
+            b->cell[b->depth - 2] = b->cell[b->depth - 3];
+            b->cell[b->depth - 3] = r;
+            return true;
+
+        case LATIN_CAPITAL_LETTER_O_WITH_STROKE:
+            return materialize(b, 2)
+                && push(b, b->cell[b->depth - 2])
+                && push(b, b->cell[b->depth - 2]);
+
+        case TRADE_MARK_SIGN:
+            if (!pop_index(b, &n) || !materialize(b, n + 1)) {
+                return false;
+            }
+            r = b->cell[b->depth - 1 - n];
+            memmove(&b->cell[b->depth - 1 - n], &b->cell[b->depth - n], n * sizeof(unsigned));
+            b->cell[b->depth - 1] = r;
+            return true;
+    }
+
+    return false;
+}
+
+static bool block(struct builder *b, struct slice slice);
+
+/// Load a variable, or the lambda bound to it if known at load time.
+static bool load(struct builder *b, const struct symbol *symbol)
+{
+    const struct lambda *lambda;
+    int variable;
+
+    if (!materialize(b, 1)) {
+        return false;
+    }
+
+    variable = b->variable[b->cell[b->depth - 1]];
+    lambda = program_binding(b->program, variable);
+    if (lambda) {
+        b->depth--;
+        return constant(b, symbol, token_make_lambda(lambda->slice));
+    }
+
+    if (!operation(b, symbol, irLoad, 1, 1)) {
+        return false;
+    }
+
+    if (variable) {
+        b->ir->insn[b->ir->count - 1].invariant = true;
+        b->ir->insn[b->ir->count - 1].reads = bit_of(variable);
+    }
+    return true;
+}
+
+/// Store a variable, noting which may be stored.
+static bool store(struct builder *b, const struct symbol *symbol)
+{
+    if (!materialize(b, 1)) {
+        return false;
+    }
+    b->ir->stores |= bit_of(b->variable[b->cell[b->depth - 1]]);
+    return operation(b, symbol, irStore, 2, 0);
+}
+
+/// Inline the call of a short lambda known at load time.
+static bool call(struct builder *b)
+{
+    const struct lambda *lambda;
+    unsigned r;
+    bool ok;
+
+    if (!pop(b, &r) || !b->lambda[r] || b->inlined == IR_INLINE_DEPTH) {
+        return false;
+    }
+
+    lambda = &b->program->lambda[b->lambda[r] - 1];
+    if (slice_length(lambda->slice) > IR_INLINE_LENGTH) {
+        return false;
+    }
+
+    b->inlined++;
+    ok = block(b, lambda->slice);
+    b->inlined--;
+
+    return ok;
+}
+
+/// Translate operator @c symbol.
+static bool translate(struct builder *b, const struct symbol *symbol)
+{
+    wchar_t wc = symbol->wc;
+
+    switch (wc) {
+        case '\\':
+        case '$':
+        case '%':
+        case '@':
+        case LATIN_SMALL_LETTER_O_WITH_STROKE:
+        case 'O':
+            return shuffle(b, wc);
+
+        case '=':
+        case '+':
+        case '-':
+        case '*':
+        case '/':
+        case '>':
+        case '&':
+        case '|':
+            return operation(b, symbol, irBinary, 2, 1);
+
+        case '_':
+        case '~':
+            return operation(b, symbol, irUnary, 1, 1);
+
+        case '^':
+            return operation(b, symbol, irInput, 0, 1);
+
+        case '.':
+            return operation(b, symbol, irEmitNumber, 1, 0);
+
+        case ',':
+            return operation(b, symbol, irEmitChar, 1, 0);
+
+        case LATIN_SMALL_LETTER_SHARP_S:
+        case 'B':
+            return operation(b, symbol, irFlush, 0, 0);
+
+        case ':':
+            return store(b, symbol);
+
+        case ';':
+            return load(b, symbol);
+
+        case '!':
+            return call(b);
+    }
+
+    if (b->program->extensions) {
+        switch (wc) {
+            case POUND_SIGN:
+            case PER_MILLE_SIGN:
+            case EURO_SIGN:
+            case LATIN_CAPITAL_LETTER_O_WITH_STROKE:
+            case TRADE_MARK_SIGN:
+                return shuffle(b, wc);
+
+            case SECTION_SIGN:
+                {
+                    // Inputs not yet consumed are still on the stack, below the cells.
+                    struct ir_insn insn = make(irDepth, symbol);
+                    insn.x = (unsigned)(b->effect->in - b->in + b->depth);
+                    if (!allocate(b, &insn.dst)) {
+                        return false;
+                    }
+                    emit(b, insn);
+                    return push(b, insn.dst);
+                }
+
+            case NOT_EQUAL_TO:
+            case '<':
+            case LEFT_POINTING_DOUBLE_ANGLE_QUOTATION_MARK:
+            case RIGHT_POINTING_DOUBLE_ANGLE_QUOTATION_MARK:
+            case LESS_THAN_OR_EQUAL_TO:
+            case GREATER_THAN_OR_EQUAL_TO:
+            case XOR:
+                return operation(b, symbol, irBinary, 2, 1);
+
+            case DIVISION_SIGN:
+                return operation(b, symbol, irDivide, 2, 2);
+
+            case INTEGRAL:
+                return operation(b, symbol, irAssert, 1, 0);
+        }
+    }
+
+    if (iswlower(wc)) {
+        return constant(b, symbol, token_make_variable(wc));
+    }
+
+    // Conditionals, loops, reverse, code injection, and unknown symbols.
+    return false;
+}
+
+/// Translate the symbols of @c slice.
+static bool block(struct builder *b, struct slice slice)
+{
+    struct scanner scanner;
+    struct symbol symbol;
+    bool ok = true;
+
+    scan_init(&scanner, slice);
+
+    while (ok && (symbol = scan_next(&scanner)).sym != symEnd) {
+        switch (symbol.sym) {
+            case symNumber:
+            case symCharacter:
+                ok = constant(b, &symbol, token_make_number(symbol.number));
+                break;
+
+            case symLambda:
+                ok = constant(b, &symbol, token_make_lambda(symbol.slice));
+                break;
+
+            case symString:
+                {
+                    struct ir_insn insn = make(irEmitString, &symbol);
+                    insn.string = symbol.slice;
+                    emit(b, insn);
+                }
+                break;
+
+            case symOperator:
+                b->ir->operations++;
+                ok = translate(b, &symbol);
+                break;
+
+            default:
+                ok = false;
+                break;
+        }
+    }
+
+    return ok;
+}
+
+void ir_compile(const struct program *program, struct slice slice, const struct effect *effect, struct ir *ir)
+{
+    struct builder *b;
+    bool ok;
+
+    memset(ir, 0, sizeof(*ir));
+
+    if (!effect->proven) {
+        return;
+    }
+
+    b = (struct builder *)malloc(sizeof(struct builder));
+    b->ir = ir;
+    b->effect = effect;
+    b->program = program;
+    b->depth = 0;
+    b->in = 0;
+    b->inlined = 0;
+
+    // Input cells occupy the first registers.
+    ir->in = effect->in;
+    ir->registers = effect->in;
+    memset(b->known, 0, sizeof(b->known));
+    memset(b->variable, 0, sizeof(b->variable));
+    memset(b->lambda, 0, sizeof(b->lambda));
+
+    ok = block(b, slice);
+
+    // All inputs must be accounted for, as they are replaced by the outputs.
+    if (ok && b->in == effect->in) {
+        ir->valid = true;
+        ir->outs = b->depth;
+        ir->out = (unsigned *)malloc((b->depth ? b->depth : 1) * sizeof(unsigned));
+        memcpy(ir->out, b->cell, b->depth * sizeof(unsigned));
+    } else {
+        ir_free(ir);
+    }
+
+    free(b);
+}
+
+void ir_free(struct ir *ir)
+{
+    free(ir->insn);
+    free(ir->out);
+    memset(ir, 0, sizeof(*ir));
+}
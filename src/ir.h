@@ -0,0 +1,126 @@
+#pragma once
+
+#include "slice.h"
+#include "token.h"
+#include "verify.h"
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <wchar.h>
+
+/// Most registers of a lambda, including its inputs.
+#define IR_REGISTERS 256
+
+/// Longest lambda, in bytes of source, inlined where it is called.
+#define IR_INLINE_LENGTH 64
+
+/// Most calls inlined within one another.
+#define IR_INLINE_DEPTH 4
+
+/// All variables, as bits (bit zero is @c a).
+#define IR_VARIABLES ((1u << 26) - 1)
+
+/// Register code operations.
+/// Stack shuffles have none, as they only rename registers at load time.
+enum ir_op {
+    /// @c r[dst] = constant
+    irConstant,
+
+    /// @c r[dst] = r[x] wc r[y], for arithmetic, comparison, and logic.
+    irBinary,
+
+    /// @c r[dst] = wc r[x]
+    irUnary,
+
+    /// @c r[dst] = remainder and @c r[dst + 1] = quotient of @c r[x] and @c r[y].
+    irDivide,
+
+    /// @c r[dst] = depth of the stack below the inputs, plus @c x.
+    irDepth,
+
+    /// @c r[dst] = value of variable @c r[x]
+    irLoad,
+
+    /// Set variable @c r[y] to @c r[x].
+    irStore,
+
+    /// @c r[dst] = character read
+    irInput,
+
+    /// Emit @c r[x] as number.
+    irEmitNumber,
+
+    /// Emit @c r[x] as character.
+    irEmitChar,
+
+    /// Emit string @c string.
+    irEmitString,
+
+    /// Flush output.
+    irFlush,
+
+    /// Fail unless @c r[x] is non-zero.
+    irAssert
+};
+
+struct ir_insn {
+    enum ir_op op;
+
+    /// Operator.
+    wchar_t wc;
+
+    /// Points to the operator in the source, for error messages.
+    const char *pos;
+
+    unsigned dst;
+    unsigned x;
+    unsigned y;
+
+    /// Value of @c irConstant.
+    struct token constant;
+
+    /// Contents of @c irEmitString.
+    struct slice string;
+
+    /// True if the result is unchanged while the variables of @c reads are, so
+    /// that it need not be run again in a loop that does not store them.
+    bool invariant;
+    unsigned reads;
+};
+
+/// Register code of a straight-line lambda.
+struct ir {
+    /// True if the lambda was translated.
+    bool valid;
+
+    /// Input cells, loaded into the first registers (zero is top of stack).
+    size_t in;
+
+    /// Registers used.
+    size_t registers;
+
+    /// Registers holding the output cells, bottom first.
+    unsigned *out;
+    size_t outs;
+
+    struct ir_insn *insn;
+    size_t count;
+
+    /// Operators of the lambda, each executed once.
+    unsigned long operations;
+
+    /// Variables that may be stored, all if any is not known at load time.
+    unsigned stores;
+};
+
+struct program;
+
+/// Translate @c slice of @c program, whose stack effect is @c effect, to register code.
+/// @note Only lambdas proven by the verifier, without loops or whole stack
+/// rearrangement, are translated.  Calls are only translated by inlining short
+/// lambdas known at load time, including those of bound variables, as the
+/// verifier assumes that these hold their lambdas.
+void ir_compile(const struct program *program, struct slice slice, const struct effect *effect, struct ir *ir);
+
+/// Release register code.
+void ir_free(struct ir *ir);
@@ -0,0 +1,249 @@
+#include "memo.h"
+
+#include "code-point.h"
+#include "program.h"
+#include "scan.h"
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+bool memo_pure(const struct program *program, struct slice slice)
+{
+    struct scanner scanner;
+    struct symbol symbol;
+
+    scan_init(&scanner, slice);
+
+    while ((symbol = scan_next(&scanner)).sym != symEnd) {
+        switch (symbol.sym) {
+            case symLambda:
+                {
+                    const struct lambda *lambda = program_lookup(program, symbol.slice);
+                    if (!lambda || !lambda->pure) {
+                        return false;
+                    }
+                }
+                break;
+
+            case symOperator:
+                switch (symbol.wc) {
+                    case '^':
+                    case '.':
+                    case ',':
+                    case 'B':
+                    case LATIN_SMALL_LETTER_SHARP_S:
+                    case ':':
+                    case '`':
+                    case SECTION_SIGN:
+                    case REGISTERED_SIGN:
+                    case INVERTED_EXCLAMATION_MARK:
+                    case CENT_SIGN:
+                    case INFINITY_SIGN:
+                    case PILCROW_SIGN:
+                    case DAGGER:
+                    case DOUBLE_DAGGER:
+                    case MODIFIER_LETTER_CIRCUMFLEX_ACCENT:
+                    case CARON:
+                    case CEDILLA:
+                        return false;
+                }
+                break;
+
+            case symNumber:
+            case symCharacter:
+                break;
+
+            default:
+                return false;
+        }
+    }
+
+    return true;
+}
+
+/// FNV-1a step.
+static size_t mix(size_t hash, uintptr_t value)
+{
+    for (size_t i = 0; i < sizeof(value); ++i) {
+        hash ^= (value >> (i * 8)) & 0xff;
+        hash *= 0x100000001b3ull;
+    }
+    return hash;
+}
+
+static uintptr_t value_of(struct token token)
+{
+    switch (token.tok) {
+        case tokNumber:
+            return (uintptr_t)(unsigned)token.u.number;
+        case tokVariable:
+            return (uintptr_t)token.u.variable;
+        case tokLambda:
+            break;
+    }
+    return (uintptr_t)token.u.lambda.buf;
+}
+
+/// @return bool True if @c x and @c y are identical, comparing lambdas by position.
+static bool same(struct token x, struct token y)
+{
+    if (x.tok != y.tok) {
+        return false;
+    }
+    if (x.tok == tokLambda) {
+        return x.u.lambda.buf == y.u.lambda.buf && x.u.lambda.end == y.u.lambda.end;
+    }
+    return value_of(x) == value_of(y);
+}
+
+static size_t hash_of(size_t lambda, unsigned long version, size_t in, const struct token *input)
+{
+    size_t hash = (size_t)0xcbf29ce484222325ull;
+    hash = mix(hash, lambda);
+    hash = mix(hash, version);
+    for (size_t i = 0; i < in; ++i) {
+        hash = mix(hash, (uintptr_t)input[i].tok);
+        hash = mix(hash, value_of(input[i]));
+    }
+    return hash;
+}
+
+void memo_init(struct memo *memo, size_t capacity, size_t lambdas)
+{
+    memo->capacity = capacity;
+    memo->count = 0;
+
+    // Power of two, at least the capacity.
+    memo->buckets = 1;
+    while (memo->buckets < capacity) {
+        memo->buckets *= 2;
+    }
+    memo->bucket = (struct memo_entry **)calloc(memo->buckets, sizeof(struct memo_entry *));
+
+    memo->newest = NULL;
+    memo->oldest = NULL;
+
+    memo->arity = (size_t *)malloc((lambdas ? lambdas : 1) * sizeof(size_t));
+    for (size_t i = 0; i < lambdas; ++i) {
+        memo->arity[i] = SIZE_MAX;
+    }
+
+    memo->hits = 0;
+    memo->misses = 0;
+}
+
+void memo_free(struct memo *memo)
+{
+    struct memo_entry *entry = memo->newest;
+    while (entry) {
+        struct memo_entry *older = entry->older;
+        free(entry->token);
+        free(entry);
+        entry = older;
+    }
+    free(memo->bucket);
+    free(memo->arity);
+    memo->bucket = NULL;
+    memo->arity = NULL;
+    memo->newest = NULL;
+    memo->oldest = NULL;
+    memo->count = 0;
+}
+
+static void unlink_entry(struct memo *memo, struct memo_entry *entry)
+{
+    if (entry->newer) {
+        entry->newer->older = entry->older;
+    } else {
+        memo->newest = entry->older;
+    }
+    if (entry->older) {
+        entry->older->newer = entry->newer;
+    } else {
+        memo->oldest = entry->newer;
+    }
+}
+
+static void link_newest(struct memo *memo, struct memo_entry *entry)
+{
+    entry->newer = NULL;
+    entry->older = memo->newest;
+    if (memo->newest) {
+        memo->newest->newer = entry;
+    } else {
+        memo->oldest = entry;
+    }
+    memo->newest = entry;
+}
+
+const struct memo_entry *memo_lookup(struct memo *memo, size_t lambda, unsigned long version, size_t in, const struct token *input)
+{
+    size_t hash = hash_of(lambda, version, in, input);
+    struct memo_entry *entry;
+
+    for (entry = memo->bucket[hash & (memo->buckets - 1)]; entry; entry = entry->next) {
+        bool match = entry->hash == hash
+            && entry->lambda == lambda
+            && entry->version == version
+            && entry->in == in;
+        for (size_t i = 0; match && i < in; ++i) {
+            match = same(entry->token[i], input[i]);
+        }
+        if (match) {
+            unlink_entry(memo, entry);
+            link_newest(memo, entry);
+            return entry;
+        }
+    }
+
+    return NULL;
+}
+
+/// Remove least recently used entry.
+static void evict(struct memo *memo)
+{
+    struct memo_entry *entry = memo->oldest;
+    struct memo_entry **p = &memo->bucket[entry->hash & (memo->buckets - 1)];
+
+    while (*p != entry) {
+        p = &(*p)->next;
+    }
+    *p = entry->next;
+
+    unlink_entry(memo, entry);
+    free(entry->token);
+    free(entry);
+    memo->count--;
+}
+
+void memo_insert(struct memo *memo, size_t lambda, unsigned long version, size_t in, const struct token *input, size_t out, const struct token *output)
+{
+    struct memo_entry *entry;
+    size_t index;
+
+    if (!memo->capacity) {
+        return;
+    }
+
+    if (memo->count == memo->capacity) {
+        evict(memo);
+    }
+
+    entry = (struct memo_entry *)malloc(sizeof(struct memo_entry));
+    entry->lambda = lambda;
+    entry->version = version;
+    entry->in = in;
+    entry->out = out;
+    entry->token = (struct token *)malloc((in + out ? in + out : 1) * sizeof(struct token));
+    memcpy(entry->token, input, in * sizeof(struct token));
+    memcpy(&entry->token[in], output, out * sizeof(struct token));
+    entry->hash = hash_of(lambda, version, in, input);
+
+    index = entry->hash & (memo->buckets - 1);
+    entry->next = memo->bucket[index];
+    memo->bucket[index] = entry;
+
+    link_newest(memo, entry);
+    memo->count++;
+}
@@ -0,0 +1,73 @@
+#pragma once
+
+#include "slice.h"
+#include "token.h"
+
+#include <stdbool.h>
+#include <stddef.h>
+
+/// Most input cells of a memoized call.
+#define MEMO_INPUTS 8
+
+/// Most output cells of a memoized call.
+#define MEMO_OUTPUTS 64
+
+/// Cached result of a call.
+struct memo_entry {
+    /// Index of lambda.
+    size_t lambda;
+
+    /// Storage version, as variables read by the call must be unchanged.
+    unsigned long version;
+
+    /// Input cells followed by output cells, bottom first.
+    size_t in;
+    size_t out;
+    struct token *token;
+
+    size_t hash;
+
+    /// Next entry in hash bucket.
+    struct memo_entry *next;
+
+    /// Neighbours in order of use.
+    struct memo_entry *newer;
+    struct memo_entry *older;
+};
+
+/// Bounded cache of results of pure lambdas, evicting the least recently used.
+struct memo {
+    size_t capacity;
+    size_t count;
+
+    struct memo_entry **bucket;
+    size_t buckets;
+
+    struct memo_entry *newest;
+    struct memo_entry *oldest;
+
+    /// Input cells last consumed by each lambda, or @c SIZE_MAX if not yet called.
+    size_t *arity;
+
+    unsigned long hits;
+    unsigned long misses;
+};
+
+struct program;
+
+/// @return bool True if @c slice and its nested lambdas have no I/O, variable writes, array access, whole stack access, or tasks.
+/// @note Nested lambdas within @c slice must already have been analysed.
+bool memo_pure(const struct program *program, struct slice slice);
+
+/// Initialise cache of @c capacity entries for @c lambdas lambdas.
+void memo_init(struct memo *memo, size_t capacity, size_t lambdas);
+
+/// Release cache.
+void memo_free(struct memo *memo);
+
+/// Find result of @c lambda for @c in cells @c input.
+/// @return memo_entry Cached result, or NULL if not found.
+const struct memo_entry *memo_lookup(struct memo *memo, size_t lambda, unsigned long version, size_t in, const struct token *input);
+
+/// Add result of @c lambda, evicting the least recently used entry if full.
+void memo_insert(struct memo *memo, size_t lambda, unsigned long version, size_t in, const struct token *input, size_t out, const struct token *output);
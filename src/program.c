@@ -0,0 +1,311 @@
+#include "program.h"
+
+#include "code-point.h"
+#include "memo.h"
+#include "scan.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+/// Most passes verifying lambdas that call bound lambdas defined after them.
+#define PROGRAM_PASSES 8
+
+static int by_position(const void *x, const void *y)
+{
+    const struct lambda *lx = (const struct lambda *)x;
+    const struct lambda *ly = (const struct lambda *)y;
+    return (lx->slice.buf > ly->slice.buf) - (lx->slice.buf < ly->slice.buf);
+}
+
+static int by_buf(const void *x, const void *y)
+{
+    const struct slice *sx = (const struct slice *)x;
+    const struct slice *sy = (const struct slice *)y;
+    return (sx->buf > sy->buf) - (sx->buf < sy->buf);
+}
+
+/// Make room to append to an array of @c count elements of @c size bytes.
+/// @note Capacity doubles at each power of two, so that appending takes
+/// amortized constant time, rather than a copy of the array each time.
+static void *grow(void *array, size_t count, size_t size)
+{
+    if (count & (count - 1)) {
+        return array;
+    }
+    return realloc(array, (count ? 2 * count : 1) * size);
+}
+
+/// Append lambdas and strings found directly within @c slice.
+static void discover(struct program *program, struct slice slice)
+{
+    struct scanner scanner;
+    struct symbol symbol;
+
+    scan_init(&scanner, slice);
+
+    while ((symbol = scan_next(&scanner)).sym != symEnd && symbol.sym != symError) {
+        if (symbol.sym == symLambda) {
+            program->lambda = (struct lambda *)grow(program->lambda, program->count, sizeof(struct lambda));
+            memset(&program->lambda[program->count], 0, sizeof(struct lambda));
+            program->lambda[program->count++].slice = symbol.slice;
+        } else if (symbol.sym == symString) {
+            program->string = (struct slice *)grow(program->string, program->strings, sizeof(struct slice));
+            program->string[program->strings++] = symbol.slice;
+        }
+    }
+}
+
+/// @return bool True if @c symbol leaves a number on top of the stack, whatever its operands.
+static bool numeric(const struct symbol *symbol, bool extensions)
+{
+    if (symbol->sym == symNumber || symbol->sym == symCharacter) {
+        return true;
+    }
+    if (symbol->sym != symOperator) {
+        return false;
+    }
+
+    switch (symbol->wc) {
+        case '+':
+        case '-':
+        case '*':
+        case '/':
+        case '>':
+        case '=':
+        case '&':
+        case '|':
+        case '_':
+        case '~':
+        case '^':
+            return true;
+
+        case '<':
+        case NOT_EQUAL_TO:
+        case LEFT_POINTING_DOUBLE_ANGLE_QUOTATION_MARK:
+        case RIGHT_POINTING_DOUBLE_ANGLE_QUOTATION_MARK:
+        case LESS_THAN_OR_EQUAL_TO:
+        case GREATER_THAN_OR_EQUAL_TO:
+        case XOR:
+        case DIVISION_SIGN:
+        case INVERTED_EXCLAMATION_MARK:
+        case INFINITY_SIGN:
+            return extensions;
+    }
+
+    return false;
+}
+
+/// Count the assignments of @c slice to each variable in @c assigned, bind
+/// the variable of each to the lambda assigned, if any, and mark in @c other
+/// the variables assigned anything but a number.
+/// @return bool False if an assignment is to a computed variable, or @c slice is malformed.
+static bool assignments(struct program *program, struct slice slice, unsigned *assigned, unsigned *other)
+{
+    struct scanner scanner;
+    struct symbol symbol;
+    struct symbol variable;
+    struct symbol value;
+
+    scan_init(&scanner, slice);
+    memset(&variable, 0, sizeof(variable));
+    memset(&value, 0, sizeof(value));
+
+    while ((symbol = scan_next(&scanner)).sym != symEnd) {
+        if (symbol.sym == symError) {
+            return false;
+        }
+
+        if (symbol.sym == symOperator && symbol.wc == ':') {
+            const struct lambda *lambda = value.sym == symLambda ? program_lookup(program, value.slice) : NULL;
+            int v;
+
+            if (variable.sym != symOperator || variable.wc < 'a' || variable.wc > 'z') {
+                return false;
+            }
+
+            v = variable.wc - 'a';
+            assigned[v]++;
+            program->binding[v] = lambda ? (unsigned)(lambda - program->lambda + 1) : 0;
+            if (!numeric(&value, program->extensions)) {
+                *other |= 1u << v;
+            }
+        }
+
+        value = variable;
+        variable = symbol;
+    }
+
+    return true;
+}
+
+/// Find the variables bound to a lambda, or holding only numbers, throughout @c program.
+/// @return bool True if any variable is bound.
+static bool bind(struct program *program, bool fresh)
+{
+    bool any = false;
+    unsigned assigned[26] = { 0 };
+    unsigned other = 0;
+    bool known = assignments(program, program->source, assigned, &other);
+
+    for (size_t i = 0; known && i < program->count; ++i) {
+        known = assignments(program, program->lambda[i].slice, assigned, &other);
+    }
+
+    for (int v = 0; v < 26; ++v) {
+        if (!known || assigned[v] != 1) {
+            program->binding[v] = 0;
+        }
+        any = any || program->binding[v];
+    }
+
+    // Variables start as numbers, or numeric arguments.
+    program->numeric = known && fresh ? ~other & ((1u << 26) - 1) : 0;
+
+    return any;
+}
+
+/// Verify again the lambdas not proven, as they may call bound lambdas that were
+/// not yet verified.
+/// @return bool True if any more were proven.
+static bool reverify(struct program *program)
+{
+    bool more = false;
+
+    for (size_t i = program->count; i-- > 0; ) {
+        struct lambda *lambda = &program->lambda[i];
+        if (!lambda->effect.proven) {
+            verify_analyse(program, lambda->slice, &lambda->effect);
+            more = more || lambda->effect.proven;
+        }
+    }
+
+    if (!program->top.effect.proven) {
+        verify_analyse(program, program->source, &program->top.effect);
+        more = more || program->top.effect.proven;
+    }
+
+    return more;
+}
+
+/// Run load-time analyses of @c lambda.
+static void analyse(const struct program *program, struct lambda *lambda)
+{
+    verify_analyse(program, lambda->slice, &lambda->effect);
+    counted_analyse(lambda->slice, program->extensions, &lambda->counted);
+    lambda->pure = memo_pure(program, lambda->slice);
+}
+
+void program_init(struct program *program, struct slice source, bool extensions, bool fresh)
+{
+    size_t len = slice_length(source);
+    bool bound;
+
+    program->source = source;
+    program->extensions = extensions;
+    program->lambda = NULL;
+    program->count = 0;
+    program->index = (unsigned *)calloc(len + 1, sizeof(unsigned));
+    program->string = NULL;
+    program->strings = 0;
+    memset(program->binding, 0, sizeof(program->binding));
+    program->numeric = 0;
+
+    memset(&program->top, 0, sizeof(program->top));
+    program->top.slice = source;
+
+    // Breadth-first search of nested lambdas.
+    discover(program, source);
+    for (size_t i = 0; i < program->count; ++i) {
+        discover(program, program->lambda[i].slice);
+    }
+
+    // Empty tables are NULL, which qsort() does not take.
+    if (program->count) {
+        qsort(program->lambda, program->count, sizeof(struct lambda), by_position);
+    }
+    if (program->strings) {
+        qsort(program->string, program->strings, sizeof(struct slice), by_buf);
+    }
+
+    for (size_t i = 0; i < program->count; ++i) {
+        program->index[program->lambda[i].slice.buf - source.buf] = (unsigned)(i + 1);
+    }
+
+    bound = bind(program, fresh);
+
+    // Nested lambdas follow their parent, so analyse in reverse order.
+    for (size_t i = program->count; i-- > 0; ) {
+        analyse(program, &program->lambda[i]);
+    }
+
+    analyse(program, &program->top);
+
+    // Bound lambdas may be defined after the lambdas calling them.
+    for (size_t pass = 1; bound && pass < PROGRAM_PASSES; ++pass) {
+        bound = reverify(program);
+    }
+
+    // The program itself is entered with an empty stack.
+    program->top.effect.proven = program->top.effect.proven && program->top.effect.in == 0;
+}
+
+void program_free(struct program *program)
+{
+    free(program->lambda);
+    free(program->index);
+    free(program->string);
+    program->lambda = NULL;
+    program->index = NULL;
+    program->string = NULL;
+    program->count = 0;
+    program->strings = 0;
+}
+
+const struct lambda *program_lookup(const struct program *program, struct slice lambda)
+{
+    size_t offset;
+    unsigned index;
+
+    if (!program->index || lambda.buf < program->source.buf || lambda.buf > program->source.end) {
+        return NULL;
+    }
+
+    offset = (size_t)(lambda.buf - program->source.buf);
+    index = program->index[offset];
+    if (!index || program->lambda[index - 1].slice.end != lambda.end) {
+        return NULL;
+    }
+
+    return &program->lambda[index - 1];
+}
+
+const struct lambda *program_binding(const struct program *program, int variable)
+{
+    unsigned index;
+
+    if (variable < 'a' || variable > 'z') {
+        return NULL;
+    }
+
+    index = program->binding[variable - 'a'];
+    return index ? &program->lambda[index - 1] : NULL;
+}
+
+bool program_numeric(const struct program *program, int variable)
+{
+    if (variable < 'a' || variable > 'z') {
+        return false;
+    }
+    return program->numeric >> (variable - 'a') & 1;
+}
+
+const struct slice *program_string(const struct program *program, const char *pos)
+{
+    struct slice key = slice_make(pos, 0);
+
+    if (!program->strings) {
+        return NULL;
+    }
+
+    return (const struct slice *)bsearch(&key, program->string, program->strings, sizeof(struct slice), by_buf);
+}
@@ -0,0 +1,77 @@
+#pragma once
+
+#include "counted.h"
+#include "slice.h"
+#include "verify.h"
+
+#include <stdbool.h>
+#include <stddef.h>
+
+/// Load-time information about a lambda.
+struct lambda {
+    /// Lambda contents.
+    struct slice slice;
+
+    /// Stack effect.
+    struct effect effect;
+
+    /// Counted loop pattern.
+    struct counted counted;
+
+    /// True if calls may be memoized.
+    bool pure;
+};
+
+/// Load-time information about a program.
+struct program {
+    /// Program source.
+    struct slice source;
+
+    /// Extensions enabled.
+    bool extensions;
+
+    /// The program itself.
+    struct lambda top;
+
+    /// Lambdas, in source order.
+    struct lambda *lambda;
+    size_t count;
+
+    /// Maps source offset of lambda contents to lambda index plus one.
+    unsigned *index;
+
+    /// Index plus one of the lambda bound to each variable, or zero.
+    /// @note A variable is bound if its only assignment in the program stores a
+    /// lambda literal, as in @c "[...]f:", and no assignment is to a computed variable.
+    unsigned binding[26];
+
+    /// Variables (bit zero is @c a) that only ever hold numbers.
+    /// @note Each assignment to such a variable stores a literal or the result of
+    /// an arithmetic operator, as in @c "i;1+i:", and none is to a computed variable.
+    unsigned numeric;
+
+    /// String literal contents, in source order.
+    /// @note Source and output share an encoding, so contents are emitted as is.
+    struct slice *string;
+    size_t strings;
+};
+
+/// Find and analyse the lambdas of @c source.
+/// @param fresh True if the variables start as numbers, as for a whole program, rather
+/// than holding whatever an earlier piece of the program left in them.
+void program_init(struct program *program, struct slice source, bool extensions, bool fresh);
+
+/// Release program information.
+void program_free(struct program *program);
+
+/// @return lambda Information about @c lambda, or NULL if unknown.
+const struct lambda *program_lookup(const struct program *program, struct slice lambda);
+
+/// @return lambda Lambda bound to @c variable, or NULL if not bound.
+const struct lambda *program_binding(const struct program *program, int variable);
+
+/// @return bool True if @c variable only ever holds numbers.
+bool program_numeric(const struct program *program, int variable);
+
+/// @return slice String literal whose contents start at @c pos, or NULL if unknown.
+const struct slice *program_string(const struct program *program, const char *pos);
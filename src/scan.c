@@ -0,0 +1,228 @@
+#include "scan.h"
+
+#include <string.h>
+#include <wctype.h>
+
+void scan_init(struct scanner *scanner, struct slice slice)
+{
+    scanner->slice = slice;
+    memset(&scanner->mbstate, 0, sizeof(scanner->mbstate));
+}
+
+/// Decode character at cursor without consuming it.
+/// @return size_t Width of character, or zero if malformed.
+static size_t peek(const struct scanner *scanner, wchar_t *wc)
+{
+    mbstate_t mbstate = scanner->mbstate;
+    size_t width = mbrtowc(wc, scanner->slice.buf, slice_length(scanner->slice), &mbstate);
+    if (width == 0 || width > 4) {
+        return 0;
+    }
+    return width;
+}
+
+/// Decode and consume character at cursor.
+/// @return size_t Width of character, or zero if malformed.
+static size_t next(struct scanner *scanner, wchar_t *wc)
+{
+    size_t width = mbrtowc(wc, scanner->slice.buf, slice_length(scanner->slice), &scanner->mbstate);
+    if (width == 0 || width > 4) {
+        return 0;
+    }
+    scanner->slice.buf += width;
+    return width;
+}
+
+static struct symbol make(enum sym sym, const char *pos)
+{
+    struct symbol symbol;
+    symbol.sym = sym;
+    symbol.pos = pos;
+    symbol.wc = 0;
+    symbol.number = 0;
+    symbol.slice = slice_make(NULL, 0);
+    return symbol;
+}
+
+/// Read lambda contents following the opening bracket.
+static struct symbol lambda(struct scanner *scanner, struct symbol symbol)
+{
+    wchar_t nested = 0;
+    int nesting = 1;
+
+    symbol.slice = slice_make(scanner->slice.buf, 0);
+
+    while (scanner->slice.buf != scanner->slice.end) {
+        wchar_t wc;
+        size_t width = next(scanner, &wc);
+        if (!width) {
+            return make(symError, symbol.pos);
+        }
+
+        if (nested == '\'') {
+            nested = 0;
+        } else if (nested && wc == nested) {
+            nested = 0;
+        } else if (nested) {
+            ;
+        } else if (wc == '\'') {
+            nested = wc;
+        } else if (wc == '{') {
+            nested = '}';
+        } else if (wc == '"') {
+            nested = wc;
+        } else if (wc == '[') {
+            ++nesting;
+        } else if (wc == ']') {
+            if (--nesting == 0) {
+                return symbol;
+            }
+        }
+
+        symbol.slice.end += width;
+    }
+
+    return make(symError, symbol.pos);
+}
+
+struct symbol scan_next(struct scanner *scanner)
+{
+    for (;;) {
+        const char *pos = scanner->slice.buf;
+        struct symbol symbol = make(symEnd, pos);
+        wchar_t wc;
+
+        if (pos == scanner->slice.end) {
+            return symbol;
+        }
+
+        if (!next(scanner, &wc)) {
+            return make(symError, pos);
+        }
+
+        if (iswspace(wc)) {
+            continue;
+        }
+
+        if (iswdigit(wc)) {
+            symbol.sym = symNumber;
+            symbol.number = wc - '0';
+            while (scanner->slice.buf != scanner->slice.end && peek(scanner, &wc) && iswdigit(wc)) {
+                symbol.number *= 10;
+                symbol.number += wc - '0';
+                next(scanner, &wc);
+            }
+            return symbol;
+        }
+
+        switch (wc) {
+            case '{':
+                while (scanner->slice.buf != scanner->slice.end) {
+                    if (!next(scanner, &wc)) {
+                        return make(symError, pos);
+                    }
+                    if (wc == '}') {
+                        break;
+                    }
+                }
+                if (wc != '}') {
+                    return make(symError, pos);
+                }
+                continue;
+
+            case '\'':
+                if (scanner->slice.buf == scanner->slice.end || !next(scanner, &wc)) {
+                    return make(symError, pos);
+                }
+                symbol.sym = symCharacter;
+                symbol.number = wc;
+                return symbol;
+
+            case '"':
+                symbol.sym = symString;
+                symbol.slice = slice_make(scanner->slice.buf, 0);
+                while (scanner->slice.buf != scanner->slice.end) {
+                    size_t width = next(scanner, &wc);
+                    if (!width) {
+                        return make(symError, pos);
+                    }
+                    if (wc == '"') {
+                        return symbol;
+                    }
+                    symbol.slice.end += width;
+                }
+                return make(symError, pos);
+
+            case '[':
+                symbol.sym = symLambda;
+                return lambda(scanner, symbol);
+
+            case ']':
+            case '}':
+                return make(symError, pos);
+        }
+
+        symbol.sym = symOperator;
+        symbol.wc = wc;
+        return symbol;
+    }
+}
+
+void split_init(struct splitter *splitter)
+{
+    splitter->offset = 0;
+    splitter->cut = 0;
+    splitter->nesting = 0;
+    splitter->nested = 0;
+    memset(&splitter->mbstate, 0, sizeof(splitter->mbstate));
+}
+
+size_t split_next(struct splitter *splitter, const char *buf, size_t len)
+{
+    size_t n = 0;
+
+    while (n < len) {
+        mbstate_t mbstate = splitter->mbstate;
+        wchar_t wc;
+        size_t width = mbrtowc(&wc, &buf[n], len - n, &splitter->mbstate);
+
+        // Its bytes are given again with the rest of the character.
+        if (width == (size_t)-2) {
+            splitter->mbstate = mbstate;
+            break;
+        }
+
+        // Malformed input is reported when run; step over it a byte at a time.
+        if (width == 0 || width > 4) {
+            memset(&splitter->mbstate, 0, sizeof(splitter->mbstate));
+            wc = (unsigned char)buf[n];
+            width = 1;
+        }
+
+        n += width;
+
+        // As lambda() reads lambda contents, but also at the top level.
+        if (splitter->nested == '\'') {
+            splitter->nested = 0;
+        } else if (splitter->nested && wc == splitter->nested) {
+            splitter->nested = 0;
+        } else if (splitter->nested) {
+            ;
+        } else if (wc == '\'' || wc == '"') {
+            splitter->nested = wc;
+        } else if (wc == '{') {
+            splitter->nested = '}';
+        } else if (wc == '[') {
+            ++splitter->nesting;
+        } else if (wc == ']') {
+            if (splitter->nesting) {
+                --splitter->nesting;
+            }
+        } else if (wc == '\n' && !splitter->nesting) {
+            splitter->cut = splitter->offset + n;
+        }
+    }
+
+    splitter->offset += n;
+    return n;
+}
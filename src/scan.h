@@ -0,0 +1,70 @@
+#pragma once
+
+#include "slice.h"
+
+#include <wchar.h>
+
+/// Symbol classes.
+enum sym {
+    symEnd,
+    symError,
+    symNumber,
+    symCharacter,
+    symString,
+    symLambda,
+    symOperator
+};
+
+struct symbol {
+    enum sym sym;
+
+    /// Points to the first byte of the symbol.
+    const char *pos;
+
+    /// Operator.
+    wchar_t wc;
+
+    /// Value of number or character.
+    int number;
+
+    /// Contents of string or lambda.
+    struct slice slice;
+};
+
+struct scanner {
+    struct slice slice;
+    mbstate_t mbstate;
+};
+
+/// Initialise @c scanner to read symbols from @c slice.
+void scan_init(struct scanner *scanner, struct slice slice);
+
+/// Read next symbol, skipping whitespace and comments.
+/// @note Symbols are delimited exactly as the interpreter delimits them.
+/// @return symbol Next symbol, @c symEnd at end of slice, or @c symError if malformed.
+struct symbol scan_next(struct scanner *scanner);
+
+/// Finds where a program read a piece at a time may be split, after a newline outside
+/// any lambda, string, comment or character, delimiting symbols as @c scan_next does.
+struct splitter {
+    /// Bytes examined so far.
+    size_t offset;
+
+    /// Offset just after the last newline found outside any symbol.
+    size_t cut;
+
+    /// Lambdas open, and the character ending the string or comment open, or a quote
+    /// before a character.
+    int nesting;
+    wchar_t nested;
+
+    mbstate_t mbstate;
+};
+
+/// Initialise @c splitter to examine a program from its start.
+void split_init(struct splitter *splitter);
+
+/// Examine the next @c len bytes of the program, at @c buf, which follow those examined.
+/// @note A character incomplete at the end of @c buf is examined once given whole.
+/// @return size_t Bytes examined, those of such a character excluded.
+size_t split_next(struct splitter *splitter, const char *buf, size_t len);
@@ -1,13 +1,37 @@
 #include "stack.h"
 
 #include <assert.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 
-static struct {
+/// Rolls at most this deep shift the cells above in place; deeper rolls leave a gap.
+#define ROLL_SHIFT_MAX 64
+
+/// Stack, private to each thread.
+/// Cells are stored from index @c base, bottom first, or top first once reversed, so
+/// that reversing takes constant time and push and pop then work at the front.
+/// Deep rolls remove a cell from the middle of the stack by widening a gap at
+/// stored cell @c gap, rather than shifting every cell above it.  Repeated rolls at
+/// the same depth, or from the bottom, then take amortized constant time.
+static _Thread_local struct stack {
     struct token *stack;
     size_t depth;
+    size_t capacity;
+
+    /// Index of the first stored cell.
+    size_t base;
+
+    /// Stored cells from @c gap on are @c hole places further along.
+    /// @note @c gap is @c SIZE_MAX when there is no hole, and never zero.
+    size_t gap;
+    size_t hole;
+
+    /// True if the top of stack is stored first.
+    bool reversed;
+
+    size_t low;
     void (*fatal)(const char *msg);
     void (*log)(const char *op, const char *dump);
 } stack_;
@@ -17,10 +41,44 @@ void stack_init(void (*fatal)(const char *msg), void (*log)(const char *op, cons
     stack_.depth = 0;
     free(stack_.stack);
     stack_.stack = NULL;
+    stack_.capacity = 0;
+    stack_.base = 0;
+    stack_.gap = SIZE_MAX;
+    stack_.hole = 0;
+    stack_.reversed = false;
+    stack_.low = 0;
     stack_.fatal = fatal;
     stack_.log = log;
 }
 
+void stack_free(void)
+{
+    stack_.depth = 0;
+    free(stack_.stack);
+    stack_.stack = NULL;
+    stack_.capacity = 0;
+    stack_.base = 0;
+    stack_.gap = SIZE_MAX;
+    stack_.hole = 0;
+    stack_.reversed = false;
+}
+
+struct stack *stack_detach(void)
+{
+    struct stack *stack = (struct stack *)malloc(sizeof(struct stack));
+    *stack = stack_;
+    stack_.stack = NULL;
+    stack_free();
+    return stack;
+}
+
+void stack_attach(struct stack *stack)
+{
+    stack_free();
+    stack_ = *stack;
+    free(stack);
+}
+
 bool stack_empty(void)
 {
     return stack_.depth == 0;
@@ -31,14 +89,76 @@ size_t stack_size(void)
     return stack_.depth;
 }
 
-/// Log stack operation.
-static void slog(const char *op, char *rhs)
+/// Stored cell @c q.
+static inline struct token *slot(size_t q)
+{
+    return &stack_.stack[stack_.base + (q < stack_.gap ? q : q + stack_.hole)];
+}
+
+/// Cell @c i, counting from the bottom.
+static inline struct token *at(size_t i)
+{
+    return slot(stack_.reversed ? stack_.depth - 1 - i : i);
+}
+
+static void no_gap(void)
+{
+    stack_.gap = SIZE_MAX;
+    stack_.hole = 0;
+}
+
+/// Close the gap by shifting the cells after it down.
+static void close_gap(void)
+{
+    if (stack_.hole) {
+        struct token *cell = &stack_.stack[stack_.base];
+        memmove(&cell[stack_.gap], &cell[stack_.gap + stack_.hole],
+            (stack_.depth - stack_.gap) * sizeof(struct token));
+        no_gap();
+    }
+}
+
+/// Store the cells from index @c front, leaving room for as many again after them.
+static void relayout(size_t front)
+{
+    size_t capacity = front + 2 * stack_.depth;
+
+    close_gap();
+    if (capacity < 16) {
+        capacity = 16;
+    }
+    if (capacity > stack_.capacity) {
+        stack_.capacity = capacity;
+        stack_.stack = (struct token *)realloc(stack_.stack, stack_.capacity * sizeof(struct token));
+    }
+    memmove(&stack_.stack[front], &stack_.stack[stack_.base], stack_.depth * sizeof(struct token));
+    stack_.base = front;
+}
+
+/// Store the cells bottom first, without a gap.
+static void straighten(void)
 {
+    close_gap();
+    if (stack_.reversed) {
+        struct token *cell = &stack_.stack[stack_.base];
+        for (size_t i = 0; i < stack_.depth / 2; ++i) {
+            struct token token = cell[stack_.depth - 1 - i];
+            cell[stack_.depth - 1 - i] = cell[i];
+            cell[i] = token;
+        }
+        stack_.reversed = false;
+    }
+}
+
+void stack_log(const char *op, const struct token *token)
+{
+    char *rhs;
+
     if (!stack_.log) {
-        free(rhs);
         return;
     }
 
+    rhs = token ? token_print(*token) : NULL;
     if (rhs) {
         if (*rhs == '[' && strlen(rhs) > 4) {
             // Concise format.
@@ -52,7 +172,7 @@ static void slog(const char *op, char *rhs)
     strcat(rhs, "\t");
 
     for (size_t i = 0; i < stack_.depth; ++i) {
-        char *buf = token_print(stack_.stack[i]);
+        char *buf = token_print(*at(i));
         rhs = (char *)realloc(rhs, strlen(rhs) + 1 /*SPC*/ + strlen(buf) + 1 /*NUL*/);
         strcat(rhs, " ");
         strcat(rhs, buf);
@@ -63,11 +183,26 @@ static void slog(const char *op, char *rhs)
     free(rhs);
 }
 
-/// Push @c token.
+/// Push @c token, growing the stack geometrically.
 static void push(struct token token)
 {
-    stack_.stack = (struct token *)realloc(stack_.stack, (stack_.depth + 1) * sizeof(struct token));
-    stack_.stack[stack_.depth++] = token;
+    if (stack_.reversed) {
+        if (stack_.base == 0) {
+            relayout(stack_.depth > 16 ? stack_.depth : 16);
+        }
+        stack_.base--;
+        stack_.depth++;
+        if (stack_.hole) {
+            stack_.gap++;
+        }
+        stack_.stack[stack_.base] = token;
+        return;
+    }
+
+    if (stack_.base + stack_.depth + stack_.hole == stack_.capacity) {
+        relayout(0);
+    }
+    *slot(stack_.depth++) = token;
 }
 
 /// Test that stack contains at least @c n elements.
@@ -76,20 +211,50 @@ static void require(size_t n)
     if (stack_.depth < n) {
         stack_.fatal("stack underflow");
     }
+    if (stack_.depth - n < stack_.low) {
+        stack_.low = stack_.depth - n;
+    }
+}
+
+/// Require element @c n from top of stack, where @c n may have wrapped from a negative number.
+static void require_index(size_t n)
+{
+    if (n >= stack_.depth) {
+        stack_.fatal("stack underflow");
+    }
+    if (stack_.depth - 1 - n < stack_.low) {
+        stack_.low = stack_.depth - 1 - n;
+    }
 }
 
 /// Duplicate top of stack.
 static void dup(void)
 {
-    require(1);
-    push(stack_.stack[stack_.depth - 1]);
+    push(*at(stack_.depth - 1));
 }
 
 /// Pop token.
 static struct token pop(void)
 {
-    require(1);
-    return stack_.stack[--stack_.depth];
+    struct token token;
+
+    stack_.depth--;
+    if (!stack_.reversed) {
+        token = *slot(stack_.depth);
+        if (stack_.depth == stack_.gap) {
+            // No cells remain after the gap.
+            no_gap();
+        }
+        return token;
+    }
+
+    token = stack_.stack[stack_.base++];
+    if (stack_.hole && --stack_.gap == 0) {
+        // No cells remain before the gap.
+        stack_.base += stack_.hole;
+        no_gap();
+    }
+    return token;
 }
 
 /// Rotate top three elements.
@@ -115,124 +280,240 @@ static void swap(void)
 void stack_push(struct token token)
 {
     push(token);
-    slog("push", token_print(token));
 }
 
 void stack_dup(void)
+{
+    require(1);
+    stack_dup_unchecked();
+}
+
+void stack_dup_unchecked(void)
 {
     dup();
-    slog("dup", NULL);
 }
 
 void stack_drop(void)
+{
+    require(1);
+    stack_drop_unchecked();
+}
+
+void stack_drop_unchecked(void)
 {
     pop();
-    slog("drop", NULL);
 }
 
 void stack_swap(void)
+{
+    require(2);
+    stack_swap_unchecked();
+}
+
+void stack_swap_unchecked(void)
 {
     swap();
-    slog("swap", NULL);
 }
 
 void stack_rot(void)
+{
+    require(3);
+    stack_rot_unchecked();
+}
+
+void stack_rot_unchecked(void)
 {
     rot();
-    slog("rot", NULL);
 }
 
 void stack_over(void)
 {
     require(2);
-    push(stack_.stack[stack_.depth - 2]);
-    slog("over", NULL);
+    stack_over_unchecked();
+}
+
+void stack_over_unchecked(void)
+{
+    push(*at(stack_.depth - 2));
 }
 
 void stack_nip(void)
+{
+    require(2);
+    stack_nip_unchecked();
+}
+
+void stack_nip_unchecked(void)
 {
     swap();
     pop();
-    slog("nip", NULL);
 }
 
 void stack_tuck(void)
+{
+    require(2);
+    stack_tuck_unchecked();
+}
+
+void stack_tuck_unchecked(void)
 {
     dup();
     rot();
     rot();
-    slog("tuck", NULL);
 }
 
 void stack_2dup(void)
 {
     require(2);
-    push(stack_.stack[stack_.depth - 2]);
-    push(stack_.stack[stack_.depth - 2]);
-    slog("2dup", NULL);
+    stack_2dup_unchecked();
+}
+
+void stack_2dup_unchecked(void)
+{
+    push(*at(stack_.depth - 2));
+    push(*at(stack_.depth - 2));
 }
 
 void stack_reverse(void)
 {
-    for (size_t i = 0; i < stack_.depth / 2; ++i) {
-        struct token token = stack_.stack[stack_.depth - 1 - i];
-        stack_.stack[stack_.depth - 1 - i] = stack_.stack[i];
-        stack_.stack[i] = token;
-    }
-    slog("rev", NULL);
+    stack_.low = 0;
+    stack_.reversed = !stack_.reversed;
 }
 
 void stack_pick(size_t n)
 {
-    require(n + 1);
-    push(stack_.stack[stack_.depth - 1 - n]);
-    slog("pick", NULL);
+    require_index(n);
+    stack_pick_unchecked(n);
+}
+
+void stack_pick_unchecked(size_t n)
+{
+    push(*at(stack_.depth - 1 - n));
 }
 
 void stack_roll(size_t n)
 {
-    size_t top;
-    size_t pos;
-    size_t len;
-    struct token token;
-    require(n + 1);
-    top = stack_.depth - 1;
-    pos = top - n;
-    len = top - pos;
-    token = stack_.stack[pos];
-    memmove(&stack_.stack[pos], &stack_.stack[pos + 1], len * sizeof(struct token));
-    stack_.stack[top] = token;
-    slog("roll", NULL);
+    require_index(n);
+    stack_roll_unchecked(n);
 }
 
-struct token stack_pop(void)
+void stack_roll_unchecked(size_t n)
 {
-    struct token token = pop();
-    slog("pop", token_print(token));
-    return token;
+    size_t pos = stack_.depth - 1 - n;
+    size_t q = stack_.reversed ? n : pos;
+    struct token token = *slot(q);
+    struct token *cell;
+
+    // Shallow roll clear of the gap: shift in place.
+    if (n < ROLL_SHIFT_MAX && !stack_.reversed && (stack_.hole == 0 || pos >= stack_.gap)) {
+        cell = slot(pos);
+        memmove(cell, cell + 1, n * sizeof(struct token));
+        cell[n] = token;
+        return;
+    }
+    if (n < ROLL_SHIFT_MAX && stack_.reversed && (stack_.hole == 0 || n < stack_.gap)) {
+        cell = slot(0);
+        memmove(cell + 1, cell, n * sizeof(struct token));
+        cell[0] = token;
+        return;
+    }
+
+    // Move the gap to the rolled cell, which widens it, then push the cell.
+    cell = &stack_.stack[stack_.base];
+    if (stack_.hole == 0) {
+        stack_.gap = q;
+    } else if (q < stack_.gap) {
+        memmove(&cell[q + 1 + stack_.hole], &cell[q + 1], (stack_.gap - q - 1) * sizeof(struct token));
+        stack_.gap = q;
+    } else if (q > stack_.gap) {
+        memmove(&cell[stack_.gap], &cell[stack_.gap + stack_.hole], (q - stack_.gap) * sizeof(struct token));
+        stack_.gap = q;
+    }
+    stack_.hole++;
+    stack_.depth--;
+
+    if (stack_.gap == 0) {
+        stack_.base += stack_.hole;
+        no_gap();
+    } else if (stack_.gap == stack_.depth) {
+        no_gap();
+    } else if (stack_.hole > stack_.depth) {
+        // Keep the hole no larger than the stack, so that memory stays linear.
+        close_gap();
+    }
+
+    push(token);
+}
+
+size_t stack_low(void)
+{
+    return stack_.low;
+}
+
+void stack_set_low(size_t low)
+{
+    stack_.low = low;
+}
+
+void stack_access(size_t n)
+{
+    require(n);
 }
 
-/// Pop token matching @c tok or fail with fatal error.
-static struct token stack_pop_tok(enum tok tok)
+struct token *stack_span(size_t n)
 {
-    struct token token = stack_pop();
-    if (token.tok != tok) {
-        stack_.fatal("stack type mismatch");
+    assert(n <= stack_.depth);
+    if (stack_.reversed ? n != 1 : stack_.hole && stack_.gap > stack_.depth - n) {
+        straighten();
     }
-    return token;
+    return at(stack_.depth - n);
 }
 
-int stack_pop_number(void)
+const struct token *stack_top(size_t n)
 {
-    return stack_pop_tok(tokNumber).u.number;
+    return stack_span(n);
 }
 
-int stack_pop_variable(void)
+void stack_discard(size_t n)
 {
-    return stack_pop_tok(tokVariable).u.variable;
+    assert(n <= stack_.depth);
+    stack_.depth -= n;
+    if (!stack_.reversed) {
+        if (stack_.gap >= stack_.depth) {
+            no_gap();
+        }
+    } else if (stack_.hole && stack_.gap <= n) {
+        // No cells remain before the gap.
+        stack_.base += n + stack_.hole;
+        no_gap();
+    } else {
+        stack_.base += n;
+        if (stack_.hole) {
+            stack_.gap -= n;
+        }
+    }
+}
+
+void stack_fill(struct token token, size_t n)
+{
+    for (size_t i = 0; i < n; ++i) {
+        push(token);
+    }
+}
+
+struct token stack_peek(size_t n)
+{
+    require_index(n);
+    return *at(stack_.depth - 1 - n);
+}
+
+struct token stack_pop(void)
+{
+    require(1);
+    return stack_pop_unchecked();
 }
 
-struct slice stack_pop_lambda(void)
+struct token stack_pop_unchecked(void)
 {
-    return stack_pop_tok(tokLambda).u.lambda;
+    return pop();
 }
@@ -5,9 +5,61 @@
 
 #include <stdbool.h>
 
+/*
+ Operations named "*_unchecked" omit underflow and type checks.  They may only
+ be used where the verifier has proven the shape of the stack.
+ */
+
+/*
+ Operations do not log themselves, so that interpreters that do not trace pay
+ nothing for it.  Those that do call @c stack_log after each operation.
+ */
+
 /// Initialise stack.
+/// @note @c log may be NULL.
 void stack_init(void (*fatal)(const char *msg), void (*log)(const char *op, const char *dump));
 
+/// Stack of a thread, set aside by @c stack_detach.
+struct stack;
+
+/// Set the stack of this thread aside, leaving it empty, so that the thread may run
+/// another program.
+/// @return stack Stack, to be restored by @c stack_attach.
+struct stack *stack_detach(void);
+
+/// Release the stack of this thread, and restore @c stack.
+void stack_attach(struct stack *stack);
+
+/// Log operation @c op, with operand @c token if not NULL, followed by the stack contents.
+void stack_log(const char *op, const struct token *token);
+
+/// Release stack memory.
+void stack_free(void);
+
+/// @return size_t Lowest position accessed by checked operations since @c stack_set_low.
+size_t stack_low(void);
+
+/// Reset lowest accessed position to @c low.
+void stack_set_low(size_t low);
+
+/// Record access to the top @c n elements.
+/// @note Calls @c fatal on underflow.
+void stack_access(size_t n);
+
+/// @return token The top @c n elements, bottom first, valid until the stack changes.
+/// @note The stack must hold at least @c n elements.
+const struct token *stack_top(size_t n);
+
+/// @return token The top @c n elements, as @c stack_top, to be updated in place.
+struct token *stack_span(size_t n);
+
+/// Drop the top @c n elements.
+/// @note The stack must hold at least @c n elements.
+void stack_discard(size_t n);
+
+/// Push @c n copies of @c token.
+void stack_fill(struct token token, size_t n);
+
 /// @return bool True if stack is empty.
 bool stack_empty(void);
 
@@ -20,34 +72,42 @@ void stack_push(struct token token);
 /// Duplicate top of stack.
 /// @note Calls @c fatal on underflow.
 void stack_dup(void);
+void stack_dup_unchecked(void);
 
 /// Drop top of stack.
 /// @note Calls @c fatal on underflow.
 void stack_drop(void);
+void stack_drop_unchecked(void);
 
 /// Swap top two elements.
 /// @note Calls @c fatal on underflow.
 void stack_swap(void);
+void stack_swap_unchecked(void);
 
 /// Rotate top three elements.
 /// @note Calls @c fatal on underflow.
 void stack_rot(void);
+void stack_rot_unchecked(void);
 
 /// Duplicate second item on stack.
 /// @note Calls @c fatal on underflow.
 void stack_over(void);
+void stack_over_unchecked(void);
 
 /// Drop second item on stack.
 /// @note Calls @c fatal on underflow.
 void stack_nip(void);
+void stack_nip_unchecked(void);
 
 /// Insert a copy of the top value into the stack two values from the top.
 /// @note Calls @c fatal on underflow.
 void stack_tuck(void);
+void stack_tuck_unchecked(void);
 
 //// Duplicate the top two stack items.
 /// @note Calls @c fatal on underflow.
 void stack_2dup(void);
+void stack_2dup_unchecked(void);
 
 /// Reverse stack content.
 void stack_reverse(void);
@@ -55,27 +115,20 @@ void stack_reverse(void);
 /// Pick element @c n.
 /// @note Calls @c fatal on underflow.
 void stack_pick(size_t n);
+void stack_pick_unchecked(size_t n);
 
 /// Roll element @c n to top of stack.
 /// @note Calls @c fatal on underflow.
 void stack_roll(size_t n);
+void stack_roll_unchecked(size_t n);
 
 /// Pop.
 /// @note Calls @c fatal on underflow.
 /// @return token Token.
 struct token stack_pop(void);
+struct token stack_pop_unchecked(void);
 
-/// Pop number.
-/// @note Calls @c fatal if top of stack is the wrong type.
-/// @return int Number.
-int stack_pop_number(void);
-
-/// Pop variable.
-/// @note Calls @c fatal if top of stack is the wrong type.
-/// @return int Variable.
-int stack_pop_variable(void);
-
-/// Pop lambda.
-/// @note Calls @c fatal if top of stack is the wrong type.
-/// @return slice Lambda.
-struct slice stack_pop_lambda(void);
+/// Peek at element @c n, where zero is top of stack.
+/// @note Calls @c fatal on underflow.
+/// @return token Token.
+struct token stack_peek(size_t n);
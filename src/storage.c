@@ -1,9 +1,12 @@
 #include "storage.h"
 
 #include <ctype.h>
+#include <stdlib.h>
 
-static struct {
+/// Variables, private to each thread.
+static _Thread_local struct storage {
     struct token token[26];
+    unsigned long version;
 } storage;
 
 void storage_clear(void)
@@ -13,6 +16,20 @@ void storage_clear(void)
     }
 }
 
+struct storage *storage_detach(void)
+{
+    struct storage *saved = (struct storage *)malloc(sizeof(struct storage));
+    *saved = storage;
+    storage_clear();
+    return saved;
+}
+
+void storage_attach(struct storage *saved)
+{
+    storage = *saved;
+    free(saved);
+}
+
 struct token storage_get(int c)
 {
     if (!islower(c)) {
@@ -27,4 +44,10 @@ void storage_set(int c, struct token token)
         return;
     }
     storage.token[c - 'a'] = token;
+    storage.version++;
+}
+
+unsigned long storage_version(void)
+{
+    return storage.version;
 }
@@ -5,9 +5,22 @@
 /// Clear storage.
 void storage_clear(void);
 
+/// Variables of a thread, set aside by @c storage_detach.
+struct storage;
+
+/// Set the variables of this thread aside, clearing them.
+/// @return storage Variables, to be restored by @c storage_attach.
+struct storage *storage_detach(void);
+
+/// Restore variables @c saved.
+void storage_attach(struct storage *saved);
+
 /// Get variable @c.
 /// @return token Token.
 struct token storage_get(int c);
 
 /// Set variable @c c to token @c token.
 void storage_set(int c, struct token token);
+
+/// @return unsigned long Count of writes, used to detect that variables may have changed.
+unsigned long storage_version(void);
@@ -0,0 +1,206 @@
+#include "task.h"
+
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+enum state {
+    statePending,
+    stateRunning,
+    stateDone
+};
+
+struct task {
+    void (*run)(void *arg);
+    void *arg;
+    enum state state;
+
+    /// Deque holding the task while pending.
+    struct deque *deque;
+};
+
+/// Pending tasks spawned by one thread, oldest first.
+struct deque {
+    struct task **task;
+    size_t top;
+    size_t bottom;
+    size_t capacity;
+};
+
+/// Worker pool, shared by all threads, and started by the first spawn.
+static struct {
+    pthread_once_t once;
+    pthread_mutex_t lock;
+
+    /// Signalled when a task is queued.
+    pthread_cond_t queued;
+
+    /// Broadcast when a task finishes.
+    pthread_cond_t finished;
+
+    /// Deques of the workers, then one shared by threads outside the pool.
+    struct deque *deque;
+    size_t deques;
+} pool_ = { PTHREAD_ONCE_INIT, PTHREAD_MUTEX_INITIALIZER, PTHREAD_COND_INITIALIZER, PTHREAD_COND_INITIALIZER, NULL, 0 };
+
+/// Deque of this thread, or NULL outside the pool.
+static _Thread_local struct deque *own_;
+
+static void push(struct deque *deque, struct task *task)
+{
+    if (deque->bottom == deque->capacity) {
+        if (deque->top) {
+            memmove(deque->task, &deque->task[deque->top], (deque->bottom - deque->top) * sizeof(struct task *));
+            deque->bottom -= deque->top;
+            deque->top = 0;
+        } else {
+            deque->capacity = deque->capacity ? 2 * deque->capacity : 16;
+            deque->task = (struct task **)realloc(deque->task, deque->capacity * sizeof(struct task *));
+        }
+    }
+    deque->task[deque->bottom++] = task;
+}
+
+/// Take the newest task of @c deque.
+static struct task *pop(struct deque *deque)
+{
+    struct task *task;
+
+    if (deque->top == deque->bottom) {
+        return NULL;
+    }
+    task = deque->task[--deque->bottom];
+    if (deque->top == deque->bottom) {
+        deque->top = deque->bottom = 0;
+    }
+    return task;
+}
+
+/// Take the oldest task of @c deque.
+static struct task *steal(struct deque *deque)
+{
+    struct task *task;
+
+    if (deque->top == deque->bottom) {
+        return NULL;
+    }
+    task = deque->task[deque->top++];
+    if (deque->top == deque->bottom) {
+        deque->top = deque->bottom = 0;
+    }
+    return task;
+}
+
+/// Remove @c task, which is usually the newest, from @c deque.
+static void withdraw(struct deque *deque, struct task *task)
+{
+    size_t i = deque->bottom;
+
+    while (deque->task[--i] != task) {
+    }
+    memmove(&deque->task[i], &deque->task[i + 1], (deque->bottom - i - 1) * sizeof(struct task *));
+    if (--deque->bottom == deque->top) {
+        deque->top = deque->bottom = 0;
+    }
+}
+
+/// Take a task for worker @c own, its own newest, or else the oldest of another thread.
+static struct task *take(struct deque *own)
+{
+    size_t index = (size_t)(own - pool_.deque);
+    struct task *task = pop(own);
+
+    for (size_t i = 1; !task && i < pool_.deques; ++i) {
+        task = steal(&pool_.deque[(index + i) % pool_.deques]);
+    }
+
+    return task;
+}
+
+static void *work(void *arg)
+{
+    own_ = (struct deque *)arg;
+
+    pthread_mutex_lock(&pool_.lock);
+
+    for (;;) {
+        struct task *task = take(own_);
+
+        if (!task) {
+            pthread_cond_wait(&pool_.queued, &pool_.lock);
+            continue;
+        }
+
+        task->state = stateRunning;
+        pthread_mutex_unlock(&pool_.lock);
+
+        task->run(task->arg);
+
+        pthread_mutex_lock(&pool_.lock);
+        task->state = stateDone;
+        pthread_cond_broadcast(&pool_.finished);
+    }
+
+    return NULL;
+}
+
+static void start(void)
+{
+    long processors = sysconf(_SC_NPROCESSORS_ONLN);
+    size_t workers = processors > 0 ? (size_t)processors : 1;
+    pthread_attr_t attr;
+
+    pool_.deque = (struct deque *)calloc(workers + 1, sizeof(struct deque));
+    pool_.deques = workers + 1;
+
+    pthread_attr_init(&attr);
+    pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+
+    // Without workers, tasks still run when joined.
+    for (size_t i = 0; i < workers; ++i) {
+        pthread_t thread;
+        pthread_create(&thread, &attr, work, &pool_.deque[i]);
+    }
+
+    pthread_attr_destroy(&attr);
+}
+
+struct task *task_spawn(void (*run)(void *arg), void *arg)
+{
+    struct task *task = (struct task *)malloc(sizeof(struct task));
+
+    pthread_once(&pool_.once, start);
+
+    task->run = run;
+    task->arg = arg;
+    task->state = statePending;
+
+    pthread_mutex_lock(&pool_.lock);
+    task->deque = own_ ? own_ : &pool_.deque[pool_.deques - 1];
+    push(task->deque, task);
+    pthread_cond_signal(&pool_.queued);
+    pthread_mutex_unlock(&pool_.lock);
+
+    return task;
+}
+
+void task_join(struct task *task)
+{
+    pthread_mutex_lock(&pool_.lock);
+
+    if (task->state == statePending) {
+        // Run it here, rather than wait for a worker to get to it.
+        withdraw(task->deque, task);
+        task->state = stateRunning;
+        pthread_mutex_unlock(&pool_.lock);
+        task->run(task->arg);
+    } else {
+        while (task->state != stateDone) {
+            pthread_cond_wait(&pool_.finished, &pool_.lock);
+        }
+        pthread_mutex_unlock(&pool_.lock);
+    }
+
+    free(task);
+}
@@ -0,0 +1,19 @@
+#pragma once
+
+/*
+ Fork-join tasks, run by a pool of one worker thread per processor.  Each worker
+ takes the newest task it spawned itself, and when it has none steals the oldest
+ task of another thread.  A task that no worker has started when it is joined is
+ run by the joining thread instead, so that joins never wait on queued work.
+ */
+
+/// Task queued by @c task_spawn.
+struct task;
+
+/// Queue @c run(arg) to be run by the pool.
+/// @note @c run may be called on the thread that joins the task, while it waits.
+/// @return task Task, to be waited for and released with @c task_join.
+struct task *task_spawn(void (*run)(void *arg), void *arg);
+
+/// Wait for @c task to finish, then release it.
+void task_join(struct task *task);
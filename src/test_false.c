@@ -1,12 +1,20 @@
 #include "false.h"
 
+#include "format.h"
+#include "scan.h"
 #include "storage.h"
+#include "vector.h"
 
 #include <assert.h>
+#include <limits.h>
 #include <locale.h>
+#include <pthread.h>
+#include <signal.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/wait.h>
+#include <unistd.h>
 #include <wchar.h>
 
 static void nop_fatal(const struct config config, const char *pos, const char *msg)
@@ -44,6 +52,19 @@ static int input(void)
     return -1;
 }
 
+static size_t input_string(char *buf, size_t len, int delim)
+{
+    size_t n = 0;
+
+    while (n < len && buffered_input && *buffered_input) {
+        buf[n++] = *buffered_input;
+        if ((unsigned char)*buffered_input++ == delim) {
+            break;
+        }
+    }
+    return n;
+}
+
 static void nop_flush(void)
 {
 }
@@ -56,9 +77,10 @@ static void capture_emit_number(int x)
     output_len += (size_t)snprintf(&output[output_len], sizeof(output) - output_len, "%d", x);
 }
 
-static void capture_emit_wchar(wchar_t wc)
+static void capture_emit_string(const char *buf, size_t len)
 {
-    output_len += wcrtomb(&output[output_len], wc, NULL);
+    memcpy(&output[output_len], buf, len);
+    output_len += len;
     output[output_len] = 0;
 }
 
@@ -68,6 +90,15 @@ static void capture_emit_char(char c)
     output[output_len] = 0;
 }
 
+static void capture_log_verify(const struct config config, const char *pos, const char *effect, bool proven)
+{
+    output_len += (size_t)snprintf(&output[output_len], sizeof(output) - output_len
+            , "%d %s %s\n"
+            , pos ? (int)(pos - config.str) : -1
+            , proven ? "proven" : "checked"
+            , effect);
+}
+
 static int testcase(struct config config, const char *input)
 {
     int r;
@@ -119,6 +150,15 @@ static void test_token(struct config config)
     assert(0 == r);
     assert(!strcmp(output, "hello"));
 
+    r = testcase(config, "[\"aä\"\"\"]$!!");
+    assert(0 == r);
+    assert(!strcmp(output, "aäaä"));
+
+    // Unterminated string is emitted, then fails.
+    r = testcase(config, "\"hello");
+    assert(1 == r);
+    assert(!strcmp(output, "hello"));
+
     r = testcase(config, "65,");
     assert(0 == r);
     assert(!strcmp(output, "A"));
@@ -216,6 +256,11 @@ static void test_token(struct config config)
     r = testcase(config, "22 0 ÷");
     assert(1 == r);
 
+    // The one quotient that overflows wraps.
+    r = testcase(config, "2147483647_1- 1_/. 2147483647_1- 1_÷..");
+    assert(0 == r);
+    assert(!strcmp(output, "-2147483648-21474836480"));
+
     r = testcase(config, "20 4 = .");
     assert(0 == r);
     assert(!strcmp(output, "0"));
@@ -354,6 +399,9 @@ static void test_token(struct config config)
     r = testcase(config, "1 2 3 3O ....");
     assert(1 == r);
 
+    r = testcase(config, "1 2 3 1_O ....");
+    assert(1 == r);
+
     r = testcase(config, "1 2 3 0™ ...");
     assert(0 == r);
     assert(!strcmp(output, "321"));
@@ -369,6 +417,9 @@ static void test_token(struct config config)
     r = testcase(config, "1 2 3 3™ ...");
     assert(1 == r);
 
+    r = testcase(config, "1 2 3 1_™ ...");
+    assert(1 == r);
+
     r = testcase(config, "['T,]t: 0~ t;?");
     assert(0 == r);
     assert(!strcmp(output, "T"));
@@ -398,68 +449,1508 @@ static void test_token(struct config config)
     assert(1 == r);
 }
 
-static void test_arguments(struct config config)
+static void test_format(void)
 {
-    char *args[] = { "stdin", "42", "string" };
+    char buf[FORMAT_NUMBER_MAX + 1];
+
+    buf[format_number(buf, 0)] = 0;
+    assert(!strcmp(buf, "0"));
+
+    buf[format_number(buf, 7)] = 0;
+    assert(!strcmp(buf, "7"));
+
+    buf[format_number(buf, 42)] = 0;
+    assert(!strcmp(buf, "42"));
+
+    buf[format_number(buf, 100)] = 0;
+    assert(!strcmp(buf, "100"));
+
+    buf[format_number(buf, -12345)] = 0;
+    assert(!strcmp(buf, "-12345"));
+
+    buf[format_number(buf, INT_MAX)] = 0;
+    assert(!strcmp(buf, "2147483647"));
+
+    buf[format_number(buf, INT_MIN)] = 0;
+    assert(!strcmp(buf, "-2147483648"));
+}
+
+static void test_verify(struct config config)
+{
+    char *args[] = { "stdin" };
     int r;
 
-    config.argc = 0;
-    config.argv = NULL;
-    r = testcase(config, "");
+    config.argc = 1;
+    config.argv = args;
+    config.log_verify = capture_log_verify;
+
+    output_len = 0;
+    config.str = "10 15 [$0=~][$@$@$@\\/*-]#%.";
+    r = verify(config);
+    assert(0 == r);
+    assert(!strcmp(output,
+                "-1 proven ( -- )\n"
+                "6 proven ( num -- num num )\n"
+                "12 proven ( num num -- num num )\n"));
+
+    output_len = 0;
+    config.str = "[[1ø]!]f: f;! [®]";
+    r = verify(config);
+    assert(1 == r);
+    assert(!strcmp(output,
+                "-1 checked ( ? )\n"
+                "0 proven ( x x -- x x x )\n"
+                "1 proven ( x x -- x x x )\n"
+                "15 checked ( ? )\n"));
+
+    // Proven lambda, with inputs of the wrong type.
+    r = testcase(config, "[+]f: 1 a f;!");
     assert(1 == r);
 
-    config.argc = 27;
-    config.argv = args;
-    r = testcase(config, "");
+    // Proven lambda, with too few inputs.
+    r = testcase(config, "[+]f: 1 f;!");
+    assert(1 == r);
+
+    r = testcase(config, "[\\%]f: a 2 f;! 2=∫");
+    assert(0 == r);
+
+    r = testcase(config, "[$0=~][$@$@$@\\/*-]g: c: 10 15 c;g;#%.");
+    assert(0 == r);
+    assert(!strcmp(output, "5"));
+
+    // Calls of variables bound to a lambda, and of one assigned twice.
+    output_len = 0;
+    config.str = "[f;!f;!]g: [1+]f: [2]h: [h;!]k: 3h:";
+    r = verify(config);
+    assert(0 == r);
+    assert(!strcmp(output,
+                "-1 proven ( -- )\n"
+                "0 proven ( num -- num )\n"
+                "11 proven ( num -- num )\n"
+                "18 proven ( -- num )\n"
+                "24 checked ( ? )\n"));
+
+    // No variable is bound when one is assigned that is not known at load time.
+    output_len = 0;
+    config.str = "[1+]f: [f;!]g: [0 f\\:]h:";
+    r = verify(config);
+    assert(0 == r);
+    assert(!strcmp(output,
+                "-1 proven ( -- )\n"
+                "0 proven ( num -- num )\n"
+                "7 checked ( ? )\n"
+                "15 checked ( ? )\n"));
+
+    // Variables only ever assigned numbers, but not one that may hold a lambda.
+    output_len = 0;
+    config.str = "0i: 9n: [n;i;>][i;1+i:]# [n;1+m;+]f: 1m: $m:";
+    r = verify(config);
+    assert(1 == r);
+    assert(!strcmp(output,
+                "-1 checked ( ? )\n"
+                "8 proven ( -- num )\n"
+                "15 proven ( -- )\n"
+                "25 checked ( ? )\n"));
+
+    r = testcase(config, "[f;!f;!]g: [1+]f: 1g;!.");
+    assert(0 == r);
+    assert(!strcmp(output, "3"));
+
+    r = testcase(config, "[[1+]f: f;!]g: 1g;!g;!.");
+    assert(0 == r);
+    assert(!strcmp(output, "3"));
+
+    // Called before the assignment has run.
+    r = testcase(config, "[f;!]g: 1g;! [1+]f:");
     assert(1 == r);
 
+    r = testcase(config, "[f;!]g: 1 2f: g;! [1+]f:");
+    assert(1 == r);
+}
+
+static void test_counted(struct config config)
+{
+    char *args[] = { "stdin" };
+    int r;
+
     config.argc = 1;
     config.argv = args;
-    r = testcase(config, "");
+
+    // Counted loops are not used while tracing.
+    config.log_trace = NULL;
+    config.log_stack = NULL;
+
+    r = testcase(config, "0i: [i;5<][i;. i;1+i:]#");
+    assert(0 == r);
+    assert(!strcmp(output, "01234"));
+
+    r = testcase(config, "0i: 5n: [n;i;>][i;. i;1+i:]#");
+    assert(0 == r);
+    assert(!strcmp(output, "01234"));
+
+    r = testcase(config, "0i: [i;3=~][i;. i;1+i:]# 0i: [3i;≠][i;. i;1+i:]# 0i: [i;2≤][i;. i;1+i:]# 0i: [2i;≥][i;. i;1+i:]#");
+    assert(0 == r);
+    assert(!strcmp(output, "012012012012"));
+
+    // Body writes the induction variable.
+    r = testcase(config, "0i: [i;10<][i;. i;3+i: i;1+i:]#");
+    assert(0 == r);
+    assert(!strcmp(output, "048"));
+
+    // Body writes the bound.
+    r = testcase(config, "0i: 5n: [i;n;<][i;. n;1-n: i;1+i:]#");
+    assert(0 == r);
+    assert(!strcmp(output, "012"));
+
+    // Bound is not a number.
+    r = testcase(config, "0i: 3n: [i;n;<][[0]n: i;1+i:]#");
+    assert(1 == r);
+
+    // Induction variable is not a number.
+    r = testcase(config, "bi: [i;3<][i;1+i:]#");
+    assert(1 == r);
+
+    r = testcase(config, "0i: [i;3<][[1]i: i;1+i:]#");
+    assert(1 == r);
+
+    config.limit = 1000;
+    r = testcase(config, "[1][]#");
+    assert(1 == r);
+
+    r = testcase(config, "0i: [i;1<][i;1+i:]#");
     assert(0 == r);
 
+    r = testcase(config, "0i: [i;1_=~][i;1+i:]#");
+    assert(1 == r);
+
+    config.limit = 0;
+
+    // Not counted loops.
+    r = testcase(config, "0i: [i;3<][i;2+i:]# [i;3<][i;1+j:]# [i;3<i;%][i;1+i:]# 0i: [i;3>][i;1+i:]#");
+    assert(0 == r);
+}
+
+static void capture_log_stats(const struct config config, const char *name, unsigned long value)
+{
+    (void)config;
+    if (!strcmp(name, "memo hits")) {
+        output_len += (size_t)snprintf(&output[output_len], sizeof(output) - output_len, " hits=%lu", value);
+    }
+}
+
+static void test_memo(struct config config)
+{
+    char *args[] = { "stdin", "20" };
+    struct config extended;
+    int r;
+
     config.argc = 2;
     config.argv = args;
-    r = testcase(config, "a;.':,b;.':,c;.");
+    config.memo = 16;
+
+    // Tracing disables the cache.
+    config.log_trace = NULL;
+    config.log_stack = NULL;
+
+    r = testcase(config, "[$1>[$1-f;!\\2-f;!+]?]f: b;f;!.");
     assert(0 == r);
-    assert(!strcmp(output, "1:42:0"));
+    assert(!strcmp(output, "6765"));
 
-    config.argc = 3;
-    config.argv = args;
-    r = testcase(config, "");
+    config.argc = 1;
+
+    config.log_stats = capture_log_stats;
+    r = testcase(config, "[1+]f: 1f;!. 1f;!. 2f;!.");
+    assert(0 == r);
+    assert(!strcmp(output, "223 hits=1"));
+    config.log_stats = NULL;
+    extended = config;
+
+    // No inputs, on the empty stack of a task, where nothing was pushed before.
+    extended.extensions = true;
+    r = testcase(extended, "[1]f: 0[f;!]† ‡.");
+    assert(0 == r);
+    assert(!strcmp(output, "1"));
+
+    // I/O.
+    r = testcase(config, "[1.]f: f;! f;!");
+    assert(0 == r);
+    assert(!strcmp(output, "11"));
+
+    // I/O by a lambda passed as input.
+    r = testcase(config, "[!]c: [2.]p: p;c;! p;c;!");
+    assert(0 == r);
+    assert(!strcmp(output, "22"));
+
+    // Variables read are unchanged.
+    r = testcase(config, "[x;]g: 1x: g;! 2x: g;! +.");
+    assert(0 == r);
+    assert(!strcmp(output, "3"));
+
+    // Variables written.
+    r = testcase(config, "[x;1+x:]g: g;! g;! x;.");
+    assert(0 == r);
+    assert(!strcmp(output, "2"));
+
+    // Inputs depend on values.
+    r = testcase(config, "[$[\\%]?]h: 5 0h;!.. 7 1h;!. 5 0h;!.. 9 1h;!.");
+    assert(0 == r);
+    assert(!strcmp(output, "051051"));
+
+    // Reading the whole stack.
+    r = testcase(config, "[!]c: [§]d: d;c;!. 1d;c;!. 2 3d;c;!. %%%");
+    assert(0 == r);
+    assert(!strcmp(output, "013"));
+
+    r = testcase(config, "[§]d: d;!. 1d;!. 2d;!. %%");
+    assert(0 == r);
+    assert(!strcmp(output, "012"));
+
+    r = testcase(config, "1 2 3 4 5 6 7 8 9 [§]d: d;!. 0d;!. %%%%%%%%%%");
+    assert(0 == r);
+    assert(!strcmp(output, "910"));
+
+    // Eviction.
+    config.memo = 1;
+    r = testcase(config, "[2*]f: 1f;!. 2f;!. 1f;!. 1f;!.");
+    assert(0 == r);
+    assert(!strcmp(output, "2422"));
+
+    // Fatal error within a call.
+    r = testcase(config, "[1-]f: af;!");
     assert(1 == r);
 }
 
-int main(void)
+static const char *fatal_pos;
+static const char *fatal_msg;
+
+static void capture_fatal(const struct config config, const char *pos, const char *msg)
 {
-    struct config config;
+    (void)config;
+    fatal_pos = pos;
+    fatal_msg = msg;
+}
 
-    config.extensions  = true;
-    config.fatal       = nop_fatal;
-    config.log_trace   = nop_log_trace;
-    config.log_stack   = NULL;
-    config.emit_number = capture_emit_number;
-    config.emit_wchar  = capture_emit_wchar;
-    config.emit_char   = capture_emit_char;
-    config.input       = input;
-    config.flush       = nop_flush;
+/// Run @c program with and without register code, expecting identical results.
+static void registers_same(struct config config, const char *program, const char *input)
+{
+    char expected[sizeof(output)];
+    const char *pos;
+    const char *msg;
+    int r;
 
-    // Test data includes UTF-8 encoded multibyte characters.
-    setlocale(LC_ALL, "en_US.UTF-8");
+    fatal_pos = NULL;
+    fatal_msg = NULL;
+    buffered_input = input;
+    config.registers = false;
+    r = testcase(config, program);
+    strcpy(expected, output);
+    pos = fatal_pos;
+    msg = fatal_msg;
+
+    fatal_pos = NULL;
+    fatal_msg = NULL;
+    buffered_input = input;
+    config.registers = true;
+    assert(r == testcase(config, program));
+    assert(!strcmp(expected, output));
+    assert(pos == fatal_pos);
+    assert(msg == fatal_msg || !strcmp(msg, fatal_msg));
+}
 
-    {
-        struct token token;
-        storage_set(',', token_make_number(42));
-        token = storage_get(',');
-        assert(token.tok == tokNumber);
-        assert(token.u.number == 0);
+static void test_registers(struct config config)
+{
+    char *args[] = { "stdin" };
+
+    config.argc = 1;
+    config.argv = args;
+    config.extensions = true;
+    config.fatal = capture_fatal;
+
+    // Tracing disables register code.
+    config.log_trace = NULL;
+    config.log_stack = NULL;
+
+    // Arithmetic, comparison, and logic.
+    registers_same(config, "1 2+. 5 3-. 4 5*. 9 2/. 3 2>. 6 3&. 6 3|. 3_. 0~.", NULL);
+    registers_same(config, "1 2<. 1 3«. 8 2». 2 2≤. 2 3≥. 5 3⊻. 7 3÷..", NULL);
+    registers_same(config, "1 1=. 1 2≠. a a=. a b≠. [1][1]=.", NULL);
+
+    // Shuffles.
+    registers_same(config, "1 2 3@... 1 2\\.. 1$.. 1 2%. 1 2 3 2O... 1 2 3 1ø....", NULL);
+    registers_same(config, "1 2£... 1 2‰. 1 2€... 1 2Ø.... 1 2 3 2™...", NULL);
+    registers_same(config, "1 2 3§....", NULL);
+    registers_same(config, "[§*]f: 1 2 3f;!...", NULL);
+
+    // Variables, I/O, and lambdas with inputs.
+    registers_same(config, "[5x: x;y: 'a, \"hi\" ß B ^. 1∫]f: f;! y;.", "z");
+    registers_same(config, "[\\$*+]f: 2 3f;!. [$1+]g: 1g;!g;!...", NULL);
+    registers_same(config, "0i: [i;3<][i;.i;1+i:]#", NULL);
+
+    // Inlined calls, of lambdas known at load time, and of bound variables.
+    registers_same(config, "[1+]f: [f;!f;!]g: [g;!g;!]h: 0h;!. 0[2*]!.", NULL);
+    registers_same(config, "[f;!]g: 1g;! [1+]f:", NULL);
+    registers_same(config, "[1 0/]f: [f;!]g: g;!", NULL);
+    registers_same(config, "[\"hi\"]f: [f;!]g: [g;!]h: [h;!]k: [k;!]l: [l;!]m: m;!", NULL);
+    registers_same(config, "[1 2 3 4 5 6 7 8 9 10 11 12 13 14 15 16 17 18 19 20 21 22 23 24 25+++++++++++++++++++++++]f: [f;!.]g: g;!", NULL);
+
+    // Errors.
+    registers_same(config, "1 0/", NULL);
+    registers_same(config, "1 0÷", NULL);
+    registers_same(config, "1_ 1«", NULL);
+    registers_same(config, "1 1_»", NULL);
+    registers_same(config, "1 32«", NULL);
+    registers_same(config, "0∫", NULL);
+    registers_same(config, "[1 0/]f: f;!", NULL);
+
+    config.limit = 3;
+    registers_same(config, "1 2+.3 4+.", NULL);
+    registers_same(config, "[1.2.]f: f;!", NULL);
+    config.limit = 0;
+}
+
+static unsigned long operations_;
+
+static void capture_operations(const struct config config, const char *name, unsigned long value)
+{
+    (void)config;
+    if (!strcmp(name, "operations")) {
+        operations_ = value;
     }
+}
 
-    test_multibyte(config);
+static void capture_promotions(const struct config config, const char *name, unsigned long value)
+{
+    (void)config;
+    if (!strncmp(name, "promoted ", 9)) {
+        output_len += (size_t)snprintf(&output[output_len], sizeof(output) - output_len, " %s=%lu", name + 9, value);
+    }
+}
 
-    config.log_stack   = nop_log_stack;
+/// Run @c program promoting at once, and after some calls and iterations, expecting
+/// identical results and errors, and operations unless stopped by an error.
+/// @note Register code counts the operators of a lambda as it is entered.
+static void tier_same(struct config config, const char *program)
+{
+    const unsigned long thresholds[] = { 2, 3, 7, 1000 };
+    char expected[sizeof(output)];
+    unsigned long operations;
+    const char *pos;
+    const char *msg;
+    int r;
 
-    test_token(config);
+    config.log_stats = capture_operations;
+
+    fatal_pos = NULL;
+    fatal_msg = NULL;
+    config.tier_threshold = 0;
+    r = testcase(config, program);
+    strcpy(expected, output);
+    operations = operations_;
+    pos = fatal_pos;
+    msg = fatal_msg;
+
+    for (size_t i = 0; i < sizeof(thresholds) / sizeof(*thresholds); ++i) {
+        fatal_pos = NULL;
+        fatal_msg = NULL;
+        config.tier_threshold = thresholds[i];
+        assert(r == testcase(config, program));
+        assert(!strcmp(expected, output));
+        assert(r || operations == operations_);
+        assert(pos == fatal_pos);
+        assert(msg == fatal_msg || !strcmp(msg, fatal_msg));
+    }
+}
+
+static void test_tier(struct config config)
+{
+    char *args[] = { "stdin" };
+    int r;
+
+    config.argc = 1;
+    config.argv = args;
+    config.registers = true;
+    config.fatal = capture_fatal;
+
+    // Tracing disables promotion.
+    config.log_trace = NULL;
+    config.log_stack = NULL;
+
+    // Register code, entered with inputs on the stack, and left with an error.
+    tier_same(config, "[$*]f: 0i: [i;5<][i;f;!. i;1+i:]#");
+    tier_same(config, "[1\\/.]f: 0 1 2 3 f;!f;!f;!f;!");
+    tier_same(config, "[\\$@+]f: 0 1 f;!f;!f;!f;!f;!..");
+
+    // Counted loops, entered part way, and left with an error or at the limit.
+    tier_same(config, "0i: [i;10<][i;. i;1+i:]#");
+    tier_same(config, "0i: 9n: [i;n;<][i;. n;1-n: i;1+i:]#");
+    tier_same(config, "0i: [i;10<][i;. i;5=[[]i:]? i;1+i:]#");
+    tier_same(config, "1i: [i;9<][1 i;6-/. i;1+i:]#");
+    tier_same(config, "0i: [i;3<][0j: [j;4<][i;j;*. j;1+j:]# i;1+i:]#");
+
+    // Loops as register code, with invariant loads and lambdas kept between iterations,
+    // unless stored by the loop, and left when a lambda is no longer proven.
+    tier_same(config, "5[$0>][$. 1-]#%");
+    tier_same(config, "3n: 0[$n;<][$. 1+]#%");
+    tier_same(config, "9n: 0[$n;<][$. 1+ n;1-n:]#%");
+    tier_same(config, "[1+]f: 0[$f;!9<][f;!$.]#%");
+    tier_same(config, "n 0[$n;5+<][$. 1+\\$@\\1\\:]#%%");
+    tier_same(config, "1[$0>][%[]]#");
+    tier_same(config, "1 2 3[$0>][%%1]#");
+
+    config.limit = 40;
+    tier_same(config, "0i: [i;100<][i;. i;1+i:]#");
+    tier_same(config, "[1+]f: 0 [1][f;!]#");
+    for (unsigned long limit = 40; limit < 44; ++limit) {
+        config.limit = limit;
+        tier_same(config, "3n: 0[$n;9+<][$. 1+]#%");
+    }
+    config.limit = 0;
+
+    config.log_stats = capture_promotions;
+
+    config.tier_threshold = 3;
+    r = testcase(config, "[1+]f: 0f;!f;!f;!f;!. 0i: [i;5<][i;1+i:]#");
+    assert(0 == r);
+    assert(!strcmp(output, "4 lambdas=1 loops=1"));
+
+    // Promoted at the first call or iteration.
+    config.tier_threshold = 0;
+    r = testcase(config, "[1+]f: 0f;!. 0i: [i;5<][i;1+i:]#");
+    assert(0 == r);
+    assert(!strcmp(output, "1 lambdas=1 loops=1"));
+
+    // A loop promoted with its condition and body.
+    r = testcase(config, "5[$0>][1-]#.");
+    assert(0 == r);
+    assert(!strcmp(output, "0 lambdas=2 loops=1"));
+
+    // Promoted with the calls it inlines, though its own assumption fails at entry.
+    r = testcase(config, "[1+]f: [f;!f;!]g: 0g;!g;!.");
+    assert(0 == r);
+    assert(!strcmp(output, "4 lambdas=2 loops=0"));
+
+    // Not promoted.
+    config.tier_threshold = 1000;
+    r = testcase(config, "[1+]f: 0f;!f;!f;!f;!. 0i: [i;5<][i;1+i:]#");
+    assert(0 == r);
+    assert(!strcmp(output, "4 lambdas=0 loops=0"));
+}
+
+static void test_cache(struct config config)
+{
+    char *args[] = { "stdin" };
+    int r;
+
+    config.argc = 1;
+    config.argv = args;
+    config.fatal = capture_fatal;
+
+    // Tracing disables the cache.
+    config.log_trace = NULL;
+    config.log_stack = NULL;
+
+    r = testcase(config, "[1.]!  1[2.]?  0[3.]?  0i: [i;2>~][i;. i;1+i:]#  3$.. 1 2\\.. 5%  a;. 7b: b;.");
+    assert(0 == r);
+    assert(!strcmp(output, "12012331207"));
+
+    r = testcase(config, "a 1=");
+    assert(1 == r);
+    assert(!strcmp(fatal_msg, "stack type mismatch"));
+
+    r = testcase(config, "1!");
+    assert(1 == r);
+    assert(!strcmp(fatal_msg, "stack type mismatch"));
+
+    r = testcase(config, "1;");
+    assert(1 == r);
+    assert(!strcmp(fatal_msg, "stack type mismatch"));
+
+    r = testcase(config, "1 1:");
+    assert(1 == r);
+    assert(!strcmp(fatal_msg, "stack type mismatch"));
+
+    config.extensions = false;
+    r = testcase(config, "1 2<");
+    assert(1 == r);
+    assert(!strcmp(fatal_msg, "unknown symbol"));
+
+    r = testcase(config, "[1+]f: 1f;!.");
+    assert(0 == r);
+    assert(!strcmp(output, "2"));
+
+    // The same without the cache.
+    config.log_stack = nop_log_stack;
+    r = testcase(config, "[1+]f: 1f;!.");
+    assert(0 == r);
+    assert(!strcmp(output, "2"));
+    config.log_stack = NULL;
+
+    config.extensions = true;
+
+    r = testcase(config, "1 2≠. 2 2≠. 1 2<. 2 2≤. 1 2≥. 5 3⊻. 7 2÷..");
+    assert(0 == r);
+    assert(!strcmp(output, "-10-1-10631"));
+
+    r = testcase(config, "a 1≠");
+    assert(1 == r);
+    assert(!strcmp(fatal_msg, "stack type mismatch"));
+
+    r = testcase(config, "1 0÷");
+    assert(1 == r);
+    assert(!strcmp(fatal_msg, "divide by zero"));
+}
+
+static void test_array(struct config config)
+{
+    char *args[] = { "stdin" };
+    int r;
+
+    config.argc = 1;
+    config.argv = args;
+    config.extensions = true;
+    config.fatal = capture_fatal;
+    config.log_trace = NULL;
+    config.log_stack = NULL;
+
+    r = testcase(config, "∞. 7 2¢ ∞. 0¡. 2¡. 1$¡\\¡+. 3¶ 2¡. 1¶ ∞. 5¶ 2¡.");
+    assert(0 == r);
+    assert(!strcmp(output, "03070710"));
+
+    // Stored values are independent of each run.
+    r = testcase(config, "∞.");
+    assert(0 == r);
+    assert(!strcmp(output, "0"));
+
+    // Proven lambdas.
+    r = testcase(config, "[¢]s: [¡]f: 5 0s;! 0f;!.");
+    assert(0 == r);
+    assert(!strcmp(output, "5"));
+
+    r = testcase(config, "0¡");
+    assert(1 == r);
+    assert(!strcmp(fatal_msg, "array index out of range"));
+
+    r = testcase(config, "[¡]f: 9f;!");
+    assert(1 == r);
+    assert(!strcmp(fatal_msg, "array index out of range"));
+
+    r = testcase(config, "2¶ 1_ 0+¡");
+    assert(1 == r);
+    assert(!strcmp(fatal_msg, "array index out of range"));
+
+    r = testcase(config, "1 1_¢");
+    assert(1 == r);
+    assert(!strcmp(fatal_msg, "array index out of range"));
+
+    r = testcase(config, "1_¶");
+    assert(1 == r);
+    assert(!strcmp(fatal_msg, "array size out of range"));
+
+    r = testcase(config, "99999999¶");
+    assert(1 == r);
+    assert(!strcmp(fatal_msg, "array size out of range"));
+}
+
+static void test_roll(struct config config)
+{
+    char *args[] = { "stdin" };
+    int r;
+
+    config.argc = 1;
+    config.argv = args;
+    config.extensions = true;
+    config.fatal = capture_fatal;
+    config.log_stack = NULL;
+
+    // Deep rolls open a gap in the stack, which picks, pops, shallow rolls,
+    // reverse, and depth must all see through.  Prints a weighted checksum.
+    r = testcase(config,
+        "0i:[200i;>][i;i;1+i:]# 0j:[300j;>][100™j;1+j:]#"
+        " 150ø.\" \" 70™180™5™150™1™ 190ø.\" \" [§150>][%]#"
+        " 120™$®100™ 0s:[§][§*s;+s:]#s;.");
+    assert(0 == r);
+    assert(!strcmp(output, "49 9 611698"));
+}
+
+static void capture_log_stack(const struct config config, const char *op, const char *dump)
+{
+    (void)config;
+    if (!strcmp(op, "rev")) {
+        output_len += (size_t)snprintf(&output[output_len], sizeof(output) - output_len, "|%s", dump);
+    }
+}
+
+static void test_reverse(struct config config)
+{
+    char *args[] = { "stdin" };
+    int r;
+
+    config.argc = 1;
+    config.argv = args;
+    config.extensions = true;
+    config.fatal = capture_fatal;
+
+    // The log shows the logical order.
+    config.log_stack = capture_log_stack;
+    r = testcase(config, "1 2 3® 4® % 1™ ®...");
+    assert(0 == r);
+    assert(!strcmp(output, "|\t 3 2 1|\t 4 1 2 3|\t 1 2 4421"));
+
+    // Operations on a reversed stack, including register code which needs the
+    // cells in order.  Prints a weighted checksum.
+    config.log_trace = NULL;
+    config.log_stack = NULL;
+    config.registers = true;
+    r = testcase(config,
+        "[\\1+\\]f: 0i:[200i;>][i;i;1+i:]# ® 0j:[300j;>][100™j;1+j:]#"
+        " 150ø.\" \" 70™180™5™150™ ® 120™ 9f;! ® 190ø.\" \" [§150>][%]#"
+        " 0s:[§][§*s;+s:]#s;.");
+    assert(0 == r);
+    assert(!strcmp(output, "150 191 1111483"));
+}
+
+/// Program text of the running test, for offsets of sampled frames.
+static const char *sample_str;
+
+/// Emit @c x after the active lambda calls, as variable (or '[') and offset of each.
+static void sample_emit_number(int x)
+{
+    struct frame frame[SAMPLE_DEPTH];
+    size_t n = sample(frame, SAMPLE_DEPTH);
+
+    for (size_t i = 0; i < n; ++i) {
+        output_len += (size_t)snprintf(&output[output_len], sizeof(output) - output_len, "%c%d "
+                , frame[i].variable ? frame[i].variable : '['
+                , (int)(frame[i].pos - sample_str));
+    }
+    capture_emit_number(x);
+}
+
+static void test_sample(struct config config)
+{
+    char *args[] = { "stdin" };
+    int r;
+
+    config.argc         = 1;
+    config.argv         = args;
+    config.extensions   = true;
+    config.emit_number  = sample_emit_number;
+
+    sample_str = "[[1.]g: g;!]f: f;! [2.]! 3.";
+    r = testcase(config, sample_str);
+    assert(0 == r);
+    assert(!strcmp(output, "f0 g1 1[19 23"));
+
+    // Counted loops.
+    config.log_trace = NULL;
+    config.log_stack = NULL;
+    sample_str = "0i:[i;2<][i;. i;1+i:]#";
+    r = testcase(config, sample_str);
+    assert(0 == r);
+    assert(!strcmp(output, "[9 0[9 1"));
+}
+
+static void test_vector(struct config config)
+{
+    static const struct {
+        const char *str;
+        const char *expected;
+    } cases[] = {
+        { "1 2 3 4 5 6 7 8 9 10 11 12 13 14 15 16 17 18 19 19∑. 0∑.", "1900" },
+        { "2147483647 1 2∑.", "-2147483648" },
+        { "5 3_ 9 12_ 4 8 1 0 7 2 6 11 12∧. 5 3_ 9 12_ 4 8 1 0 7 2 6 11 12∨.", "-1211" },
+        { "9 8 7 6 5 4 3 2 1 9∧. 1 2 3 4 5 6 7 8 9 9∨. 4 1∧.", "194" },
+        { "1 2 3 4 5 6 7 8 9 10 1 2 3 4 5 6 7 8 9 10 10·. 3 4 1·.", "38512" },
+        { "1 2 3 4 5 6 7 8 9 10 20 30 40 50 60 70 80 90 9⊕ 9∑.", "495" },
+        { "1 2 3 4 5 6 7 8 9 1 1 1 1 1 1 1 1 2 9⊗ .........", "1887654321" },
+        { "7 20… 20∑. [1]3…%%% 1 0…", "140" },
+        { "1 2 3 4 5 6 7 8 9 10® 3∑. 7∑. 1 2 3® 1∑...", "649123" },
+        { "0i:[i;100<][i;i;1+i:]# ® 70™ 1∑.1∑.1∑.1∑.1∑.1∑. 5∑. 89∑.", "7001234354835" },
+    };
+    char *args[] = { "stdin" };
+    int r;
+
+    config.argc = 1;
+    config.argv = args;
+    config.extensions = true;
+    config.fatal = capture_fatal;
+    config.log_trace = NULL;
+    config.log_stack = NULL;
+
+    // Each set of kernels, as far as the processor supports them.
+    for (int isa = isaScalar; isa <= isaAvx2; ++isa) {
+        vector_limit((enum isa)isa);
+        for (size_t i = 0; i < sizeof(cases) / sizeof(*cases); ++i) {
+            r = testcase(config, cases[i].str);
+            assert(0 == r);
+            assert(!strcmp(output, cases[i].expected));
+        }
+
+        // Type of any cell, whether handled in bulk or left over.
+        r = testcase(config, "a 1 2 3 4 5 6 7 8 9 10 11 12 13 14 15 16 17∑");
+        assert(1 == r);
+        assert(!strcmp(fatal_msg, "stack type mismatch"));
+
+        r = testcase(config, "1 2 3 4 5 6 7 8 9 10 11 12 13 14 15 16 a 17∑");
+        assert(1 == r);
+        assert(!strcmp(fatal_msg, "stack type mismatch"));
+    }
+
+    r = testcase(config, "1 a 1·");
+    assert(1 == r);
+    assert(!strcmp(fatal_msg, "stack type mismatch"));
+
+    r = testcase(config, "1_∑");
+    assert(1 == r);
+    assert(!strcmp(fatal_msg, "negative cell count"));
+
+    r = testcase(config, "1 2 3∑");
+    assert(1 == r);
+    assert(!strcmp(fatal_msg, "stack underflow"));
+
+    r = testcase(config, "0∨");
+    assert(1 == r);
+    assert(!strcmp(fatal_msg, "empty range"));
+
+    // Each cell counts against the limit.
+    config.limit = 10;
+    r = testcase(config, "1 20…");
+    assert(1 == r);
+    assert(!strcmp(fatal_msg, "operation limit exceeded"));
+    config.limit = 0;
+
+    config.log_stack = nop_log_stack;
+    r = testcase(config, "1 2 3 4 1⊕ 1 1⊗ 1 2… 5∑.");
+    assert(0 == r);
+    assert(!strcmp(output, "12"));
+}
+
+static void test_bulk_io(struct config config)
+{
+    static char block[301];
+    char *args[] = { "stdin" };
+    int r;
+
+    config.argc = 1;
+    config.argv = args;
+    config.extensions = true;
+    config.fatal = capture_fatal;
+
+    buffered_input = "hello world\nsecond";
+    r = testcase(config, "5ˆ¸ 10 100ˇ$.¸ 100ˆ$.¸ 5ˆ.");
+    assert(0 == r);
+    assert(!strcmp(output, "hello7 world\n6second0"));
+
+    // Delimiter as the last byte asked for.
+    buffered_input = "ab\ncd";
+    r = testcase(config, "10 3ˇ$.¸ 10 2ˇ$.¸ 10 2ˇ.");
+    assert(0 == r);
+    assert(!strcmp(output, "3ab\n2cd0"));
+
+    // More than is passed to the host at once.
+    memset(block, 'x', sizeof(block) - 1);
+    buffered_input = block;
+    r = testcase(config, "400ˆ$.¸");
+    assert(0 == r);
+    assert(!strncmp(output, "300xxx", 6) && strlen(output) == 303);
+
+    r = testcase(config, "'y 300… 300¸ 0¸");
+    assert(0 == r);
+    assert(strlen(output) == 300 && output[299] == 'y');
+
+    r = testcase(config, "¨\"héllo\"$.¸ ¨\"\".");
+    assert(0 == r);
+    assert(!strcmp(output, "6héllo0"));
+
+    r = testcase(config, "1_ˆ");
+    assert(1 == r);
+    assert(!strcmp(fatal_msg, "negative cell count"));
+
+    r = testcase(config, "1_¸");
+    assert(1 == r);
+    assert(!strcmp(fatal_msg, "negative cell count"));
+
+    r = testcase(config, "a 1¸");
+    assert(1 == r);
+    assert(!strcmp(fatal_msg, "stack type mismatch"));
+
+    r = testcase(config, "1¸");
+    assert(1 == r);
+    assert(!strcmp(fatal_msg, "stack underflow"));
+
+    r = testcase(config, "¨x");
+    assert(1 == r);
+    assert(!strcmp(fatal_msg, "string expected"));
+
+    r = testcase(config, "¨\"x");
+    assert(1 == r);
+    assert(!strcmp(fatal_msg, "unterminated statement"));
+
+    r = testcase(config, "¨");
+    assert(1 == r);
+    assert(!strcmp(fatal_msg, "unterminated statement"));
+
+    // Each byte counts against the limit.
+    config.limit = 5;
+    r = testcase(config, "¨\"abcdefgh\"");
+    assert(1 == r);
+    assert(!strcmp(fatal_msg, "operation limit exceeded"));
+    config.limit = 0;
+
+    // Tasks read no input.
+    buffered_input = "abc";
+    r = testcase(config, "0[5ˆ]†‡.");
+    assert(0 == r);
+    assert(!strcmp(output, "0"));
+    buffered_input = NULL;
+
+    config.log_stack = nop_log_stack;
+    buffered_input = "ab";
+    r = testcase(config, "¨\"cd\"¸ 1ˆ¸ 10 1ˇ¸");
+    assert(0 == r);
+    assert(!strcmp(output, "cdab"));
+    config.log_stack = NULL;
+
+    config.extensions = false;
+    r = testcase(config, "¨\"a\"");
+    assert(1 == r);
+    assert(!strcmp(fatal_msg, "unknown symbol"));
+}
+
+static void test_task(struct config config)
+{
+    char *args[] = { "stdin" };
+    const char *str;
+    int r;
+
+    config.argc = 1;
+    config.argv = args;
+    config.extensions = true;
+    config.fatal = capture_fatal;
+    config.log_trace = NULL;
+    config.log_stack = NULL;
+
+    // Output is written on join.
+    r = testcase(config, "1 2 3 2[+\"x\"$.]† \"a\" ‡.. 0[7'A,]†‡.");
+    assert(0 == r);
+    assert(!strcmp(output, "ax551A7"));
+
+    r = testcase(config, "0[\"p\"]† 0[\"q\"]† \\‡‡");
+    assert(0 == r);
+    assert(!strcmp(output, "pq"));
+
+    // Variables and array are copied, and written privately.
+    r = testcase(config, "5a: 2¶ 9 1¢ 0[a;1¡+ 3a: 4 1¢ ß]†‡. a;. 1¡.");
+    assert(0 == r);
+    assert(!strcmp(output, "1459"));
+
+    buffered_input = "z";
+    r = testcase(config, "0[^]†‡. ^.");
+    assert(0 == r);
+    assert(!strcmp(output, "-1122"));
+
+    // Handles are per interpreter, and reused once joined.
+    r = testcase(config, "0[0[6]†‡1+]†‡. 0[1]† 0[2]† ‡\\‡+. 0[]†.");
+    assert(0 == r);
+    assert(!strcmp(output, "731"));
+
+    // Tasks not joined are waited for, and their output discarded.
+    r = testcase(config, "0[\"u\"]†%");
+    assert(0 == r);
+    assert(!strcmp(output, ""));
+
+    str = "0[\"b\"1 0/]†‡";
+    r = testcase(config, str);
+    assert(1 == r);
+    assert(!strcmp(output, "b"));
+    assert(!strcmp(fatal_msg, "divide by zero"));
+    assert(fatal_pos == str + 8);
+
+    r = testcase(config, "1_[]†");
+    assert(1 == r);
+    assert(!strcmp(fatal_msg, "negative cell count"));
+
+    r = testcase(config, "1[]†");
+    assert(1 == r);
+    assert(!strcmp(fatal_msg, "stack underflow"));
+
+    r = testcase(config, "0‡");
+    assert(1 == r);
+    assert(!strcmp(fatal_msg, "unknown task"));
+
+    r = testcase(config, "0[]†$‡‡");
+    assert(1 == r);
+    assert(!strcmp(fatal_msg, "unknown task"));
+
+    r = testcase(config, "0[0[]†]†‡‡");
+    assert(1 == r);
+    assert(!strcmp(fatal_msg, "unknown task"));
+
+    // Tasks are lent half of the operations left.
+    config.limit = 8;
+    r = testcase(config, "0[1 2+]†‡ 0[]†‡.");
+    assert(0 == r);
+    assert(!strcmp(output, "3"));
+
+    r = testcase(config, "0[[1][]#]†‡");
+    assert(1 == r);
+    assert(!strcmp(fatal_msg, "operation limit exceeded"));
+
+    config.limit = 1;
+    r = testcase(config, "0[]†");
+    assert(1 == r);
+    assert(!strcmp(fatal_msg, "operation limit exceeded"));
+
+    config.limit = 0;
+
+    config.log_stack = nop_log_stack;
+    r = testcase(config, "1 1[]†‡.");
+    assert(0 == r);
+    assert(!strcmp(output, "1"));
+}
+
+/// Program text of the running test, for offsets of reported positions.
+static const char *progress_str;
+
+static void capture_progress(const struct config config, unsigned long operations, size_t depth, const char *pos)
+{
+    (void)config;
+    output_len += (size_t)snprintf(&output[output_len], sizeof(output) - output_len,
+        " %lu:%zu:%d", operations, depth, pos ? (int)(pos - progress_str) : -1);
+}
+
+static void test_progress(struct config config)
+{
+    char *args[] = { "stdin" };
+    int r;
+
+    config.argc = 1;
+    config.argv = args;
+    config.extensions = true;
+    config.fatal = capture_fatal;
+    config.log_trace = NULL;
+    config.log_stack = NULL;
+    config.log_progress = capture_progress;
+
+    // Reported after each interval, at the symbol counted, and at the end.
+    config.progress_interval = 3;
+    progress_str = "1 2 3 4 5++++%";
+    r = testcase(config, progress_str);
+    assert(0 == r);
+    assert(!strcmp(output, " 4:2:12 5:0:-1"));
+
+    // Operations charged at once are reported once.
+    progress_str = "1 2 3 4 5 5∑%";
+    r = testcase(config, progress_str);
+    assert(0 == r);
+    assert(!strcmp(output, " 6:5:11 7:0:-1"));
+
+    // Tasks do not report, and their operations are counted on join.
+    progress_str = "0[1 2 3 4 5++++]†‡%";
+    r = testcase(config, progress_str);
+    assert(0 == r);
+    assert(!strcmp(output, " 6:1:19 7:0:-1"));
+
+    // The limit still applies between reports.
+    config.limit = 9;
+    progress_str = "[1][]#";
+    r = testcase(config, progress_str);
+    assert(1 == r);
+    assert(!strcmp(fatal_msg, "operation limit exceeded"));
+    assert(!strcmp(output, " 4:0:5 8:0:5 10:0:5"));
+}
+
+/// Input of a stepped run, of which only the first @c step_ready bytes have arrived.
+static const char *step_str;
+static size_t step_ready;
+
+static int step_input(void)
+{
+    if (!*step_str) {
+        return -1;
+    }
+    if (!step_ready) {
+        return INPUT_WOULD_BLOCK;
+    }
+    step_ready--;
+    return *step_str++;
+}
+
+static size_t step_input_string(char *buf, size_t len, int delim)
+{
+    size_t n = 0;
+
+    (void)delim;
+    if (step_ready < len && step_ready < strlen(step_str)) {
+        return (size_t)INPUT_WOULD_BLOCK;
+    }
+    while (n < len && *step_str) {
+        buf[n++] = *step_str++;
+        step_ready--;
+    }
+    return n;
+}
+
+/// Step @c str to the end, with @c budget operations per step.
+/// @return size_t Steps taken.
+static size_t step_all(struct config config, const char *str, unsigned long budget, enum step *step)
+{
+    struct program *program;
+    struct vm *vm;
+    size_t steps = 0;
+
+    output_len = 0;
+    output[output_len] = 0;
+
+    config.str = str;
+    program = compile(config);
+    vm = vm_start(config, program);
+
+    do {
+        *step = vm_step(vm, budget);
+        steps++;
+    } while (*step == stepRunning);
+
+    vm_free(vm);
+    release(program);
+
+    return steps;
+}
+
+static void *step_elsewhere(void *vm)
+{
+    vm_step((struct vm *)vm, 1);
+    return NULL;
+}
+
+static void test_step(struct config config)
+{
+    char *args[] = { "stdin" };
+    struct program *program;
+    struct vm *vm[2];
+    enum step step;
+    size_t steps;
+    pid_t pid;
+    int status;
+    int r;
+
+    config.argc = 1;
+    config.argv = args;
+    config.extensions = true;
+    config.fatal = capture_fatal;
+    config.log_trace = NULL;
+    config.log_stack = NULL;
+    config.input = step_input;
+    config.input_string = step_input_string;
+
+    // Each step runs the operations it is given.
+    steps = step_all(config, "1 2 3 4 5++++.", 1, &step);
+    assert(stepDone == step);
+    assert(5 == steps);
+    assert(!strcmp(output, "15"));
+
+    steps = step_all(config, "1 2 3 4 5++++.", 2, &step);
+    assert(stepDone == step);
+    assert(3 == steps);
+    assert(!strcmp(output, "15"));
+
+    steps = step_all(config, "1 2 3 4 5++++.", ULONG_MAX, &step);
+    assert(stepDone == step);
+    assert(1 == steps);
+
+    // Errors end the run, and are reported once.
+    fatal_msg = NULL;
+    steps = step_all(config, "1 2 3++0/", 2, &step);
+    assert(stepError == step);
+    assert(2 == steps);
+    assert(!strcmp(fatal_msg, "divide by zero"));
+
+    // Input that would block suspends the run until it arrives.
+    config.str = "^^+.";
+    program = compile(config);
+    vm[0] = vm_start(config, program);
+    output_len = 0;
+    step_str = "12";
+    step_ready = 0;
+    assert(stepWaitingInput == vm_step(vm[0], 100));
+    assert(stepWaitingInput == vm_step(vm[0], 100));
+    step_ready = 1;
+    assert(stepWaitingInput == vm_step(vm[0], 100));
+    step_ready = 1;
+    assert(stepDone == vm_step(vm[0], 100));
+    assert(!strcmp(output, "99"));
+    assert(stepDone == vm_step(vm[0], 100));
+    vm_free(vm[0]);
+    release(program);
+
+    // Bulk input waits for all it asks for, or the end of input.
+    step_str = "abc";
+    step_ready = 2;
+    steps = step_all(config, "5ˆ.", 100, &step);
+    assert(stepWaitingInput == step);
+    step_ready = 3;
+    steps = step_all(config, "5ˆ\\%\\%\\%.", 100, &step);
+    assert(stepDone == step);
+    assert(!strcmp(output, "3"));
+
+    // Runs interleaved on one thread keep their own stacks, variables and arrays.
+    config.str = "0a:[a;100>~][a;1+a: a;0¢]#a;.0¡.";
+    program = compile(config);
+    vm[0] = vm_start(config, program);
+    vm[1] = vm_start(config, program);
+    output_len = 0;
+    output[output_len] = 0;
+    assert(stepRunning == vm_step(vm[0], 50));
+    assert(stepRunning == vm_step(vm[1], 60));
+    while (vm_step(vm[0], 70) == stepRunning) {
+        assert(stepRunning == vm_step(vm[1], 10));
+    }
+    assert(!strcmp(output, "101101"));
+    assert(stepDone == vm_step(vm[1], ULONG_MAX));
+    assert(!strcmp(output, "101101101101"));
+    vm_free(vm[1]);
+    vm_free(vm[0]);
+
+    // A run may be abandoned between steps, including within register code and tasks.
+    config.registers = true;
+    config.tier_threshold = 0;
+    vm[0] = vm_start(config, program);
+    vm[1] = vm_start(config, program);
+    assert(stepRunning == vm_step(vm[0], 20));
+    vm_free(vm[0]);
+    vm_free(vm[1]);
+    release(program);
+
+    config.str = "[^]f: 0[1 2+]† f;! ‡";
+    program = compile(config);
+    vm[0] = vm_start(config, program);
+    step_str = "1";
+    step_ready = 0;
+    assert(stepWaitingInput == vm_step(vm[0], 100));
+    vm_free(vm[0]);
+    release(program);
+
+    // A run is stepped only by the thread that started it.
+    config.str = "1 2+.";
+    program = compile(config);
+    vm[0] = vm_start(config, program);
+    assert(stepRunning == vm_step(vm[0], 1));
+    fflush(stdout);
+    pid = fork();
+    if (pid == 0) {
+        pthread_t thread;
+        freopen("/dev/null", "w", stderr);
+        pthread_create(&thread, NULL, step_elsewhere, vm[0]);
+        pthread_join(thread, NULL);
+        _exit(EXIT_SUCCESS);
+    }
+    assert(pid == waitpid(pid, &status, 0));
+    assert(WIFSIGNALED(status) && SIGABRT == WTERMSIG(status));
+    vm_free(vm[0]);
+    release(program);
+
+    // Without stepping, input that would block is an error.
+    fatal_msg = NULL;
+    step_str = "1";
+    step_ready = 0;
+    r = testcase(config, "^.");
+    assert(1 == r);
+    assert(!strcmp(fatal_msg, "input would block"));
+}
+
+/// Run @c piece, up to a NULL one, as the pieces of one program.
+/// @return int Result of the piece that failed, or of the last.
+static int pieces(struct config config, const char **piece)
+{
+    struct state *state = NULL;
+    int r = 0;
+
+    output_len = 0;
+    output[output_len] = 0;
+
+    for (size_t i = 0; piece[i] && !r; ++i) {
+        struct program *program;
+
+        config.str = piece[i];
+        program = compile_piece(config);
+        r = run_piece(config, program, &state, !piece[i + 1]);
+    }
+
+    assert(!state);
+    return r;
+}
+
+static void test_piece(struct config config)
+{
+    char *args[] = { "stdin", "7" };
+    const char *program[4];
+    struct program *compiled;
+    struct state *state = NULL;
+    int r;
+
+    config.argc = 2;
+    config.argv = args;
+    config.extensions = true;
+    config.fatal = capture_fatal;
+    config.log_trace = NULL;
+    config.log_stack = NULL;
+
+    // The stack, variables and array carry over, and arguments are given to the first.
+    program[0] = "[1+]f: b; 3 0¢\n";
+    program[1] = "f;! 0¡+ .\n";
+    program[2] = "";
+    program[3] = NULL;
+    r = pieces(config, program);
+    assert(0 == r);
+    assert(!strcmp(output, "11"));
+
+    // Only the last is checked to leave the stack empty.
+    program[2] = "1\n";
+    r = pieces(config, program);
+    assert(1 == r);
+    assert(!strcmp(fatal_msg, "stack not empty"));
+
+    // Variables are not assumed to start as numbers.
+    program[0] = "[1]x:\n";
+    program[1] = "x;1+.\n";
+    program[2] = NULL;
+    r = pieces(config, program);
+    assert(1 == r);
+    assert(!strcmp(fatal_msg, "stack type mismatch"));
+
+    // Lambdas of earlier pieces are run without their analysis.
+    program[0] = "[¨\"ab\"%+.]g:\n";
+    program[1] = "g;!\n";
+    r = pieces(config, program);
+    assert(0 == r);
+    assert(!strcmp(output, "195"));
+
+    program[0] = "[\"hi\"]f:\n";
+    program[1] = "f;! f;!\n";
+    r = pieces(config, program);
+    assert(0 == r);
+    assert(!strcmp(output, "hihi"));
+
+    // Errors end the run.
+    program[0] = "1 0/\n";
+    program[1] = "1.\n";
+    r = pieces(config, program);
+    assert(1 == r);
+    assert(!strcmp(output, ""));
+
+    // Tasks run on, to be joined by later pieces, where their errors are reported.
+    program[0] = "[1 2+]f: f;1[! 'x,]† t:\n";
+    program[1] = "t;‡ .\n";
+    program[2] = "\n";
+    program[3] = NULL;
+    r = pieces(config, program);
+    assert(0 == r);
+    assert(!strcmp(output, "x3"));
+
+    program[0] = "0[1 0/]† t:\n";
+    program[1] = "t;‡\n";
+    program[2] = NULL;
+    r = pieces(config, program);
+    assert(1 == r);
+    assert(!strcmp(fatal_msg, "divide by zero"));
+    assert(fatal_pos == strchr(program[0], '/'));
+
+    // Operations are counted, and statistics reported, across the pieces.
+    config.log_stats = capture_operations;
+    config.log_progress = capture_progress;
+    config.progress_interval = 2;
+    progress_str = "";
+    program[0] = "1 2+\n";
+    program[1] = "3+\n";
+    program[2] = "%\n";
+    program[3] = NULL;
+    operations_ = 0;
+    r = pieces(config, program);
+    assert(0 == r);
+    assert(3 == operations_);
+    config.log_stats = NULL;
+    config.log_progress = NULL;
+
+    // A piece is referred to while a lambda of it is held.
+    config.str = "[]f: [] 0f:\n";
+    compiled = compile_piece(config);
+    r = run_piece(config, compiled, &state, false);
+    assert(0 == r);
+    assert(state_refers(state, config.str));
+    assert(!state_refers(state, "[]"));
+
+    config.str = "%\n";
+    compiled = compile_piece(config);
+    r = run_piece(config, compiled, &state, false);
+    assert(0 == r);
+    assert(!state_refers(state, program[0]));
+
+    // The rest of a program may be abandoned.
+    state_free(state);
+
+    // A piece is referred to while a task it started runs, and then waited for.
+    state = NULL;
+    config.str = "0[1]† t:\n";
+    compiled = compile_piece(config);
+    r = run_piece(config, compiled, &state, false);
+    assert(0 == r);
+    assert(state_refers(state, config.str));
+    state_free(state);
+}
+
+static void test_split(void)
+{
+    const char *str = "1 2+{\n}\"\n\" '\n [\n']] ø\n";
+    struct splitter splitter;
+    size_t n = 0;
+
+    // Split after the newlines outside any symbol, however the bytes arrive.
+    split_init(&splitter);
+    while (n < strlen(str)) {
+        n += split_next(&splitter, &str[n], strlen(str) - n);
+    }
+    assert(strlen(str) == splitter.offset);
+    assert(strlen(str) == splitter.cut);
+
+    split_init(&splitter);
+    n = 0;
+    for (size_t end = 1; end <= strlen(str); ++end) {
+        n += split_next(&splitter, &str[n], end - n);
+        if (end < strlen(str) - 1) {
+            assert(0 == splitter.cut);
+        }
+    }
+    assert(strlen(str) == splitter.cut);
+
+    // An unbalanced bracket closes nothing, and a malformed byte is stepped over.
+    split_init(&splitter);
+    split_next(&splitter, "]\n\xff\n", 4);
+    assert(4 == splitter.cut);
+}
+
+static void test_compile(struct config config)
+{
+    char *args[] = { "stdin" };
+    struct program *program;
+    int r;
+
+    config.argc = 1;
+    config.argv = args;
+    config.str = "[^$1_=~][,]#%";
+
+    program = compile(config);
+
+    // Each run starts afresh.
+    for (int i = 0; i < 2; ++i) {
+        output_len = 0;
+        buffered_input = i ? "two" : "one";
+        r = run(config, program);
+        assert(0 == r);
+        assert(!strcmp(output, i ? "two" : "one"));
+    }
+
+    release(program);
+}
+
+static void test_arguments(struct config config)
+{
+    char *args[] = { "stdin", "42", "string" };
+    int r;
+
+    config.argc = 0;
+    config.argv = NULL;
+    r = testcase(config, "");
+    assert(1 == r);
+
+    config.argc = 27;
+    config.argv = args;
+    r = testcase(config, "");
+    assert(1 == r);
+
+    config.argc = 1;
+    config.argv = args;
+    r = testcase(config, "");
+    assert(0 == r);
+
+    config.argc = 2;
+    config.argv = args;
+    r = testcase(config, "a;.':,b;.':,c;.");
+    assert(0 == r);
+    assert(!strcmp(output, "1:42:0"));
+
+    config.argc = 3;
+    config.argv = args;
+    r = testcase(config, "");
+    assert(1 == r);
+}
+
+int main(void)
+{
+    struct config config;
+
+    config.extensions        = true;
+    config.memo              = 0;
+    config.registers         = false;
+    config.tier_threshold    = 0;
+    config.limit             = 0;
+    config.fatal             = nop_fatal;
+    config.log_trace         = nop_log_trace;
+    config.log_verify        = NULL;
+    config.log_stats         = NULL;
+    config.progress_interval = 0;
+    config.log_progress      = NULL;
+    config.log_stack         = NULL;
+    config.emit_number       = capture_emit_number;
+    config.emit_string       = capture_emit_string;
+    config.emit_char         = capture_emit_char;
+    config.input             = input;
+    config.input_string      = input_string;
+    config.flush             = nop_flush;
+
+    // Test data includes UTF-8 encoded multibyte characters.
+    setlocale(LC_ALL, "en_US.UTF-8");
+
+    {
+        struct token token;
+        storage_set(',', token_make_number(42));
+        token = storage_get(',');
+        assert(token.tok == tokNumber);
+        assert(token.u.number == 0);
+    }
+
+    test_multibyte(config);
+
+    config.log_stack   = nop_log_stack;
+
+    test_token(config);
+
+    test_format();
+
+    test_verify(config);
+
+    test_counted(config);
+
+    test_compile(config);
+
+    test_memo(config);
+
+    test_registers(config);
+
+    test_tier(config);
+
+    test_cache(config);
+
+    test_array(config);
+    test_roll(config);
+    test_reverse(config);
+    test_sample(config);
+    test_vector(config);
+    test_bulk_io(config);
+    test_task(config);
+    test_progress(config);
+    test_step(config);
+    test_piece(config);
+    test_split();
 
     test_arguments(config);
 
@@ -0,0 +1,68 @@
+#include "tier.h"
+
+#include "program.h"
+
+#include <stdlib.h>
+
+void tier_init(struct tier *tier, unsigned long threshold, const struct program *program)
+{
+    size_t lambdas = program->count + 1;
+
+    tier->count = lambdas;
+    tier->threshold = threshold ? threshold : 1;
+    tier->calls = (unsigned long *)calloc(lambdas, sizeof(unsigned long));
+    tier->edges = (unsigned long *)calloc(lambdas, sizeof(unsigned long));
+    tier->ir = (struct ir *)calloc(lambdas, sizeof(struct ir));
+    tier->lambdas = 0;
+    tier->loops = 0;
+}
+
+void tier_free(struct tier *tier)
+{
+    for (size_t i = 0; i < tier->count; ++i) {
+        ir_free(&tier->ir[i]);
+    }
+
+    free(tier->calls);
+    free(tier->edges);
+    free(tier->ir);
+    tier->calls = NULL;
+    tier->edges = NULL;
+    tier->ir = NULL;
+    tier->count = 0;
+}
+
+void tier_call(struct tier *tier, const struct program *program, size_t index)
+{
+    if (tier->calls[index] + 1 < tier->threshold) {
+        tier->calls[index]++;
+        return;
+    }
+
+    tier_promote(tier, program, index);
+}
+
+void tier_promote(struct tier *tier, const struct program *program, size_t index)
+{
+    const struct lambda *lambda;
+
+    if (tier->calls[index] == tier->threshold) {
+        return;
+    }
+
+    tier->calls[index] = tier->threshold;
+
+    lambda = index < program->count ? &program->lambda[index] : &program->top;
+    ir_compile(program, lambda->slice, &lambda->effect, &tier->ir[index]);
+    if (tier->ir[index].valid) {
+        tier->lambdas++;
+    }
+}
+
+bool tier_edge(struct tier *tier, size_t index)
+{
+    if (tier->edges[index] == tier->threshold) {
+        return false;
+    }
+    return ++tier->edges[index] == tier->threshold;
+}
@@ -0,0 +1,56 @@
+#pragma once
+
+#include "ir.h"
+
+#include <stdbool.h>
+#include <stddef.h>
+
+/*
+ Lambdas are interpreted until hot, and only then run in an optimized form, so
+ that code run once is not translated.  Each interpreter keeps its own counts
+ and register code, as threads share the program.
+ */
+
+/// Counts of a running program, indexed by lambda, the program itself last.
+struct tier {
+    /// Calls, or loop iterations, at which a lambda or loop is promoted.
+    /// @note A loop promotes its condition and body with it.
+    unsigned long threshold;
+
+    /// Lambdas of the program, and the program itself.
+    size_t count;
+
+    /// Calls of each lambda, until promoted.
+    unsigned long *calls;
+
+    /// Back edges of loops with each lambda as body, until promoted.
+    unsigned long *edges;
+
+    /// Register code of each lambda, translated once promoted.
+    struct ir *ir;
+
+    /// Lambdas promoted to register code.
+    unsigned long lambdas;
+
+    /// Runs of loops continued in counted form, or as register code.
+    unsigned long loops;
+};
+
+struct program;
+
+/// Initialise counts for the lambdas of @c program, promoting at @c threshold.
+/// @note A threshold of zero promotes at the first call, as does one.
+void tier_init(struct tier *tier, unsigned long threshold, const struct program *program);
+
+/// Release counts and register code.
+void tier_free(struct tier *tier);
+
+/// Count a call of lambda @c index of @c program, translating it to register code once hot.
+void tier_call(struct tier *tier, const struct program *program, size_t index);
+
+/// Translate lambda @c index of @c program to register code, unless already promoted.
+void tier_promote(struct tier *tier, const struct program *program, size_t index);
+
+/// Count a back edge of the loop with lambda @c index as body.
+/// @return bool True on the back edge at which the loop is promoted.
+bool tier_edge(struct tier *tier, size_t index);
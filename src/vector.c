@@ -0,0 +1,423 @@
+#include "vector.h"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define VECTOR_X86
+#include <immintrin.h>
+#endif
+
+/// Distance between the same field of adjacent cells, in @c int.
+#define STRIDE ((int)(sizeof(struct token) / sizeof(int)))
+
+_Static_assert(sizeof(struct token) % sizeof(int) == 0 && sizeof(enum tok) == sizeof(int),
+    "cells are gathered as arrays of int");
+
+static enum isa limit_ = isaAvx2;
+
+/*
+ Scalar kernels, used where no others are supported, and for the cells left over
+ by the others.  Arithmetic is unsigned, so that it wraps.
+ */
+
+static bool numbers_scalar(const struct token *token, size_t n)
+{
+    unsigned tags = 0;
+    for (size_t i = 0; i < n; ++i) {
+        tags |= (unsigned)token[i].tok;
+    }
+    return tags == tokNumber;
+}
+
+static int sum_scalar(const struct token *token, size_t n)
+{
+    unsigned sum = 0;
+    for (size_t i = 0; i < n; ++i) {
+        sum += (unsigned)token[i].u.number;
+    }
+    return (int)sum;
+}
+
+static int min_scalar(const struct token *token, size_t n)
+{
+    int min = token[0].u.number;
+    for (size_t i = 1; i < n; ++i) {
+        if (token[i].u.number < min) {
+            min = token[i].u.number;
+        }
+    }
+    return min;
+}
+
+static int max_scalar(const struct token *token, size_t n)
+{
+    int max = token[0].u.number;
+    for (size_t i = 1; i < n; ++i) {
+        if (token[i].u.number > max) {
+            max = token[i].u.number;
+        }
+    }
+    return max;
+}
+
+static int dot_scalar(const struct token *x, const struct token *y, size_t n)
+{
+    unsigned dot = 0;
+    for (size_t i = 0; i < n; ++i) {
+        dot += (unsigned)x[i].u.number * (unsigned)y[i].u.number;
+    }
+    return (int)dot;
+}
+
+static void add_scalar(struct token *x, const struct token *y, size_t n)
+{
+    for (size_t i = 0; i < n; ++i) {
+        x[i].u.number = (int)((unsigned)x[i].u.number + (unsigned)y[i].u.number);
+    }
+}
+
+static void mul_scalar(struct token *x, const struct token *y, size_t n)
+{
+    for (size_t i = 0; i < n; ++i) {
+        x[i].u.number = (int)((unsigned)x[i].u.number * (unsigned)y[i].u.number);
+    }
+}
+
+#ifdef VECTOR_X86
+
+/*
+ SSE4.1 kernels, loading four cells at a time.
+ */
+
+#define SSE41 __attribute__((target("sse4.1")))
+
+SSE41 static __m128i load_sse41(const struct token *token)
+{
+    return _mm_setr_epi32(token[0].u.number, token[1].u.number, token[2].u.number, token[3].u.number);
+}
+
+SSE41 static bool numbers_sse41(const struct token *token, size_t n)
+{
+    __m128i tags = _mm_setzero_si128();
+    size_t i = 0;
+
+    for (; i + 4 <= n; i += 4) {
+        tags = _mm_or_si128(tags, _mm_setr_epi32(token[i].tok, token[i + 1].tok, token[i + 2].tok, token[i + 3].tok));
+    }
+
+    return _mm_testz_si128(tags, tags) && numbers_scalar(&token[i], n - i);
+}
+
+SSE41 static int sum_sse41(const struct token *token, size_t n)
+{
+    __m128i sum = _mm_setzero_si128();
+    size_t i = 0;
+
+    for (; i + 4 <= n; i += 4) {
+        sum = _mm_add_epi32(sum, load_sse41(&token[i]));
+    }
+    sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, _MM_SHUFFLE(1, 0, 3, 2)));
+    sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, _MM_SHUFFLE(2, 3, 0, 1)));
+
+    return (int)((unsigned)_mm_cvtsi128_si32(sum) + (unsigned)sum_scalar(&token[i], n - i));
+}
+
+SSE41 static int min_sse41(const struct token *token, size_t n)
+{
+    __m128i min = _mm_set1_epi32(token[0].u.number);
+    size_t i = 0;
+
+    for (; i + 4 <= n; i += 4) {
+        min = _mm_min_epi32(min, load_sse41(&token[i]));
+    }
+    min = _mm_min_epi32(min, _mm_shuffle_epi32(min, _MM_SHUFFLE(1, 0, 3, 2)));
+    min = _mm_min_epi32(min, _mm_shuffle_epi32(min, _MM_SHUFFLE(2, 3, 0, 1)));
+
+    if (i < n) {
+        int rest = min_scalar(&token[i], n - i);
+        return rest < _mm_cvtsi128_si32(min) ? rest : _mm_cvtsi128_si32(min);
+    }
+    return _mm_cvtsi128_si32(min);
+}
+
+SSE41 static int max_sse41(const struct token *token, size_t n)
+{
+    __m128i max = _mm_set1_epi32(token[0].u.number);
+    size_t i = 0;
+
+    for (; i + 4 <= n; i += 4) {
+        max = _mm_max_epi32(max, load_sse41(&token[i]));
+    }
+    max = _mm_max_epi32(max, _mm_shuffle_epi32(max, _MM_SHUFFLE(1, 0, 3, 2)));
+    max = _mm_max_epi32(max, _mm_shuffle_epi32(max, _MM_SHUFFLE(2, 3, 0, 1)));
+
+    if (i < n) {
+        int rest = max_scalar(&token[i], n - i);
+        return rest > _mm_cvtsi128_si32(max) ? rest : _mm_cvtsi128_si32(max);
+    }
+    return _mm_cvtsi128_si32(max);
+}
+
+SSE41 static int dot_sse41(const struct token *x, const struct token *y, size_t n)
+{
+    __m128i dot = _mm_setzero_si128();
+    size_t i = 0;
+
+    for (; i + 4 <= n; i += 4) {
+        dot = _mm_add_epi32(dot, _mm_mullo_epi32(load_sse41(&x[i]), load_sse41(&y[i])));
+    }
+    dot = _mm_add_epi32(dot, _mm_shuffle_epi32(dot, _MM_SHUFFLE(1, 0, 3, 2)));
+    dot = _mm_add_epi32(dot, _mm_shuffle_epi32(dot, _MM_SHUFFLE(2, 3, 0, 1)));
+
+    return (int)((unsigned)_mm_cvtsi128_si32(dot) + (unsigned)dot_scalar(&x[i], &y[i], n - i));
+}
+
+/// Write the four numbers of @c v to the cells at @c token.
+SSE41 static void store_sse41(struct token *token, __m128i v)
+{
+    int lane[4];
+    _mm_storeu_si128((__m128i *)lane, v);
+    for (int j = 0; j < 4; ++j) {
+        token[j].u.number = lane[j];
+    }
+}
+
+SSE41 static void add_sse41(struct token *x, const struct token *y, size_t n)
+{
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        store_sse41(&x[i], _mm_add_epi32(load_sse41(&x[i]), load_sse41(&y[i])));
+    }
+    add_scalar(&x[i], &y[i], n - i);
+}
+
+SSE41 static void mul_sse41(struct token *x, const struct token *y, size_t n)
+{
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        store_sse41(&x[i], _mm_mullo_epi32(load_sse41(&x[i]), load_sse41(&y[i])));
+    }
+    mul_scalar(&x[i], &y[i], n - i);
+}
+
+/*
+ AVX2 kernels, gathering eight cells at a time.
+ */
+
+#define AVX2 __attribute__((target("avx2")))
+
+/// Offsets of a field in eight adjacent cells, in @c int.
+AVX2 static __m256i lanes_avx2(void)
+{
+    return _mm256_setr_epi32(0, STRIDE, 2 * STRIDE, 3 * STRIDE, 4 * STRIDE, 5 * STRIDE, 6 * STRIDE, 7 * STRIDE);
+}
+
+AVX2 static __m256i load_avx2(const struct token *token, __m256i lanes)
+{
+    return _mm256_i32gather_epi32(&token->u.number, lanes, sizeof(int));
+}
+
+AVX2 static bool numbers_avx2(const struct token *token, size_t n)
+{
+    const __m256i lanes = lanes_avx2();
+    __m256i tags = _mm256_setzero_si256();
+    size_t i = 0;
+
+    for (; i + 8 <= n; i += 8) {
+        tags = _mm256_or_si256(tags, _mm256_i32gather_epi32((const int *)&token[i].tok, lanes, sizeof(int)));
+    }
+
+    return _mm256_testz_si256(tags, tags) && numbers_scalar(&token[i], n - i);
+}
+
+SSE41 static __m128i add_epi32(__m128i x, __m128i y)
+{
+    return _mm_add_epi32(x, y);
+}
+
+SSE41 static __m128i min_epi32(__m128i x, __m128i y)
+{
+    return _mm_min_epi32(x, y);
+}
+
+SSE41 static __m128i max_epi32(__m128i x, __m128i y)
+{
+    return _mm_max_epi32(x, y);
+}
+
+/// @return __m128i Lanes of @c v combined by @c op, the lowest lane holding the result.
+AVX2 static __m128i fold_avx2(__m256i v, __m128i (*op)(__m128i, __m128i))
+{
+    __m128i r = op(_mm256_castsi256_si128(v), _mm256_extracti128_si256(v, 1));
+    r = op(r, _mm_shuffle_epi32(r, _MM_SHUFFLE(1, 0, 3, 2)));
+    return op(r, _mm_shuffle_epi32(r, _MM_SHUFFLE(2, 3, 0, 1)));
+}
+
+AVX2 static int sum_avx2(const struct token *token, size_t n)
+{
+    const __m256i lanes = lanes_avx2();
+    __m256i sum = _mm256_setzero_si256();
+    size_t i = 0;
+
+    for (; i + 8 <= n; i += 8) {
+        sum = _mm256_add_epi32(sum, load_avx2(&token[i], lanes));
+    }
+
+    return (int)((unsigned)_mm_cvtsi128_si32(fold_avx2(sum, add_epi32)) + (unsigned)sum_scalar(&token[i], n - i));
+}
+
+AVX2 static int min_avx2(const struct token *token, size_t n)
+{
+    const __m256i lanes = lanes_avx2();
+    __m256i min = _mm256_set1_epi32(token[0].u.number);
+    size_t i = 0;
+    int m;
+
+    for (; i + 8 <= n; i += 8) {
+        min = _mm256_min_epi32(min, load_avx2(&token[i], lanes));
+    }
+    m = _mm_cvtsi128_si32(fold_avx2(min, min_epi32));
+
+    if (i < n) {
+        int rest = min_scalar(&token[i], n - i);
+        return rest < m ? rest : m;
+    }
+    return m;
+}
+
+AVX2 static int max_avx2(const struct token *token, size_t n)
+{
+    const __m256i lanes = lanes_avx2();
+    __m256i max = _mm256_set1_epi32(token[0].u.number);
+    size_t i = 0;
+    int m;
+
+    for (; i + 8 <= n; i += 8) {
+        max = _mm256_max_epi32(max, load_avx2(&token[i], lanes));
+    }
+    m = _mm_cvtsi128_si32(fold_avx2(max, max_epi32));
+
+    if (i < n) {
+        int rest = max_scalar(&token[i], n - i);
+        return rest > m ? rest : m;
+    }
+    return m;
+}
+
+AVX2 static int dot_avx2(const struct token *x, const struct token *y, size_t n)
+{
+    const __m256i lanes = lanes_avx2();
+    __m256i dot = _mm256_setzero_si256();
+    size_t i = 0;
+
+    for (; i + 8 <= n; i += 8) {
+        dot = _mm256_add_epi32(dot, _mm256_mullo_epi32(load_avx2(&x[i], lanes), load_avx2(&y[i], lanes)));
+    }
+
+    return (int)((unsigned)_mm_cvtsi128_si32(fold_avx2(dot, add_epi32)) + (unsigned)dot_scalar(&x[i], &y[i], n - i));
+}
+
+/// Write the eight numbers of @c v to the cells at @c token, as AVX2 has no scatter.
+AVX2 static void store_avx2(struct token *token, __m256i v)
+{
+    int lane[8];
+    _mm256_storeu_si256((__m256i *)lane, v);
+    for (int j = 0; j < 8; ++j) {
+        token[j].u.number = lane[j];
+    }
+}
+
+AVX2 static void add_avx2(struct token *x, const struct token *y, size_t n)
+{
+    const __m256i lanes = lanes_avx2();
+    size_t i = 0;
+
+    for (; i + 8 <= n; i += 8) {
+        store_avx2(&x[i], _mm256_add_epi32(load_avx2(&x[i], lanes), load_avx2(&y[i], lanes)));
+    }
+    add_scalar(&x[i], &y[i], n - i);
+}
+
+AVX2 static void mul_avx2(struct token *x, const struct token *y, size_t n)
+{
+    const __m256i lanes = lanes_avx2();
+    size_t i = 0;
+
+    for (; i + 8 <= n; i += 8) {
+        store_avx2(&x[i], _mm256_mullo_epi32(load_avx2(&x[i], lanes), load_avx2(&y[i], lanes)));
+    }
+    mul_scalar(&x[i], &y[i], n - i);
+}
+
+#endif
+
+/// Kernels of one instruction set.
+struct kernel {
+    bool (*numbers)(const struct token *token, size_t n);
+    int (*sum)(const struct token *token, size_t n);
+    int (*min)(const struct token *token, size_t n);
+    int (*max)(const struct token *token, size_t n);
+    int (*dot)(const struct token *x, const struct token *y, size_t n);
+    void (*add)(struct token *x, const struct token *y, size_t n);
+    void (*mul)(struct token *x, const struct token *y, size_t n);
+};
+
+/// Indexed by @c isa.
+static const struct kernel kernel_[] = {
+    { numbers_scalar, sum_scalar, min_scalar, max_scalar, dot_scalar, add_scalar, mul_scalar },
+#ifdef VECTOR_X86
+    { numbers_sse41, sum_sse41, min_sse41, max_sse41, dot_sse41, add_sse41, mul_sse41 },
+    { numbers_avx2, sum_avx2, min_avx2, max_avx2, dot_avx2, add_avx2, mul_avx2 },
+#endif
+};
+
+void vector_limit(enum isa isa)
+{
+    limit_ = isa;
+}
+
+enum isa vector_isa(void)
+{
+#ifdef VECTOR_X86
+    if (limit_ >= isaAvx2 && __builtin_cpu_supports("avx2")) {
+        return isaAvx2;
+    }
+    if (limit_ >= isaSse41 && __builtin_cpu_supports("sse4.1")) {
+        return isaSse41;
+    }
+#endif
+    return isaScalar;
+}
+
+bool vector_numbers(const struct token *token, size_t n)
+{
+    return kernel_[vector_isa()].numbers(token, n);
+}
+
+int vector_sum(const struct token *token, size_t n)
+{
+    return kernel_[vector_isa()].sum(token, n);
+}
+
+int vector_min(const struct token *token, size_t n)
+{
+    return kernel_[vector_isa()].min(token, n);
+}
+
+int vector_max(const struct token *token, size_t n)
+{
+    return kernel_[vector_isa()].max(token, n);
+}
+
+int vector_dot(const struct token *x, const struct token *y, size_t n)
+{
+    return kernel_[vector_isa()].dot(x, y, n);
+}
+
+void vector_add(struct token *x, const struct token *y, size_t n)
+{
+    kernel_[vector_isa()].add(x, y, n);
+}
+
+void vector_mul(struct token *x, const struct token *y, size_t n)
+{
+    kernel_[vector_isa()].mul(x, y, n);
+}
@@ -0,0 +1,47 @@
+#pragma once
+
+#include "token.h"
+
+#include <stdbool.h>
+#include <stddef.h>
+
+/*
+ Kernels of the bulk operators, over ranges of stack cells.  Each has a scalar
+ version, and SSE4.1 and AVX2 versions chosen at run time when the processor
+ supports them.  Arithmetic wraps, as for single cells.
+ */
+
+/// Instruction sets of the kernels, least preferred first.
+enum isa {
+    isaScalar,
+    isaSse41,
+    isaAvx2
+};
+
+/// Use no kernels beyond @c isa, so that each version may be tested.
+/// @note Affects all threads, so must be called before programs are run.
+void vector_limit(enum isa isa);
+
+/// @return isa Instruction set of the kernels in use.
+enum isa vector_isa(void);
+
+/// @return bool True if the @c n cells at @c token are all numbers.
+bool vector_numbers(const struct token *token, size_t n);
+
+/// @return int Sum of the @c n numbers at @c token.
+int vector_sum(const struct token *token, size_t n);
+
+/// @return int Least of the @c n numbers at @c token, where @c n is at least one.
+int vector_min(const struct token *token, size_t n);
+
+/// @return int Greatest of the @c n numbers at @c token, where @c n is at least one.
+int vector_max(const struct token *token, size_t n);
+
+/// @return int Dot product of the @c n numbers at @c x and at @c y.
+int vector_dot(const struct token *x, const struct token *y, size_t n);
+
+/// Add each of the @c n numbers at @c y to that at @c x.
+void vector_add(struct token *x, const struct token *y, size_t n);
+
+/// Multiply each of the @c n numbers at @c x by that at @c y.
+void vector_mul(struct token *x, const struct token *y, size_t n);
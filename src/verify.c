@@ -0,0 +1,607 @@
+#include "verify.h"
+
+#include "code-point.h"
+#include "program.h"
+#include "scan.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <wctype.h>
+
+/// Abstract stack.
+struct frame {
+    struct cell cell[VERIFY_DEPTH];
+    size_t depth;
+};
+
+/// Analysis state of one lambda.
+struct context {
+    const struct program *program;
+
+    /// Set while evaluating branches and loops, which must not consume further input cells.
+    bool fixed;
+
+    size_t in;
+    enum type in_type[VERIFY_DEPTH];
+
+    /// Variables assumed to hold their bound lambdas.
+    unsigned bound;
+};
+
+static struct cell make(enum type type)
+{
+    struct cell cell;
+    cell.type = type;
+    cell.input = -1;
+    cell.known = false;
+    cell.value = 0;
+    return cell;
+}
+
+static struct cell make_known(enum type type, int value)
+{
+    struct cell cell = make(type);
+    cell.known = true;
+    cell.value = value;
+    return cell;
+}
+
+static enum type type_of(const struct context *ctx, struct cell cell)
+{
+    if (cell.input >= 0) {
+        return ctx->in_type[cell.input];
+    }
+    return cell.type;
+}
+
+static bool same(struct cell x, struct cell y)
+{
+    return x.type == y.type && x.input == y.input && x.known == y.known && x.value == y.value;
+}
+
+/// Ensure that @c frame holds at least @c n cells, by consuming input cells.
+static bool materialize(struct context *ctx, struct frame *frame, size_t n)
+{
+    while (frame->depth < n) {
+        if (ctx->fixed || frame->depth == VERIFY_DEPTH || ctx->in == VERIFY_DEPTH) {
+            return false;
+        }
+        memmove(&frame->cell[1], &frame->cell[0], frame->depth * sizeof(struct cell));
+        frame->cell[0] = make(typeAny);
+        frame->cell[0].input = (int)ctx->in;
+        ctx->in_type[ctx->in++] = typeAny;
+        frame->depth++;
+    }
+    return true;
+}
+
+/// Narrow @c cell to @c type.
+/// @return bool False if the type cannot be proven.
+static bool constrain(struct context *ctx, struct cell cell, enum type type)
+{
+    enum type t = type_of(ctx, cell);
+    if (t == type) {
+        return true;
+    }
+    if (t == typeAny && cell.input >= 0) {
+        ctx->in_type[cell.input] = type;
+        return true;
+    }
+    return false;
+}
+
+static bool push(struct frame *frame, struct cell cell)
+{
+    if (frame->depth == VERIFY_DEPTH) {
+        return false;
+    }
+    frame->cell[frame->depth++] = cell;
+    return true;
+}
+
+static bool pop(struct context *ctx, struct frame *frame, struct cell *cell)
+{
+    if (!materialize(ctx, frame, 1)) {
+        return false;
+    }
+    *cell = frame->cell[--frame->depth];
+    return true;
+}
+
+static bool pop_type(struct context *ctx, struct frame *frame, enum type type, struct cell *cell)
+{
+    return pop(ctx, frame, cell) && constrain(ctx, *cell, type);
+}
+
+/// Pop a number that is known at load time.
+static bool pop_index(struct context *ctx, struct frame *frame, size_t *n)
+{
+    struct cell cell;
+    if (!pop_type(ctx, frame, typeNumber, &cell) || !cell.known || cell.value < 0) {
+        return false;
+    }
+    *n = (size_t)cell.value;
+    return true;
+}
+
+/// Pop a lambda that is known at load time.
+static const struct effect *pop_lambda(struct context *ctx, struct frame *frame)
+{
+    struct cell cell;
+    if (!pop_type(ctx, frame, typeLambda, &cell) || !cell.known) {
+        return NULL;
+    }
+    if (!ctx->program->lambda[cell.value].effect.proven) {
+        return NULL;
+    }
+    return &ctx->program->lambda[cell.value].effect;
+}
+
+/// Apply stack effect of lambda call.
+static bool apply(struct context *ctx, struct frame *frame, const struct effect *effect)
+{
+    struct cell popped[VERIFY_DEPTH];
+
+    ctx->bound |= effect->bound;
+
+    for (size_t k = 0; k < effect->in; ++k) {
+        if (!pop(ctx, frame, &popped[k])) {
+            return false;
+        }
+        if (effect->in_type[k] != typeAny && !constrain(ctx, popped[k], effect->in_type[k])) {
+            return false;
+        }
+    }
+
+    for (size_t j = 0; j < effect->out; ++j) {
+        struct cell cell = effect->out_cell[j];
+        if (cell.input >= 0) {
+            cell = popped[cell.input];
+        }
+        if (!push(frame, cell)) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+/// Merge control flow paths.
+static bool join(const struct context *ctx, struct frame *frame, const struct frame *other)
+{
+    if (frame->depth != other->depth) {
+        return false;
+    }
+    for (size_t i = 0; i < frame->depth; ++i) {
+        struct cell x = frame->cell[i];
+        struct cell y = other->cell[i];
+        if (!same(x, y)) {
+            enum type t = type_of(ctx, x);
+            frame->cell[i] = make(t == type_of(ctx, y) ? t : typeAny);
+        }
+    }
+    return true;
+}
+
+static bool frame_equal(const struct frame *x, const struct frame *y)
+{
+    if (x->depth != y->depth) {
+        return false;
+    }
+    for (size_t i = 0; i < x->depth; ++i) {
+        if (!same(x->cell[i], y->cell[i])) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static bool compare(struct context *ctx, struct frame *frame)
+{
+    struct cell y;
+    struct cell x;
+    enum type tx;
+    enum type ty;
+
+    if (!pop(ctx, frame, &y) || !pop(ctx, frame, &x)) {
+        return false;
+    }
+
+    tx = type_of(ctx, x);
+    ty = type_of(ctx, y);
+    if (tx == typeAny && !constrain(ctx, x, ty)) {
+        return false;
+    }
+    if (ty == typeAny && !constrain(ctx, y, tx)) {
+        return false;
+    }
+
+    return type_of(ctx, x) == type_of(ctx, y) && push(frame, make(typeNumber));
+}
+
+/// Pop @c in numbers and push @c out numbers.
+static bool arithmetic(struct context *ctx, struct frame *frame, size_t in, size_t out)
+{
+    struct cell cell;
+    for (size_t i = 0; i < in; ++i) {
+        if (!pop_type(ctx, frame, typeNumber, &cell)) {
+            return false;
+        }
+    }
+    for (size_t i = 0; i < out; ++i) {
+        if (!push(frame, make(typeNumber))) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/// Apply either @c t or @c f (which may be NULL for if-then).
+static bool branch(struct context *ctx, struct frame *frame, const struct effect *t, const struct effect *f)
+{
+    struct frame other;
+    bool fixed = ctx->fixed;
+    bool ok;
+
+    if (!materialize(ctx, frame, f && f->in > t->in ? f->in : t->in)) {
+        return false;
+    }
+
+    other = *frame;
+
+    ctx->fixed = true;
+    ok = apply(ctx, frame, t) && (!f || apply(ctx, &other, f)) && join(ctx, frame, &other);
+    ctx->fixed = fixed;
+
+    return ok;
+}
+
+static bool loop(struct context *ctx, struct frame *frame, const struct effect *cond, const struct effect *body)
+{
+    long need = (long)cond->in - (long)cond->out + 1 + (long)body->in;
+    bool fixed = ctx->fixed;
+    bool ok = false;
+
+    if (need < (long)cond->in) {
+        need = (long)cond->in;
+    }
+
+    // Depth must be loop-invariant.
+    if ((long)cond->out - (long)cond->in - 1 + (long)body->out - (long)body->in != 0) {
+        return false;
+    }
+
+    if (!materialize(ctx, frame, (size_t)need)) {
+        return false;
+    }
+
+    ctx->fixed = true;
+
+    // Iterate to a fixed point; each join only widens cells, so this terminates.
+    for (size_t iteration = 0; iteration <= 2 * VERIFY_DEPTH; ++iteration) {
+        struct frame next = *frame;
+        struct frame exit;
+        struct cell cell;
+
+        if (!apply(ctx, &next, cond) || !pop_type(ctx, &next, typeNumber, &cell)) {
+            break;
+        }
+
+        exit = next;
+
+        if (!apply(ctx, &next, body) || !join(ctx, &next, frame)) {
+            break;
+        }
+
+        if (frame_equal(&next, frame)) {
+            *frame = exit;
+            ok = true;
+            break;
+        }
+
+        *frame = next;
+    }
+
+    ctx->fixed = fixed;
+
+    return ok;
+}
+
+/// Abstract interpretation of operator @c wc.
+static bool operate(struct context *ctx, struct frame *frame, wchar_t wc)
+{
+    struct cell x;
+    struct cell y;
+    size_t n;
+
+    switch (wc) {
+        case '\\':
+            if (!materialize(ctx, frame, 2)) {
+                return false;
+            }
+            x = frame->cell[frame->depth - 1];
+            frame->cell[frame->depth - 1] = frame->cell[frame->depth - 2];
+            frame->cell[frame->depth - 2] = x;
+            return true;
+
+        case '$':
+            return materialize(ctx, frame, 1) && push(frame, frame->cell[frame->depth - 1]);
+
+        case '%':
+            return pop(ctx, frame, &x);
+
+        case '@':
+            if (!materialize(ctx, frame, 3)) {
+                return false;
+            }
+            x = frame->cell[frame->depth - 3];
+            memmove(&frame->cell[frame->depth - 3], &frame->cell[frame->depth - 2], 2 * sizeof(struct cell));
+            frame->cell[frame->depth - 1] = x;
+            return true;
+
+        case LATIN_SMALL_LETTER_O_WITH_STROKE:
+        case 'O':
+            return pop_index(ctx, frame, &n)
+                && materialize(ctx, frame, n + 1)
+                && push(frame, frame->cell[frame->depth - 1 - n]);
+
+        case '=':
+            return compare(ctx, frame);
+
+        case '+':
+        case '-':
+        case '*':
+        case '/':
+        case '>':
+        case '&':
+        case '|':
+            return arithmetic(ctx, frame, 2, 1);
+
+        case '_':
+        case '~':
+            return arithmetic(ctx, frame, 1, 1);
+
+        case '^':
+            return arithmetic(ctx, frame, 0, 1);
+
+        case '.':
+        case ',':
+            return arithmetic(ctx, frame, 1, 0);
+
+        case LATIN_SMALL_LETTER_SHARP_S:
+        case 'B':
+            return true;
+
+        case ':':
+            return pop_type(ctx, frame, typeVariable, &x) && pop(ctx, frame, &y);
+
+        case ';':
+            {
+                const struct lambda *lambda;
+
+                if (!pop_type(ctx, frame, typeVariable, &x)) {
+                    return false;
+                }
+
+                // A bound variable is assumed to hold its lambda, so calls of it are proven.
+                lambda = x.known ? program_binding(ctx->program, x.value) : NULL;
+                if (lambda) {
+                    ctx->bound |= 1u << (x.value - 'a');
+                    return push(frame, make_known(typeLambda, (int)(lambda - ctx->program->lambda)));
+                }
+                if (x.known && program_numeric(ctx->program, x.value)) {
+                    return push(frame, make(typeNumber));
+                }
+                return push(frame, make(typeAny));
+            }
+
+        case '!':
+            {
+                const struct effect *effect = pop_lambda(ctx, frame);
+                return effect && apply(ctx, frame, effect);
+            }
+
+        case '?':
+            {
+                const struct effect *effect = pop_lambda(ctx, frame);
+                return effect && pop_type(ctx, frame, typeNumber, &x) && branch(ctx, frame, effect, NULL);
+            }
+
+        case '#':
+            {
+                const struct effect *body = pop_lambda(ctx, frame);
+                const struct effect *cond = body ? pop_lambda(ctx, frame) : NULL;
+                return cond && loop(ctx, frame, cond, body);
+            }
+    }
+
+    if (ctx->program->extensions) {
+        switch (wc) {
+            case POUND_SIGN:
+                return materialize(ctx, frame, 2) && push(frame, frame->cell[frame->depth - 2]);
+
+            case PER_MILLE_SIGN:
+                if (!materialize(ctx, frame, 2)) {
+                    return false;
+                }
+                frame->cell[frame->depth - 2] = frame->cell[frame->depth - 1];
+                frame->depth--;
+                return true;
+
+            case EURO_SIGN:
+                if (!materialize(ctx, frame, 2) || !push(frame, frame->cell[frame->depth - 1])) {
+                    return false;
+                }
+                x = frame->cell[frame->depth - 2];
+                frame->cell[frame->depth - 2] = frame->cell[frame->depth - 3];
+                frame->cell[frame->depth - 3] = x;
+                return true;
+
+            case LATIN_CAPITAL_LETTER_O_WITH_STROKE:
+                return materialize(ctx, frame, 2)
+                    && push(frame, frame->cell[frame->depth - 2])
+                    && push(frame, frame->cell[frame->depth - 2]);
+
+            case SECTION_SIGN:
+                return arithmetic(ctx, frame, 0, 1);
+
+            case INVERTED_EXCLAMATION_MARK:
+                return arithmetic(ctx, frame, 1, 1);
+
+            case CENT_SIGN:
+                return arithmetic(ctx, frame, 2, 0);
+
+            case INFINITY_SIGN:
+                return arithmetic(ctx, frame, 0, 1);
+
+            case PILCROW_SIGN:
+                return arithmetic(ctx, frame, 1, 0);
+
+            case TRADE_MARK_SIGN:
+                if (!pop_index(ctx, frame, &n) || !materialize(ctx, frame, n + 1)) {
+                    return false;
+                }
+                x = frame->cell[frame->depth - 1 - n];
+                memmove(&frame->cell[frame->depth - 1 - n], &frame->cell[frame->depth - n], n * sizeof(struct cell));
+                frame->cell[frame->depth - 1] = x;
+                return true;
+
+            case NOT_EQUAL_TO:
+                return compare(ctx, frame);
+
+            case '<':
+            case LEFT_POINTING_DOUBLE_ANGLE_QUOTATION_MARK:
+            case RIGHT_POINTING_DOUBLE_ANGLE_QUOTATION_MARK:
+            case LESS_THAN_OR_EQUAL_TO:
+            case GREATER_THAN_OR_EQUAL_TO:
+            case XOR:
+                return arithmetic(ctx, frame, 2, 1);
+
+            case DIVISION_SIGN:
+                return arithmetic(ctx, frame, 2, 2);
+
+            case INTEGRAL:
+                return arithmetic(ctx, frame, 1, 0);
+
+            case INVERTED_QUESTION_MARK:
+                {
+                    const struct effect *f = pop_lambda(ctx, frame);
+                    const struct effect *t = f ? pop_lambda(ctx, frame) : NULL;
+                    return t && pop_type(ctx, frame, typeNumber, &x) && branch(ctx, frame, t, f);
+                }
+        }
+    }
+
+    if (iswlower(wc)) {
+        return push(frame, make_known(typeVariable, wc));
+    }
+
+    // Code injection, reverse, and unknown symbols.
+    return false;
+}
+
+void verify_analyse(const struct program *program, struct slice slice, struct effect *effect)
+{
+    struct context ctx;
+    struct frame frame;
+    struct scanner scanner;
+    struct symbol symbol;
+    bool ok = true;
+
+    ctx.program = program;
+    ctx.fixed = false;
+    ctx.in = 0;
+    ctx.bound = 0;
+    frame.depth = 0;
+
+    scan_init(&scanner, slice);
+
+    while (ok && (symbol = scan_next(&scanner)).sym != symEnd) {
+        switch (symbol.sym) {
+            case symNumber:
+            case symCharacter:
+                ok = push(&frame, make_known(typeNumber, symbol.number));
+                break;
+
+            case symString:
+                break;
+
+            case symLambda:
+                {
+                    const struct lambda *lambda = program_lookup(program, symbol.slice);
+                    ok = lambda && push(&frame, make_known(typeLambda, (int)(lambda - program->lambda)));
+                }
+                break;
+
+            case symOperator:
+                ok = operate(&ctx, &frame, symbol.wc);
+                break;
+
+            default:
+                ok = false;
+                break;
+        }
+    }
+
+    effect->proven = ok;
+    effect->in = 0;
+    effect->out = 0;
+    effect->bound = 0;
+
+    if (ok) {
+        effect->bound = ctx.bound;
+        effect->in = ctx.in;
+        memcpy(effect->in_type, ctx.in_type, ctx.in * sizeof(enum type));
+        effect->out = frame.depth;
+        memcpy(effect->out_cell, frame.cell, frame.depth * sizeof(struct cell));
+    }
+}
+
+static const char *name_of(enum type type)
+{
+    switch (type) {
+        case typeNumber:
+            return "num";
+        case typeVariable:
+            return "var";
+        case typeLambda:
+            return "func";
+        case typeAny:
+            break;
+    }
+    return "x";
+}
+
+static char *append(char *buf, const char *str)
+{
+    size_t len = buf ? strlen(buf) : 0;
+    buf = (char *)realloc(buf, len + 1 /*SPC*/ + strlen(str) + 1 /*NUL*/);
+    buf[len] = 0;
+    if (len) {
+        strcat(buf, " ");
+    }
+    strcat(buf, str);
+    return buf;
+}
+
+char *verify_print(const struct effect *effect)
+{
+    char *buf = append(NULL, "(");
+
+    if (!effect->proven) {
+        return append(buf, "? )");
+    }
+
+    for (size_t k = effect->in; k-- > 0; ) {
+        buf = append(buf, name_of(effect->in_type[k]));
+    }
+
+    buf = append(buf, "--");
+
+    for (size_t j = 0; j < effect->out; ++j) {
+        struct cell cell = effect->out_cell[j];
+        buf = append(buf, name_of(cell.input >= 0 ? effect->in_type[cell.input] : cell.type));
+    }
+
+    return append(buf, ")");
+}
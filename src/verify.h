@@ -0,0 +1,65 @@
+#pragma once
+
+#include "slice.h"
+#include "token.h"
+
+#include <stdbool.h>
+#include <stddef.h>
+
+/// Maximum number of stack cells tracked per lambda.
+#define VERIFY_DEPTH 64
+
+/// Abstract type of a stack cell.
+enum type {
+    typeNumber   = tokNumber,
+    typeVariable = tokVariable,
+    typeLambda   = tokLambda,
+    typeAny
+};
+
+/// Abstract stack cell.
+struct cell {
+    /// Type, unless the cell is an input.
+    enum type type;
+
+    /// Index of input cell (zero is top of stack on entry), or -1 if produced by the lambda.
+    int input;
+
+    /// True if @c value is known at load time.
+    bool known;
+
+    /// Number, variable, or index of lambda effect.
+    int value;
+};
+
+/// Stack effect of a lambda.
+struct effect {
+    /// True if the lambda runs without underflow or type checks given its inputs.
+    bool proven;
+
+    /// Number of cells consumed.
+    size_t in;
+
+    /// Required type of each input cell (zero is top of stack).
+    enum type in_type[VERIFY_DEPTH];
+
+    /// Number of cells produced.
+    size_t out;
+
+    /// Produced cells (zero is bottom of stack).
+    struct cell out_cell[VERIFY_DEPTH];
+
+    /// Variables assumed to hold their bound lambdas (bit zero is @c a), which
+    /// must be checked before the lambda runs without checks.
+    unsigned bound;
+};
+
+struct program;
+
+/// Statically verify stack usage of @c slice.
+/// @note Lambdas nested within @c slice must already have been verified.
+void verify_analyse(const struct program *program, struct slice slice, struct effect *effect);
+
+/// Print stack diagram to dynamically allocated buffer.
+/// @note The diagram of an effect that is not proven is @c "( ? )".
+char *verify_print(const struct effect *effect);
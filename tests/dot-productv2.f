@@ -0,0 +1,18 @@
+{ dot product, of ranges of cells }
+
+1  3  5_
+1  3  5_
+3·
+35=∫
+
+
+1  3  5_
+4  2_ 1_
+3·
+3=∫
+
+
+4_ 9_
+1_ 2
+2·
+14_=∫
@@ -201,3 +201,13 @@ function gcd(a, b)
 10 15 g;! 5=∫
 49 21 g;! 7=∫
 
+
+{ bulk operators over ranges of cells }
+
+1 2 3 4 5 6 7 8 9 10 10∑ 55=∫
+5 3_ 9 12_ 4 5∧ 12_=∫
+5 3_ 9 12_ 4 5∨ 9=∫
+1 3 5_ 1 3 5_ 3· 35=∫
+1 2 3 10 20 30 3⊕ 3∑ 66=∫
+1 2 3 10 20 30 3⊗ 3∑ 140=∫
+0 10… 10∑ 0=∫
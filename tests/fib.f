@@ -0,0 +1,6 @@
+{ Fibonacci, recursively: fib.f N }
+
+[$1>[$1-f;!\2-f;!+]?]f:
+
+b;f;!."
+"
@@ -0,0 +1,7 @@
+#!/usr/bin/env false_int
+
+{ head, a line at a time rather than a byte at a time }
+
+3c:B
+
+[c;][10 4096ˇ $0=[0c:]? $[1ø10=[c;1-c:]?]? ¸]#
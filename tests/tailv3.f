@@ -0,0 +1,16 @@
+{ number of lines to show }
+3l:
+
+{ read stdin to the array }
+[^$1_≠][∞¢]#%
+
+{ scan back from the end until past "l" newlines "n" }
+∞i: 0n:
+[i;0> n;l;> ~ &]
+[
+ i;1-$i: ¡ 10= [ n;1+n: ]?
+]#
+
+{ tail, from just after the last newline scanned }
+i; n;l;> -
+[$∞<][$¡,1+]#%
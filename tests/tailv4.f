@@ -0,0 +1,21 @@
+{ number of lines to show }
+3l:
+
+{ characters }
+0c:
+
+{ pre-size the array, then read stdin into it }
+65536¶
+
+[^$1_≠][c;¢ c;1+c:]#%
+
+{ scan back from the end until past "l" newlines "n" }
+c;i: 0n:
+[i;0> n;l;> ~ &]
+[
+ i;1-$i: ¡ 10= [ n;1+n: ]?
+]#
+
+{ tail, from just after the last newline scanned }
+i; n;l;> -
+[$c;<][$¡,1+]#%
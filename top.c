@@ -0,0 +1,183 @@
+#include "utils/file.h"
+#include "utils/source_map.h"
+#include "utils/telemetry.h"
+
+#include <errno.h>
+#include <signal.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+/// Seconds between reports, unless @c --interval is given.
+#define TOP_INTERVAL 1.0
+
+/// Lines between repeats of the header.
+#define TOP_HEADER 24
+
+static const char *state_name[] = {
+    [telemetryRunning] = "running",
+    [telemetryDone]    = "done",
+    [telemetryFailed]  = "failed",
+};
+
+static void usage(void)
+{
+    printf(
+            "false_top [OPTIONS...] FILE\n"
+            "\n"
+            "Report progress of a 'FALSE' program run with `false_int --telemetry FILE'.\n"
+            "\n"
+            "Options:\n"
+            "  -h, --help            Print this message and exit.\n"
+            "  -n, --interval SECONDS\n"
+            "                        Report every SECONDS (default 1).\n"
+            "  -1, --once            Report once and exit.\n"
+            "\n"
+            "Each report gives operations executed, and their rate since the last\n"
+            "report, cells on the stack, the line and character of the current symbol,\n"
+            "bytes of input and output, and the age of the last update.  Reports stop\n"
+            "when the program ends.\n"
+    );
+}
+
+static void report(const struct telemetry_sample *sample, const struct telemetry_sample *last, const char *buf, size_t len, struct source_map *map)
+{
+    double seconds = (double)(sample->heartbeat - last->heartbeat) / 1e9;
+    double rate = seconds > 0 ? (double)(sample->operations - last->operations) / seconds : 0;
+    double age = (double)(telemetry_now() - sample->heartbeat) / 1e9;
+    char where[32] = "-";
+
+    // Lines and characters are counted as by false_int, in the program file as last read.
+    if (map && sample->offset >= 0 && (size_t)sample->offset <= len) {
+        struct source_position position = source_map_find(map, buf + sample->offset);
+        snprintf(where, sizeof(where), "%zu:%zu", position.line, position.ch);
+    }
+
+    printf("%-8s %14llu %12.0f %10llu %-10s %12llu %12llu %8.1fs\n"
+            , state_name[sample->state]
+            , (unsigned long long)sample->operations
+            , rate
+            , (unsigned long long)sample->depth
+            , where
+            , (unsigned long long)sample->bytes_in
+            , (unsigned long long)sample->bytes_out
+            , age);
+    fflush(stdout);
+}
+
+int main(int argc, char **argv)
+{
+    const char *filename = NULL;
+    double interval = TOP_INTERVAL;
+    bool once = false;
+    struct telemetry *telemetry;
+    struct telemetry_sample sample;
+    struct telemetry_sample last;
+    struct telemetry_sample next;
+    struct timespec delay;
+    char *buf = NULL;
+    struct source_map *map = NULL;
+    size_t len = 0;
+    int r;
+
+    for (int i = 1; i < argc; ++i) {
+        const char *arg = argv[i];
+
+        if (!strcmp(arg, "-h") || !strcmp(arg, "--help")) {
+            usage();
+            return EXIT_SUCCESS;
+
+        } else if (!strcmp(arg, "-n") || !strcmp(arg, "--interval")) {
+            char *end;
+            if (++i < argc) {
+                interval = strtod(argv[i], &end);
+            }
+            if (i >= argc || *end || !(interval > 0)) {
+                usage();
+                return EXIT_FAILURE;
+            }
+
+        } else if (!strcmp(arg, "-1") || !strcmp(arg, "--once")) {
+            once = true;
+
+        } else if (arg[0] == '-' || filename) {
+            usage();
+            return EXIT_FAILURE;
+
+        } else {
+            filename = arg;
+        }
+    }
+
+    if (!filename) {
+        usage();
+        return EXIT_FAILURE;
+    }
+
+    r = telemetry_open(filename, &telemetry);
+    if (r < 0) {
+        fprintf(stderr, "%s: %s\n", filename, r == -EPROTO ? "not a telemetry file" : strerror(-r));
+        return EXIT_FAILURE;
+    }
+
+    // Positions are reported without the program file, should it have gone.
+    if (file_read_fully(telemetry_program(telemetry), &buf) < 0) {
+        buf = NULL;
+    } else {
+        len = strlen(buf);
+        map = source_map_create(buf, len);
+    }
+
+    if (!telemetry_read(telemetry, &sample)) {
+        fprintf(stderr, "%s: not updated\n", filename);
+        telemetry_close(telemetry);
+        source_map_free(map);
+        free(buf);
+        return EXIT_FAILURE;
+    }
+
+    printf("%s (pid %lld)\n", telemetry_program(telemetry), (long long)sample.pid);
+
+    delay.tv_sec = (time_t)interval;
+    delay.tv_nsec = (long)((interval - (double)delay.tv_sec) * 1e9);
+
+    last = sample;
+    last.operations = 0;
+    last.heartbeat = sample.started;
+
+    for (int lines = 0; ; ++lines) {
+        if (lines % TOP_HEADER == 0) {
+            printf("%-8s %14s %12s %10s %-10s %12s %12s %9s\n"
+                    , "STATE", "OPERATIONS", "OPS/S", "DEPTH", "POSITION", "IN", "OUT", "UPDATED");
+        }
+
+        report(&sample, &last, buf, len, map);
+
+        // Stop at the end of the program, or once it has gone without saying so.
+        if (once || sample.state != telemetryRunning || (kill((pid_t)sample.pid, 0) < 0 && errno == ESRCH)) {
+            break;
+        }
+
+        nanosleep(&delay, NULL);
+
+        if (!telemetry_read(telemetry, &next)) {
+            fprintf(stderr, "%s: not updated\n", filename);
+            r = -EAGAIN;
+            break;
+        }
+
+        // Rates are between the last two updates, however many reports apart.
+        if (next.heartbeat != sample.heartbeat) {
+            last = sample;
+            sample = next;
+        }
+    }
+
+    telemetry_close(telemetry);
+    source_map_free(map);
+    free(buf);
+
+    return r < 0 ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -0,0 +1,121 @@
+#include "perf.h"
+
+#include <errno.h>
+#include <stdint.h>
+#include <string.h>
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+/// Counter of each event, or -1.
+static int fd_[perfEvents] = { -1, -1, -1, -1 };
+
+#ifdef __linux__
+
+int perf_open(void)
+{
+    static const uint64_t config[perfEvents] = {
+        PERF_COUNT_HW_CPU_CYCLES,
+        PERF_COUNT_HW_INSTRUCTIONS,
+        PERF_COUNT_HW_BRANCH_MISSES,
+        PERF_COUNT_HW_CACHE_MISSES,
+    };
+    int ret = -ENOENT;
+
+    for (int e = 0; e < perfEvents; ++e) {
+        struct perf_event_attr attr;
+
+        memset(&attr, 0, sizeof(attr));
+        attr.size = sizeof(attr);
+        attr.type = PERF_TYPE_HARDWARE;
+        attr.config = config[e];
+        attr.disabled = 1;
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+        attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+
+        // Each event separately, so that those the hardware lacks do not fail the rest.
+        fd_[e] = (int)syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+        if (fd_[e] >= 0) {
+            ret = 0;
+        } else if (ret < 0) {
+            ret = -errno;
+        }
+    }
+
+    return ret;
+}
+
+void perf_start(void)
+{
+    for (int e = 0; e < perfEvents; ++e) {
+        if (fd_[e] >= 0) {
+            ioctl(fd_[e], PERF_EVENT_IOC_RESET, 0);
+            ioctl(fd_[e], PERF_EVENT_IOC_ENABLE, 0);
+        }
+    }
+}
+
+void perf_stop(void)
+{
+    for (int e = 0; e < perfEvents; ++e) {
+        if (fd_[e] >= 0) {
+            ioctl(fd_[e], PERF_EVENT_IOC_DISABLE, 0);
+        }
+    }
+}
+
+bool perf_read(enum perf_event event, unsigned long long *value)
+{
+    // Value, time enabled, and time running.
+    uint64_t buf[3];
+
+    if (fd_[event] < 0 || read(fd_[event], buf, sizeof(buf)) != (ssize_t)sizeof(buf) || buf[2] == 0) {
+        return false;
+    }
+
+    *value = buf[2] < buf[1] ? (unsigned long long)((double)buf[0] * (double)buf[1] / (double)buf[2]) : buf[0];
+    return true;
+}
+
+void perf_close(void)
+{
+    for (int e = 0; e < perfEvents; ++e) {
+        if (fd_[e] >= 0) {
+            close(fd_[e]);
+            fd_[e] = -1;
+        }
+    }
+}
+
+#else
+
+int perf_open(void)
+{
+    return -ENOSYS;
+}
+
+void perf_start(void)
+{
+}
+
+void perf_stop(void)
+{
+}
+
+bool perf_read(enum perf_event event, unsigned long long *value)
+{
+    (void)event;
+    (void)value;
+    return false;
+}
+
+void perf_close(void)
+{
+}
+
+#endif
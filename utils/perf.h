@@ -0,0 +1,29 @@
+#pragma once
+
+#include <stdbool.h>
+
+/// Hardware events counted by @c perf_open.
+enum perf_event {
+    perfCycles,
+    perfInstructions,
+    perfBranchMisses,
+    perfCacheMisses,
+    perfEvents
+};
+
+/// Open counters of this thread, stopped.
+/// @return Negative errno if no counter could be opened, otherwise zero.
+int perf_open(void);
+
+/// Start counting.
+void perf_start(void);
+
+/// Stop counting.
+void perf_stop(void);
+
+/// Read @c event, scaled up if the kernel multiplexed it with other counters.
+/// @return bool False if the event was not counted.
+bool perf_read(enum perf_event event, unsigned long long *value);
+
+/// Close counters.
+void perf_close(void);
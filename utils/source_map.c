@@ -0,0 +1,97 @@
+#include "source_map.h"
+
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+
+struct source_map {
+    const char *str;
+    size_t len;
+
+    /// Offsets of the starts of the lines, in order, the first being zero.
+    size_t *start;
+    size_t lines;
+
+    /// Line last found, tried first.  Only a hint, so threads may race on it.
+    _Atomic size_t last;
+};
+
+struct source_map *source_map_create(const char *str, size_t len)
+{
+    struct source_map *map = (struct source_map *)malloc(sizeof(struct source_map));
+    const char *end = str + len;
+    size_t lines = 1;
+
+    for (const char *p = str; (p = (const char *)memchr(p, '\n', (size_t)(end - p))); ++p) {
+        ++lines;
+    }
+
+    map->str = str;
+    map->len = len;
+    map->start = (size_t *)malloc(lines * sizeof(size_t));
+    map->lines = 0;
+    atomic_init(&map->last, 0);
+
+    map->start[map->lines++] = 0;
+    for (const char *p = str; (p = (const char *)memchr(p, '\n', (size_t)(end - p))); ++p) {
+        map->start[map->lines++] = (size_t)(p + 1 - str);
+    }
+
+    return map;
+}
+
+size_t source_map_lines(const struct source_map *map)
+{
+    return map->lines;
+}
+
+/// @return bool True if line @c i contains @c offset.
+static bool within(const struct source_map *map, size_t i, size_t offset)
+{
+    return i < map->lines && map->start[i] <= offset && (i + 1 == map->lines || offset < map->start[i + 1]);
+}
+
+struct source_position source_map_find(struct source_map *map, const char *pos)
+{
+    struct source_position position;
+    size_t offset = (size_t)(pos - map->str);
+    size_t i = atomic_load_explicit(&map->last, memory_order_relaxed);
+
+    // Positions reported in order are mostly on the last line found, or the next.
+    if (!within(map, i, offset)) {
+        if (within(map, i + 1, offset)) {
+            ++i;
+        } else {
+            size_t lo = 0;
+            size_t hi = map->lines;
+
+            // Last line starting at or before the offset.
+            while (hi - lo > 1) {
+                size_t mid = lo + (hi - lo) / 2;
+                if (map->start[mid] <= offset) {
+                    lo = mid;
+                } else {
+                    hi = mid;
+                }
+            }
+            i = lo;
+        }
+        atomic_store_explicit(&map->last, i, memory_order_relaxed);
+    }
+
+    position.line = i + 1;
+    position.ch = offset - map->start[i] + 1;
+    position.bol = map->str + map->start[i];
+    position.eol = i + 1 < map->lines ? map->str + map->start[i + 1] - 1 : map->str + map->len;
+
+    return position;
+}
+
+void source_map_free(struct source_map *map)
+{
+    if (map) {
+        free(map->start);
+        free(map);
+    }
+}
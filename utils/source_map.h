@@ -0,0 +1,35 @@
+#pragma once
+
+#include <stddef.h>
+
+/*
+ Lines of a source, indexed once so that the line and character of a position
+ are found by binary search, or without one for positions reported in order.
+ */
+
+/// Line and character of a position, and the line containing it.
+struct source_position {
+    /// Line, and byte within it, counted from one.
+    size_t line;
+    size_t ch;
+
+    /// Start of the line, and its end: the newline ending it, or the end of the source.
+    const char *bol;
+    const char *eol;
+};
+
+/// Indexed source.
+struct source_map;
+
+/// Index the lines of the @c len bytes at @c str, which are kept by the caller.
+/// @return source_map Index, to be freed by @c source_map_free.
+struct source_map *source_map_create(const char *str, size_t len);
+
+/// @return size_t Lines of the source, one more than its newlines.
+size_t source_map_lines(const struct source_map *map);
+
+/// Find the line and character of @c pos, within the source or at its end.
+/// @note Safe to call from several threads at once.
+struct source_position source_map_find(struct source_map *map, const char *pos);
+
+void source_map_free(struct source_map *map);
@@ -0,0 +1,195 @@
+#include "telemetry.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+/// Identifies a telemetry file.
+#define TELEMETRY_MAGIC 0x4c455446u
+
+/// Changed whenever the layout of the file changes.
+#define TELEMETRY_VERSION 1
+
+/// Reads of a sample before a reader gives up on a writer stopped within an update.
+#define TELEMETRY_RETRIES 1000
+
+/// Layout of the file.  Updates are bracketed by a sequence count, which is odd
+/// while one is in progress, so that readers retry rather than block the writer.
+struct telemetry {
+    _Atomic uint32_t magic;
+    uint32_t version;
+
+    _Atomic uint64_t sequence;
+
+    _Atomic int64_t pid;
+    _Atomic uint64_t state;
+    _Atomic uint64_t operations;
+    _Atomic uint64_t depth;
+    _Atomic int64_t offset;
+    _Atomic uint64_t bytes_in;
+    _Atomic uint64_t bytes_out;
+    _Atomic uint64_t started;
+    _Atomic uint64_t heartbeat;
+
+    char program[PATH_MAX];
+};
+
+int telemetry_create(const char *path, const char *program, struct telemetry **telemetry)
+{
+    size_t len = strlen(path) + sizeof(".XXXXXX");
+    char *tmp = (char *)malloc(len);
+    struct telemetry *t;
+    int fd;
+    int r;
+
+    // Built aside and renamed into place, so that readers never see a partial
+    // file, and those mapping a previous run keep it.
+    snprintf(tmp, len, "%s.XXXXXX", path);
+    fd = mkstemp(tmp);
+    if (fd < 0) {
+        r = -errno;
+        free(tmp);
+        return r;
+    }
+
+    if (fchmod(fd, 0644) < 0 || ftruncate(fd, sizeof(struct telemetry)) < 0) {
+        r = -errno;
+        close(fd);
+        unlink(tmp);
+        free(tmp);
+        return r;
+    }
+
+    t = (struct telemetry *)mmap(NULL, sizeof(struct telemetry), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    r = t == MAP_FAILED ? -errno : 0;
+    close(fd);
+
+    if (r == 0) {
+        if (!realpath(program, t->program)) {
+            strncpy(t->program, program, sizeof(t->program) - 1);
+        }
+        t->version = TELEMETRY_VERSION;
+        atomic_store_explicit(&t->magic, TELEMETRY_MAGIC, memory_order_release);
+
+        if (rename(tmp, path) < 0) {
+            r = -errno;
+            munmap(t, sizeof(struct telemetry));
+        }
+    }
+
+    if (r < 0) {
+        unlink(tmp);
+    } else {
+        *telemetry = t;
+    }
+
+    free(tmp);
+    return r;
+}
+
+void telemetry_publish(struct telemetry *telemetry, struct telemetry_sample *sample)
+{
+    uint64_t sequence = atomic_load_explicit(&telemetry->sequence, memory_order_relaxed);
+
+    sample->heartbeat = telemetry_now();
+
+    atomic_store_explicit(&telemetry->sequence, sequence + 1, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+
+    atomic_store_explicit(&telemetry->pid, sample->pid, memory_order_relaxed);
+    atomic_store_explicit(&telemetry->state, (uint64_t)sample->state, memory_order_relaxed);
+    atomic_store_explicit(&telemetry->operations, sample->operations, memory_order_relaxed);
+    atomic_store_explicit(&telemetry->depth, sample->depth, memory_order_relaxed);
+    atomic_store_explicit(&telemetry->offset, sample->offset, memory_order_relaxed);
+    atomic_store_explicit(&telemetry->bytes_in, sample->bytes_in, memory_order_relaxed);
+    atomic_store_explicit(&telemetry->bytes_out, sample->bytes_out, memory_order_relaxed);
+    atomic_store_explicit(&telemetry->started, sample->started, memory_order_relaxed);
+    atomic_store_explicit(&telemetry->heartbeat, sample->heartbeat, memory_order_relaxed);
+
+    atomic_store_explicit(&telemetry->sequence, sequence + 2, memory_order_release);
+}
+
+int telemetry_open(const char *path, struct telemetry **telemetry)
+{
+    struct telemetry *t;
+    struct stat st;
+    int fd = open(path, O_RDONLY);
+    int r = 0;
+
+    if (fd < 0) {
+        return -errno;
+    }
+
+    if (fstat(fd, &st) < 0) {
+        r = -errno;
+    } else if ((size_t)st.st_size < sizeof(struct telemetry)) {
+        r = -EPROTO;
+    } else {
+        t = (struct telemetry *)mmap(NULL, sizeof(struct telemetry), PROT_READ, MAP_SHARED, fd, 0);
+        if (t == MAP_FAILED) {
+            r = -errno;
+        } else if (atomic_load_explicit(&t->magic, memory_order_acquire) != TELEMETRY_MAGIC
+                || t->version != TELEMETRY_VERSION) {
+            munmap(t, sizeof(struct telemetry));
+            r = -EPROTO;
+        } else {
+            *telemetry = t;
+        }
+    }
+
+    close(fd);
+    return r;
+}
+
+bool telemetry_read(const struct telemetry *telemetry, struct telemetry_sample *sample)
+{
+    for (int i = 0; i < TELEMETRY_RETRIES; ++i) {
+        uint64_t sequence = atomic_load_explicit(&telemetry->sequence, memory_order_acquire);
+
+        if (sequence & 1) {
+            continue;
+        }
+
+        sample->pid = atomic_load_explicit(&telemetry->pid, memory_order_relaxed);
+        sample->state = (enum telemetry_state)atomic_load_explicit(&telemetry->state, memory_order_relaxed);
+        sample->operations = atomic_load_explicit(&telemetry->operations, memory_order_relaxed);
+        sample->depth = atomic_load_explicit(&telemetry->depth, memory_order_relaxed);
+        sample->offset = atomic_load_explicit(&telemetry->offset, memory_order_relaxed);
+        sample->bytes_in = atomic_load_explicit(&telemetry->bytes_in, memory_order_relaxed);
+        sample->bytes_out = atomic_load_explicit(&telemetry->bytes_out, memory_order_relaxed);
+        sample->started = atomic_load_explicit(&telemetry->started, memory_order_relaxed);
+        sample->heartbeat = atomic_load_explicit(&telemetry->heartbeat, memory_order_relaxed);
+
+        atomic_thread_fence(memory_order_acquire);
+        if (atomic_load_explicit(&telemetry->sequence, memory_order_relaxed) == sequence) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+const char *telemetry_program(const struct telemetry *telemetry)
+{
+    return telemetry->program;
+}
+
+void telemetry_close(struct telemetry *telemetry)
+{
+    munmap(telemetry, sizeof(struct telemetry));
+}
+
+uint64_t telemetry_now(void)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_REALTIME, &now);
+    return (uint64_t)now.tv_sec * 1000000000u + (uint64_t)now.tv_nsec;
+}
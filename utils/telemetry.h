@@ -0,0 +1,71 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/*
+ Progress of a running program, published in a shared file (for example under
+ /dev/shm) that other processes map and read without stopping the program.
+ */
+
+/// State of the run.
+enum telemetry_state {
+    telemetryRunning,
+    telemetryDone,
+    telemetryFailed
+};
+
+/// Progress of a run, as last published.
+struct telemetry_sample {
+    /// Process running the program.
+    int64_t pid;
+
+    enum telemetry_state state;
+
+    /// Operations executed so far.
+    uint64_t operations;
+
+    /// Cells on the stack.
+    uint64_t depth;
+
+    /// Byte offset of the current symbol in the program file, or -1 if none.
+    int64_t offset;
+
+    /// Bytes read as input, and written as output.
+    uint64_t bytes_in;
+    uint64_t bytes_out;
+
+    /// Wall clock times of the start of the run and of the last update, in
+    /// nanoseconds since the epoch.
+    uint64_t started;
+    uint64_t heartbeat;
+};
+
+/// Mapped telemetry file.
+struct telemetry;
+
+/// Create, or replace, the telemetry file @c path of a run of the program file
+/// @c program, and map it for writing.
+/// @return Negative errno on failure, otherwise zero.
+int telemetry_create(const char *path, const char *program, struct telemetry **telemetry);
+
+/// Publish @c sample, stamping its heartbeat with the current time.
+/// @note Cheap enough to call every few thousand operations.
+void telemetry_publish(struct telemetry *telemetry, struct telemetry_sample *sample);
+
+/// Map the telemetry file @c path for reading.
+/// @return Negative errno on failure, or @c -EPROTO if it is not a telemetry file, otherwise zero.
+int telemetry_open(const char *path, struct telemetry **telemetry);
+
+/// Read the last sample published.
+/// @return bool False if none could be read whole, as the writer stopped within an update.
+bool telemetry_read(const struct telemetry *telemetry, struct telemetry_sample *sample);
+
+/// @return Absolute path of the program file.
+const char *telemetry_program(const struct telemetry *telemetry);
+
+/// Unmap the telemetry file, which is left in place.
+void telemetry_close(struct telemetry *telemetry);
+
+/// @return uint64_t Wall clock time, in nanoseconds since the epoch.
+uint64_t telemetry_now(void);